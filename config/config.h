@@ -19,18 +19,52 @@
 constexpr unsigned long DEFAULT_SLEEP_DURATION = 900000; // 15 minutes by default
 constexpr const uint8_t* master_mac_addr = esp32s3_mac;
 
+constexpr uint8_t SEND_WINDOW_SIZE = 4;              // Reliable frames in flight per peer
+constexpr uint32_t INITIAL_RTO_MS = 1000;            // Retransmission timeout until a peer's round-trip time is measured
+constexpr uint32_t MIN_RTO_MS = 50;                  // Floor of the adaptive retransmission timeout
+constexpr uint32_t MAX_RTO_MS = 3000;                // Cap of the adaptive timeout, backoff included
+constexpr uint8_t MAX_TRANSMISSIONS = 2;             // Times a reliable frame is sent before giving up
+constexpr uint32_t RETRANSMIT_CHECK_PERIOD = 20;     // Period of the retransmission timer check in ms
+constexpr uint8_t TX_TRACK_SLOTS = 32;               // Transmissions whose outcome is kept for their handle, beacons included
+constexpr uint8_t INGRESS_SLOTS = 10;                // Receive slots between the ESP-NOW callback and its task
+constexpr uint8_t TRANSPORT_EVENT_SLOTS = 16;        // Send reports and ACKs waiting for the transport task
+constexpr uint32_t BEACON_PERIOD_MS = 100;           // Period of the master beacon
+constexpr uint32_t BEACON_LISTEN_MS = 250;           // Time a joining node listens for the beacon on each channel
+
 /**************************************************************
  *                      Master Device                         *
  *************************************************************/
 
 #ifdef MODE_MASTER
-constexpr uint8_t NUM_ROOMS = 6;                             // Number of rooms managed
-constexpr uint16_t MAX_DATA_POINTS = 300;                    // Maximum sensor data points per room
-constexpr const char* ROOM_NAME[NUM_ROOMS] = {"Dormitorio Luis", "Dormitorio Pablo", "Dormitorio Ana",
-                                              "Cocina", "Salón", "Coladuría"}; // Names of the rooms
-constexpr uint8_t MAX_PEERS = 10;                            // Maximum number of peers
-
-constexpr const uint32_t WEB_SERVER_PERIOD = 300;             // Web server update period in ms
+constexpr uint8_t MAX_ROOMS = 16;                            // Upper bound of rooms registered at runtime
+constexpr const char* ROOMS_CONFIG_PATH = "/rooms.json";     // LittleFS file with the name and capacity of each room
+constexpr uint8_t MAX_ROOM_NAME_LENGTH = 32;                 // Room name bytes, including the terminator
+constexpr uint32_t DEFAULT_HISTORY_POINTS = 300;             // History points of a room whose config gives no capacity
+constexpr uint32_t MAX_PSRAM_HISTORY_POINTS = 50000;         // History points per room allowed in PSRAM
+constexpr uint32_t MAX_INTERNAL_HISTORY_POINTS = 1200;       // History points per room allowed in internal RAM
+constexpr uint16_t SERIES_BLOCK_BYTES = 256;                 // Size of each compressed history block
+constexpr uint8_t SERIES_BITS_PER_POINT = 24;                // Expected compressed size of a point, used to size the blocks
+constexpr uint32_t HOUR_ROLLUP_PERIOD_S = 60 * 60;            // Period of the hourly min/max/avg buckets
+constexpr uint32_t DAY_ROLLUP_PERIOD_S = 24 * 60 * 60;       // Period of the daily min/max/avg buckets
+constexpr uint32_t PSRAM_HOUR_ROLLUPS = 90 * 24;             // Hourly buckets per room in PSRAM (90 days)
+constexpr uint32_t PSRAM_DAY_ROLLUPS = 2 * 366;              // Daily buckets per room in PSRAM (2 years)
+constexpr uint32_t INTERNAL_HOUR_ROLLUPS = 48;               // Hourly buckets per room in internal RAM (2 days)
+constexpr uint32_t INTERNAL_DAY_ROLLUPS = 62;                // Daily buckets per room in internal RAM (2 months)
+constexpr const char* HISTORY_LOG_DIR = "/history";         // LittleFS directory of the history segments
+constexpr uint32_t HISTORY_SEGMENT_BYTES = 64 * 1024;        // A new segment is started once the active one reaches this size
+constexpr uint8_t HISTORY_MAX_SEGMENTS = 8;                  // Oldest segments are deleted beyond this count
+constexpr uint32_t HISTORY_RETENTION_S = 90 * 24 * 60 * 60;  // Records older than this are dropped when compacting
+constexpr uint16_t HISTORY_LOG_BUFFER = 128;                 // Samples waiting in RAM to be written
+constexpr uint16_t HISTORY_LOG_BATCH = 32;                   // Samples written to flash at once
+constexpr uint32_t HISTORY_FLUSH_PERIOD_MS = 60 * 1000;      // Longest time a sample waits in RAM
+constexpr uint16_t HISTORY_MAX_QUERY_POINTS = 300;           // Most points a history query returns, more are downsampled
+constexpr uint8_t HISTORY_QUERY_CACHE_ENTRIES = 4;           // History query results kept until the room gets a new sample
+constexpr uint8_t DEFAULT_NUM_ROOMS = 6;                     // Rooms registered when the config file is missing
+constexpr const char* DEFAULT_ROOM_NAME[DEFAULT_NUM_ROOMS] = {"Dormitorio Luis", "Dormitorio Pablo", "Dormitorio Ana",
+                                                              "Cocina", "Salón", "Coladuría"}; // Names of the default rooms
+constexpr uint8_t MAX_PEERS = 2 * MAX_ROOMS + 4;             // Maximum number of peers, may exceed the ESP-NOW driver limit
+
+constexpr const uint32_t WEB_SERVER_PERIOD = 300;             // Period of the combined room updates sent to web clients, in ms
 constexpr const uint32_t NTPSYNC_PERIOD = 5 * 60 * 1000;      // NTP synchronization period
 constexpr const uint32_t CHECK_PENDING_MSG_PERIOD = 1000;     // Period to check pending messages in ms
 
@@ -45,10 +79,14 @@ constexpr const uint32_t HEARTBEAT_TIMEOUT = 4 * 60 * 1000;
 #ifdef MODE_SENSOR
 constexpr uint8_t ROOM_ID = 1;                       // Identifier for the room (Unique for each SensorNode)
 
-constexpr unsigned long ACK_TIMEOUT_MS = 1000;       // Acknowledgment timeout in ms
-constexpr uint8_t MAX_RETRIES = 2;                   // Maximum number of retries for sending messages
 constexpr uint8_t MAX_INIT_RETRIES = 3;              // Maximum initialization retries
 constexpr uint8_t MAX_PEERS = 1;                     // Maximum number of peers
+
+constexpr bool BATCH_UPLINK = true;                  // Buffer readings in RTC memory and send them in batches
+constexpr uint8_t UPLINK_EVERY_N_WAKES = 4;          // Wakes between batch uplinks (when BATCH_UPLINK is set)
+constexpr bool COMPRESS_BATCHES = true;              // Send batches delta/varint encoded (TEMP_HUMID_PACKED)
+constexpr uint16_t SAMPLE_BUFFER_CAPACITY = 96;      // Readings kept in RTC memory while the master is unreachable
+constexpr uint32_t TX_CONFIRM_TIMEOUT_MS = 100;      // Longest wait for the last frames to leave the radio before sleeping
 #endif
 
 /**************************************************************
@@ -65,8 +103,6 @@ constexpr uint8_t LD2410_PIN = 14;                   // GPIO pin for LD2410 sens
 constexpr uint8_t UNMANNED_DURATION_S = 3;          // Duration in seconds before marking as unmanned
 
 constexpr uint8_t MAX_PEERS = 1;                     // Maximum number of peers
-constexpr unsigned long ACK_TIMEOUT_MS = 1000;       // Acknowledgment timeout in ms
-constexpr uint8_t MAX_RETRIES = 2;                   // Maximum number of retries for sending messages
 
 constexpr uint8_t DEFAULT_HOUR_COLD = 9;             // Default hour for cold mode activation
 constexpr uint8_t DEFAULT_MIN_COLD = 30;             // Default minute for cold mode activation
@@ -74,7 +110,6 @@ constexpr uint8_t DEFAULT_HOUR_WARM = 19;            // Default hour for warm mo
 constexpr uint8_t DEFAULT_MIN_WARM = 0;              // Default minute for warm mode activation
 
 constexpr uint32_t LIGHTS_CONTROL_PERIOD = 1000;      // Lights control update period in ms
-constexpr uint32_t NTPSYNC_PERIOD = 5 * 60 * 1000;    // NTP synchronization period
 constexpr uint32_t HEARTBEAT_PERIOD = 2 * 60 * 1000;  // Heartbeat msg sending period
 
 constexpr uint8_t IR_LED_PIN = 15;                    // GPIO pin for IR LED
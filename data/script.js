@@ -3,17 +3,50 @@ let socket;
 
 document.addEventListener("DOMContentLoaded", () => {
     initializeWebSocket();
+    document.getElementById('add-room-button').onclick = addRoom;
 });
 
+// Asks the master to register a new room, it is saved in rooms.json
+function addRoom() {
+    const nameInput = document.getElementById('add-room-name');
+    const name = nameInput.value.trim();
+    if (!name) return;
+    if (!socket || socket.readyState !== WebSocket.OPEN) {
+        alert('WebSocket not connected');
+        return;
+    }
+    socket.send(JSON.stringify({ action: "addRoom", name: name }));
+    nameInput.value = '';
+}
+
 function initializeWebSocket() {
     const protocol = (window.location.protocol === 'https:') ? 'wss://' : 'ws://';
     socket = new WebSocket(protocol + window.location.host + '/ws');
+    socket.binaryType = 'arraybuffer';
 
     socket.onopen = () => {
         console.log("WebSocket connection established");
+        // The master starts every connection with a snapshot
+        roomStates.clear();
+        resyncPending = true;
     };
 
     socket.onmessage = (event) => {
+        // Binary frames only carry history
+        if (event.data instanceof ArrayBuffer) {
+            const history = decodeHistoryFrame(event.data);
+            if (!history) {
+                console.error('Malformed history frame');
+                return;
+            }
+            try {
+                displayHistoryModal(history);
+            } catch (error) {
+                console.error('Error in displayHistoryModal:', error);
+            }
+            return;
+        }
+
         let data;
         try {
             data = JSON.parse(event.data);
@@ -29,11 +62,19 @@ function initializeWebSocket() {
             } catch (error) {
                 console.error('Error in displayHistoryModal:', error);
             }
-        } else if (data.type === 'update') {
-            try {
-                updateSensorData(data);
-            } catch (error) {
-                console.error('Error in updateSensorData:', error);
+        } else if (data.type === 'snapshot') {
+            applySnapshot(data.rooms);
+        } else if (data.type === 'updates') {
+            // Fields of the rooms changed during the last period of the master
+            data.rooms.forEach(applyRoomDelta);
+        } else if (data.status) {
+            // Reply to an action, only the one of addRoom is shown
+            const status = document.getElementById('add-room-status');
+            if (data.status === 'error') {
+                console.error('Action failed:', data.message);
+                status.textContent = data.message;
+            } else if (typeof data.room_name === 'string') {
+                status.textContent = `Room "${data.room_name}" added with ID ${data.room_id}`;
             }
         } else {
             console.warn('Unknown message type received:', data);
@@ -51,10 +92,121 @@ function initializeWebSocket() {
     };
 }
 
-// Requests historical data for a specific room
-function showHistoryModal(roomId) {
+// Full state and version of every room, merged from the master's snapshot and deltas
+const roomStates = new Map();
+let resyncPending = false;
+
+// Replaces the state of every room with a full snapshot
+function applySnapshot(rooms) {
+    resyncPending = false;
+    const seen = new Set();
+    rooms.forEach(room => {
+        seen.add(room.room_id);
+        roomStates.set(room.room_id, room);
+        renderRoom(room);
+    });
+    // Rooms the master no longer publishes
+    roomStates.forEach((state, roomId) => {
+        if (!seen.has(roomId)) {
+            roomStates.delete(roomId);
+            renderRoom({ room_id: roomId, sensor_registered: false, control_registered: false });
+        }
+    });
+}
+
+// Merges the changed fields of a room, or asks for a snapshot if a version was missed
+function applyRoomDelta(delta) {
+    const state = roomStates.get(delta.room_id);
+    const known = state ? state.version : 0;
+    if (delta.version <= known) {
+        return; // Already part of a snapshot
+    }
+    if (delta.version !== known + 1) {
+        requestResync();
+        return;
+    }
+    const merged = Object.assign({}, state, delta);
+    roomStates.set(delta.room_id, merged);
+    renderRoom(merged);
+}
+
+function requestResync() {
+    if (resyncPending || !socket || socket.readyState !== WebSocket.OPEN) return;
+    resyncPending = true;
+    console.warn('Room update gap, requesting a snapshot');
+    socket.send(JSON.stringify({ action: "resync" }));
+}
+
+function renderRoom(room) {
+    try {
+        updateSensorData(room);
+    } catch (error) {
+        console.error('Error in updateSensorData:', error);
+    }
+}
+
+// Layout of the binary history frame, see HistoryFrame.h on the master
+const HISTORY_FRAME_TYPE = 1;
+const HISTORY_FRAME_VERSION = 1;
+const HISTORY_FRAME_HEADER_SIZE = 12;
+const HISTORY_FRAME_WIDE_DELTAS = 0x01;
+const HISTORY_FRAME_RANGES = 0x02;
+const HISTORY_RESOLUTIONS = ['raw', 'hour', 'day'];
+const HISTORY_CHANNELS = ['temperature', 'humidity', 'temperature_min', 'temperature_max', 'humidity_min', 'humidity_max'];
+
+// Decodes a binary history frame into the same fields as the JSON message, with the timestamps already
+// in milliseconds for the chart. Typed arrays read the little endian fields directly, as every browser
+// runs little endian. Returns null if the frame is malformed
+function decodeHistoryFrame(buffer) {
+    if (buffer.byteLength < HISTORY_FRAME_HEADER_SIZE) return null;
+    const view = new DataView(buffer);
+    if (view.getUint8(0) !== HISTORY_FRAME_TYPE || view.getUint8(1) !== HISTORY_FRAME_VERSION) return null;
+
+    const flags = view.getUint8(4);
+    const count = view.getUint16(6, true);
+    const deltaSize = (flags & HISTORY_FRAME_WIDE_DELTAS) ? 4 : 2;
+    const channels = (flags & HISTORY_FRAME_RANGES) ? HISTORY_CHANNELS.length : 2;
+    const valuesOffset = HISTORY_FRAME_HEADER_SIZE + count * deltaSize;
+    if (buffer.byteLength !== valuesOffset + count * channels * 2) return null;
+
+    const deltas = deltaSize === 4
+        ? new Uint32Array(buffer, HISTORY_FRAME_HEADER_SIZE, count)
+        : new Uint16Array(buffer, HISTORY_FRAME_HEADER_SIZE, count);
+    const values = new Int16Array(buffer, valuesOffset, count * channels);
+
+    const data = {
+        type: 'history',
+        room_id: view.getUint8(2),
+        resolution: HISTORY_RESOLUTIONS[view.getUint8(3)] || 'raw',
+        times: new Array(count)
+    };
+    let seconds = view.getUint32(8, true);
+    for (let i = 0; i < count; i++) {
+        seconds += deltas[i];
+        data.times[i] = seconds * 1000;
+    }
+    for (let c = 0; c < channels; c++) {
+        const channel = new Array(count);
+        for (let i = 0; i < count; i++) {
+            channel[i] = values[c * count + i] / 100;
+        }
+        data[HISTORY_CHANNELS[c]] = channel;
+    }
+    return data;
+}
+
+// Seconds of history shown by the modal, 0 for all of it
+let historyRange = 0;
+
+// Requests historical data for a specific room: raw samples, or hourly/daily averages
+function showHistoryModal(roomId, resolution = "raw") {
     if (socket && socket.readyState === WebSocket.OPEN) {
-        const message = { action: "getHistory", room_id: roomId };
+        const message = { action: "getHistory", room_id: roomId, resolution: resolution, format: "binary" };
+        if (historyRange > 0) {
+            // Whole minutes, so reopening the chart hits the cache of the master
+            const now = Math.floor(Date.now() / 60000) * 60;
+            message.from = now - historyRange;
+        }
         socket.send(JSON.stringify(message));
     } else {
         alert('WebSocket not connected');
@@ -79,16 +231,47 @@ function displayHistoryModal(data) {
     closeButton.innerHTML = '&times;';
     closeButton.onclick = () => document.body.removeChild(modal);
 
+    const resolution = data.resolution || 'raw';
+    const resolutionSelect = document.createElement('select');
+    [['raw', 'Samples'], ['hour', 'Hourly'], ['day', 'Daily']].forEach(([value, text]) => {
+        const option = document.createElement('option');
+        option.value = value;
+        option.textContent = text;
+        option.selected = value === resolution;
+        resolutionSelect.appendChild(option);
+    });
+    resolutionSelect.onchange = () => showHistoryModal(data.room_id, resolutionSelect.value);
+
+    const rangeSelect = document.createElement('select');
+    [[0, 'All'], [24 * 3600, 'Last 24 h'], [7 * 24 * 3600, 'Last 7 days'], [30 * 24 * 3600, 'Last 30 days']]
+        .forEach(([value, text]) => {
+            const option = document.createElement('option');
+            option.value = value;
+            option.textContent = text;
+            option.selected = value === historyRange;
+            rangeSelect.appendChild(option);
+        });
+    rangeSelect.onchange = () => {
+        historyRange = Number(rangeSelect.value);
+        showHistoryModal(data.room_id, resolutionSelect.value);
+    };
+
     const canvas = document.createElement('canvas');
     canvas.id = 'historyChart';
 
     modalContent.appendChild(closeButton);
+    modalContent.appendChild(resolutionSelect);
+    modalContent.appendChild(rangeSelect);
     modalContent.appendChild(canvas);
     modal.appendChild(modalContent);
     document.body.appendChild(modal);
 
-    // Prepare data for chart
-    const timestamps = data.timestamps.map(ts => new Date(ts * 1000));
+    if (!data.times && !data.timestamps) {
+        return; // No historical data available
+    }
+
+    // Prepare data for chart, binary frames already come in milliseconds
+    const timestamps = data.times || data.timestamps.map(ts => ts * 1000);
     const temperatures = data.temperature;
     const humidities = data.humidity;
 
@@ -97,56 +280,74 @@ function displayHistoryModal(data) {
         return;
     }
 
+    // Hourly and daily points also carry the range of their bucket, drawn as a band around the average
+    const hasRanges = Array.isArray(data.temperature_min) && data.temperature_min.length === timestamps.length;
+
     // Determine chart ranges
-    const minTemp = Math.min(...temperatures);
-    const maxTemp = Math.max(...temperatures);
+    const minTemp = Math.min(...(hasRanges ? data.temperature_min : temperatures));
+    const maxTemp = Math.max(...(hasRanges ? data.temperature_max : temperatures));
     const tempRange = maxTemp - minTemp || 1; // Avoid division by zero
     const tempPadding = tempRange * 0.5;
     const tempMin = minTemp - tempPadding;
     const tempMax = maxTemp + tempPadding;
 
-    const minHumid = Math.min(...humidities);
-    const maxHumid = Math.max(...humidities);
+    const minHumid = Math.min(...(hasRanges ? data.humidity_min : humidities));
+    const maxHumid = Math.max(...(hasRanges ? data.humidity_max : humidities));
     const humidRange = maxHumid - minHumid || 1; // Avoid division by zero
     const humidPadding = humidRange * 0.5;
     const humidMin = minHumid - humidPadding;
     const humidMax = maxHumid + humidPadding;
 
+    const datasets = [
+        {
+            label: 'Temperature (°C)',
+            data: temperatures,
+            borderColor: 'rgba(255, 99, 132, 1)',
+            backgroundColor: 'rgba(255, 99, 132, 0.2)',
+            fill: false,
+            yAxisID: 'y',
+            tension: 0.1,
+            pointRadius: 0
+        },
+        {
+            label: 'Humidity (%)',
+            data: humidities,
+            borderColor: 'rgba(54, 162, 235, 1)',
+            backgroundColor: 'rgba(54, 162, 235, 0.2)',
+            fill: false,
+            yAxisID: 'y1',
+            tension: 0.1,
+            pointRadius: 0
+        }
+    ];
+    if (hasRanges) {
+        // Each max line is filled down to the min line that follows it
+        const band = (label, max, min, color, axis) => [
+            { label: `${label} max`, data: max, borderWidth: 0, backgroundColor: color, fill: '+1',
+              yAxisID: axis, tension: 0.1, pointRadius: 0, band: true },
+            { label: `${label} min`, data: min, borderWidth: 0, backgroundColor: color, fill: false,
+              yAxisID: axis, tension: 0.1, pointRadius: 0, band: true }
+        ];
+        datasets.push(...band('Temperature', data.temperature_max, data.temperature_min, 'rgba(255, 99, 132, 0.15)', 'y'));
+        datasets.push(...band('Humidity', data.humidity_max, data.humidity_min, 'rgba(54, 162, 235, 0.15)', 'y1'));
+    }
+
     // Create chart
     const ctx = canvas.getContext('2d');
     new Chart(ctx, {
         type: 'line',
         data: {
             labels: timestamps,
-            datasets: [
-                {
-                    label: 'Temperature (°C)',
-                    data: temperatures,
-                    borderColor: 'rgba(255, 99, 132, 1)',
-                    backgroundColor: 'rgba(255, 99, 132, 0.2)',
-                    fill: false,
-                    yAxisID: 'y',
-                    tension: 0.1,
-                    pointRadius: 0
-                },
-                {
-                    label: 'Humidity (%)',
-                    data: humidities,
-                    borderColor: 'rgba(54, 162, 235, 1)',
-                    backgroundColor: 'rgba(54, 162, 235, 0.2)',
-                    fill: false,
-                    yAxisID: 'y1',
-                    tension: 0.1,
-                    pointRadius: 0
-                }
-            ]
+            datasets: datasets
         },
         options: {
             normalized: true,
             scales: {
                 x: {
                     type: 'time',
-                    time: { unit: 'minute', stepSize: 10, tooltipFormat: 'HH:mm:ss', displayFormats: { minute: 'HH:mm', hour: 'HH:mm' } },
+                    time: resolution === 'raw'
+                        ? { unit: 'minute', stepSize: 10, tooltipFormat: 'HH:mm:ss', displayFormats: { minute: 'HH:mm', hour: 'HH:mm' } }
+                        : { unit: resolution, tooltipFormat: resolution === 'day' ? 'dd/MM' : 'dd/MM HH:mm', displayFormats: { hour: 'dd/MM HH:mm', day: 'dd/MM' } },
                     title: { display: true, text: 'Time' },
                     ticks: { maxRotation: 0, autoSkip: true }
                 },
@@ -167,7 +368,11 @@ function displayHistoryModal(data) {
                 }
             },
             plugins: {
-                legend: { display: true, position: 'top' },
+                legend: {
+                    display: true,
+                    position: 'top',
+                    labels: { filter: (item, chart) => !chart.datasets[item.datasetIndex].band }
+                },
                 tooltip: { mode: 'index', intersect: false }
             },
             interaction: { mode: 'index', intersect: false },
@@ -0,0 +1,63 @@
+/**
+ * @file AckOptions.h
+ * @brief Type-length-value options appended to AckMsg frames
+ * 
+ * The master answers every uplink with an ACK anyway, so pending configuration for the node is
+ * written into it as options instead of being sent as separate frames that need their own ACK.
+ * Receivers apply the options they understand and skip the rest by their length, so new option
+ * types do not break older nodes.
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "common.h"
+
+constexpr uint8_t ACK_OPTION_HEADER_SIZE = 2; // Type and length bytes before each value
+
+// Builds the option list of an ACK. Options that do not fit are rejected, never truncated
+class AckOptions {
+public:
+    AckOptions();
+
+    // Appends an option. Returns false, leaving the list untouched, if it does not fit
+    bool add(AckOption type, const void* value, uint8_t len);
+
+    bool addSleepPeriod(uint32_t sleep_period_ms);
+    bool addEpochTime(const EpochTime& time);
+    bool addSchedule(const Time& warm, const Time& cold);
+
+    // Encoded options, to be copied after the AckMsg header
+    const uint8_t* data() const;
+    uint8_t size() const;
+
+    // True if the list holds an option of that type
+    bool contains(AckOption type) const;
+
+private:
+    uint8_t buffer[MAX_ACK_OPTIONS_SIZE];
+    uint8_t used;
+};
+
+// Walks the options of a received ACK in the order they were written
+class AckOptionReader {
+public:
+    // frame_len is the number of bytes received for the whole AckMsg
+    AckOptionReader(const AckMsg& ack, size_t frame_len);
+
+    // Reads the next option. Returns false at the end of the list or if an option is truncated
+    bool next(AckOption& type, const uint8_t*& value, uint8_t& len);
+
+    // Typed views of an option value, false if the length does not match the type
+    static bool readU32(const uint8_t* value, uint8_t len, uint32_t& out);
+    static bool readSchedule(const uint8_t* value, uint8_t len, Time& warm, Time& cold);
+    static bool readEpochTime(const uint8_t* value, uint8_t len, EpochTime& time);
+
+private:
+    const uint8_t* data;
+    size_t len;
+    size_t pos;
+};
@@ -5,6 +5,21 @@
  * Derived classes implement device-specific message handling.
  * Uses a static callback to bridge ESP-NOW events to instance methods.
  * 
+ * Reliable sends are sequence-numbered per peer and kept in a small send window until the
+ * peer ACKs them. A transport task retransmits expired frames and reports the outcome through
+ * a completion callback, so callers never block on the radio unless they ask to (sendAndWait).
+ * The retransmission timeout adapts to the round-trip time measured for each peer.
+ * 
+ * Every frame handed to the radio gets a TxHandle. ESP-NOW reports the MAC-level outcome of the
+ * frames in the order they were queued, which resolves the handles and the per-peer counters.
+ * The radio callbacks never wait for peerMutex: the per-peer work of send reports and ACKs is
+ * queued for the transport task, as the Wi-Fi task must not block while another task holds the
+ * mutex across esp_now_add_peer() or esp_now_del_peer().
+ * 
+ * Peers keep their slot for as long as they are registered and are found through a hash of their
+ * MAC address. The ESP-NOW driver only holds a limited number of peers, so they are added to it
+ * when a frame is sent and the least recently used one is evicted when it is full.
+ * 
  * @author Luis Moreno
  * @date Dec 8, 2024
  */
@@ -16,14 +31,73 @@
 #include "config.h"
 #include "common.h"
 #include "esp_wifi.h"
+#include "IngressRing.h"
+#include "RttEstimator.h"
+#include "AckOptions.h"
 #include <freertos/FreeRTOS.h>
-#include <freertos/queue.h>
 #include <freertos/semphr.h>
+#include <freertos/queue.h>
+
+// Identifies a frame handed to the radio, to query its MAC-level outcome. Never 0
+typedef uint32_t TxHandle;
+constexpr TxHandle INVALID_TX_HANDLE = 0;
+
+// MAC-level outcome of a transmission
+enum class TxStatus : uint8_t {
+    PENDING,    // Queued, the radio has not reported yet
+    DELIVERED,  // Acknowledged by the receiver's MAC (always the case for broadcasts)
+    FAILED,     // Not acknowledged by the receiver's MAC, or never queued
+    UNKNOWN     // Too old, its record was reused by later transmissions
+};
+
+// MAC-level delivery counters of a peer
+struct TxStats {
+    uint32_t delivered;
+    uint32_t failed;
+};
+
+// Called once a reliable frame is ACKed (delivered = true) or runs out of transmissions
+typedef void (*SendCallback)(void* context, const uint8_t* mac_addr, MessageType type, bool delivered);
+
+// Reliable frame waiting for its ACK
+struct PendingFrame {
+    bool in_use;
+    uint8_t seq;
+    uint8_t transmissions;  // Times the frame has been sent so far
+    uint8_t len;
+    uint32_t sent_at_ms;    // Time of the last transmission
+    uint32_t timeout_ms;    // Time to wait for the ACK after the last transmission
+    SendCallback callback;
+    void* context;
+    uint8_t data[MAX_MSG_SIZE];
+};
+
+// Peers the ESP-NOW driver holds at once, one entry is kept for the broadcast address
+constexpr uint8_t MAX_DRIVER_PEERS = ESP_NOW_MAX_TOTAL_PEER_NUM - 1;
+
+// Buckets of the MAC address index, a power of two with at least twice the peers so probes stay short
+constexpr uint16_t peerIndexSize(uint16_t size = 1) {
+    return size >= 2 * MAX_PEERS ? size : peerIndexSize(size * 2);
+}
+constexpr uint16_t PEER_INDEX_SIZE = peerIndexSize();
+static_assert(MAX_PEERS < UINT8_MAX, "Index buckets store slot + 1 in a byte");
 
 // Structure to represent a peer device
 struct Peer {
+    bool in_use;                            // Slot holds a registered peer
+    bool in_driver;                         // Currently added to the ESP-NOW driver
+    uint32_t last_used;                     // Value of peerClock when a frame was last sent to it
     uint8_t mac_addr[MAC_ADDRESS_LENGTH];
     esp_now_peer_info_t peer_info;
+
+    uint8_t tx_seq;                         // Sequence number of the next reliable frame to this peer
+    bool rx_valid;                          // Set once a sequenced frame has been received from this peer
+    uint8_t rx_seq;                         // Highest sequence number acknowledged to this peer
+    uint32_t rx_history;                    // Bit i set when rx_seq - i has been acknowledged
+    uint32_t rx_duplicates;                 // Retransmissions recognized by isDuplicate()
+    RttEstimator rtt;                       // Round-trip time to this peer, sets the retransmission timeout
+    TxStats tx_stats;                       // MAC-level outcome of the frames sent to this peer
+    PendingFrame window[SEND_WINDOW_SIZE];  // Frames sent and not yet ACKed
 };
 
 // Base class for ESP-NOW and WiFi communication
@@ -44,28 +118,163 @@ public:
     // Unregisters a peer with given MAC address
     bool unregisterPeer(uint8_t* mac_address);
 
-    // Sends a message to a peer
-    bool sendMsg(uint8_t* mac_addr, const uint8_t* data, size_t size);
+    // Sends a message to a peer once, without waiting for an ACK. handle (may be nullptr) receives the
+    // TxHandle of the frame, INVALID_TX_HANDLE if it could not be queued
+    bool sendMsg(uint8_t* mac_addr, const uint8_t* data, size_t size, TxHandle* handle = nullptr);
+
+    // Sends a message once to every node listening on the current channel
+    bool sendBroadcast(const uint8_t* data, size_t size);
+
+    // Queues a message in the peer's send window and sends it. Returns false if the peer is unknown or
+    // the window is full; otherwise callback (may be nullptr) is called later with the outcome
+    bool sendReliable(const uint8_t* mac_addr, const uint8_t* data, size_t size,
+                      SendCallback callback = nullptr, void* context = nullptr);
+
+    // Sends a reliable message and blocks the calling task until it is ACKed or given up on
+    bool sendAndWait(const uint8_t* mac_addr, const uint8_t* data, size_t size);
+
+    // Queues the frames of the peer covered by an ACK to be completed by the transport task. Never blocks,
+    // so it may be called from the receive callback
+    void handleAck(const uint8_t* mac_addr, const AckMsg& ack);
+
+    // Round trip of the frame an ACK received at received_ms covers, measured from its last transmission.
+    // Must be called before handleAck(), which lets the transport task complete the frame. Returns false
+    // if no frame of the peer is waiting for that ACK
+    bool ackRoundTrip(const uint8_t* mac_addr, uint8_t acked_seq, uint32_t received_ms, uint32_t& rtt_ms);
+
+    // Sends an acknowledgment for the message with sequence number acked_seq, with SACK bits for earlier ones
+    // and the given options (may be nullptr). Returns the TxHandle of the ACK, INVALID_TX_HANDLE if not queued
+    TxHandle sendAck(const uint8_t* mac_addr, MessageType acked_msg, uint8_t acked_seq,
+                     const AckOptions* options = nullptr);
+
+    // Returns true if the frame is a retransmission of one already acknowledged. Frames are only recorded
+    // by sendAck(), so a frame its handler rejected without an ACK is processed again when it is resent
+    bool isDuplicate(const uint8_t* mac_addr, uint8_t seq);
+
+    // Forgets the received sequence numbers of a peer, e.g. when it joins again after a reboot
+    void resetSession(const uint8_t* mac_addr);
+
+    // Reads or restores the sequence number of the next reliable frame to a peer, so it can outlive deep sleep
+    bool getNextSeq(const uint8_t* mac_addr, uint8_t& seq);
+    bool setNextSeq(const uint8_t* mac_addr, uint8_t seq);
 
-    // Sends an acknowledgment message to a peer
-    void sendAck(const uint8_t* mac_addr, MessageType acked_msg);
+    // Reads or restores the round-trip time estimate of a peer, for diagnostics or to outlive deep sleep
+    bool getRtt(const uint8_t* mac_addr, RttEstimator& rtt);
+    bool setRtt(const uint8_t* mac_addr, const RttEstimator& rtt);
 
-    // Sets the message queue
-    void setQueue(QueueHandle_t queue);
+    // MAC-level outcome of a frame handed to the radio
+    TxStatus getTxStatus(TxHandle handle) const;
+
+    // Waits up to timeout_ms for the radio to report a frame, returns its outcome
+    TxStatus waitForTx(TxHandle handle, uint32_t timeout_ms);
+
+    // Waits up to timeout_ms until the radio has reported every queued frame. Returns false on timeout
+    bool waitForAllTx(uint32_t timeout_ms);
+
+    // MAC-level delivery counters of a peer
+    bool getTxStats(const uint8_t* mac_addr, TxStats& stats);
+
+    // Retransmissions dropped by isDuplicate(), in total and for one peer
+    uint32_t getDuplicateCount() const;
+    uint32_t getDuplicateCount(const uint8_t* mac_addr);
+
+    // Listens for the master beacon, starting on preferred_channel (1-13, else 1) and sweeping the rest.
+    // Returns the master's channel, or 0 if no beacon was heard
+    uint8_t findMaster(uint8_t preferred_channel);
+
+    // Called by the receive path for every BEACON frame
+    void beaconReceived(const uint8_t* mac_addr, const BeaconMsg& beacon);
+
+    // Sets the receive slots incoming frames are stored in
+    void setIngress(IngressRing* ring);
 
 protected:
     // Static callback for receiving data via ESP-NOW
     static void onDataRecvStatic(const uint8_t* mac_addr, const uint8_t* data, int len);
 
-    // Pure virtual method to handle received data
-    virtual void onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len) = 0;
+    // Handles received data, by default storing it in the ingress ring for the processing task
+    virtual void onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len);
+
+    // Static callback for the MAC-level outcome of a transmission
+    static void onDataSentStatic(const uint8_t* mac_addr, esp_now_send_status_t status);
+
+    // Resolves the oldest frame still pending and queues the peer's counter update. Never blocks
+    void onDataSent(const uint8_t* mac_addr, esp_now_send_status_t status);
+
+    // Hands a frame to the radio and sets handle (may be nullptr). Overridden when the radio is shared with other tasks
+    virtual bool transmit(const uint8_t* mac_addr, const uint8_t* data, size_t size, TxHandle* handle);
+
+    // Marks acked_seq, and each earlier seq whose bit is set in sack, as delivered
+    void completeFrames(const uint8_t* mac_addr, uint8_t acked_seq, uint8_t sack);
+
+    // Records a received sequence number and returns the SACK bits for the frames before it
+    uint8_t recordReceived(Peer& peer, uint8_t seq);
+
+    // Checks the receive history of a peer for a sequence number
+    bool alreadyReceived(const Peer& peer, uint8_t seq) const;
+
+    // Returns the registered peer with the given MAC address, nullptr if none. Requires peerMutex
+    Peer* findPeer(const uint8_t* mac_addr);
+
+    // Adds a peer to the ESP-NOW driver if it is not there, evicting the least recently used one. Requires peerMutex
+    bool ensureInDriver(Peer& peer);
+
+    // Refreshes the LRU position of the destination of a frame and brings it back into the driver if evicted
+    void touchPeer(const uint8_t* mac_addr);
 
     static CommunicationsBase* instance; // Singleton instance
 
-    QueueHandle_t dataQueue; // Queue for incoming messages
+    IngressRing* ingress; // Receive slots for incoming messages
+
+    SemaphoreHandle_t beaconSemaphore; // Given when a master beacon is heard
+    volatile uint8_t beaconChannel;    // Channel announced by the last beacon
 
-    Peer peers[MAX_PEERS]; // Array of registered peers
+    Peer peers[MAX_PEERS]; // Registered peers, each in a stable slot until it is unregistered
     int numPeers;          // Number of registered peers
 
     SemaphoreHandle_t peerMutex; // Mutex to protect peer list
+
+private:
+    // Work of the radio callbacks that needs peerMutex
+    struct TransportEvent {
+        enum Kind : uint8_t { SENT, ACKED } kind;
+        uint8_t mac_addr[MAC_ADDRESS_LENGTH];
+        bool delivered;     // SENT: MAC-level outcome of the frame
+        uint8_t acked_seq;  // ACKED: sequence number and SACK bits of the ACK
+        uint8_t sack;
+    };
+
+    // Retransmits expired frames and fails those out of transmissions, and applies the queued events
+    static void transportTask(void* pvParameters);
+    void serviceRetransmissions();
+    void applyTransportEvent(const TransportEvent& event);
+
+    // Queues an event without blocking. A full queue drops it: a lost ACK only costs a retransmission,
+    // which the peer ACKs again as a duplicate, and a lost send report one count of the peer's TxStats
+    void postTransportEvent(const TransportEvent& event);
+
+    // Frame handed to the radio, kept until TX_TRACK_SLOTS newer ones reuse the record
+    struct TxRecord {
+        TxHandle handle;
+        MessageType type;
+        TxStatus status;
+    };
+
+    // MAC address index: bucket holds slot + 1, 0 when empty. Linear probing, deletion by backward shift
+    static uint16_t hashMac(const uint8_t* mac_addr);
+    void indexPeer(uint8_t slot);
+    void unindexPeer(uint8_t slot);
+
+    uint8_t peerIndex[PEER_INDEX_SIZE];
+    uint8_t driverPeers;  // Peers currently added to the ESP-NOW driver
+    uint32_t peerClock;   // Increases with every unicast frame, orders peers for eviction
+
+    TaskHandle_t transportTaskHandle;
+    QueueHandle_t transportEvents;       // TransportEvents from the radio callbacks
+    SemaphoreHandle_t txMutex;           // Keeps handles in the order frames are queued in ESP-NOW
+    SemaphoreHandle_t txSemaphore;       // Given whenever the radio reports a frame
+    TxRecord txRecords[TX_TRACK_SLOTS];  // Indexed by handle % TX_TRACK_SLOTS
+    TxHandle txIssued;                   // Last handle given to a queued frame
+    TxHandle txResolved;                 // Last handle reported by the radio
+    uint32_t duplicateFrames; // Total retransmissions dropped, kept when peers are removed
 };
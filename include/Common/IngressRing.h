@@ -0,0 +1,52 @@
+/**
+ * @file IngressRing.h
+ * @brief Pre-allocated receive slots handed from the ESP-NOW callback to the processing task
+ * 
+ * The radio callback copies each frame once, straight into a free slot, and publishes the slot
+ * index. The processing task works on the slot in place and releases it when done. One producer
+ * (the Wi-Fi task) and one consumer (the ESP-NOW task) make the ring lock-free.
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "config.h"
+#include "common.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+// Counters of the receive path, frames are never dropped silently
+struct IngressStats {
+    uint32_t received;   // Frames stored in a slot
+    uint32_t oversize;   // Frames rejected for not fitting a slot
+    uint32_t overflow;   // Frames dropped because every slot was in use
+    uint8_t high_water;  // Most slots ever in use at once
+};
+
+class IngressRing {
+public:
+    IngressRing();
+    ~IngressRing();
+
+    // Producer side: copies a frame into the next free slot. Returns false if it is dropped
+    bool push(const uint8_t* mac_addr, const uint8_t* data, int len);
+
+    // Consumer side: waits for the oldest frame. It stays valid until release() is called
+    IncomingMsg* acquire(TickType_t timeout);
+
+    // Consumer side: returns the slot obtained from acquire() to the producer
+    void release();
+
+    // Returns a copy of the counters
+    IngressStats getStats() const;
+
+private:
+    IncomingMsg slots[INGRESS_SLOTS];
+    uint32_t head; // Slots published by the producer, only written by push()
+    uint32_t tail; // Slots released by the consumer, only written by release()
+    SemaphoreHandle_t ready; // Counts published slots so the consumer can block
+
+    IngressStats stats;
+};
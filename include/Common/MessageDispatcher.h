@@ -0,0 +1,72 @@
+/**
+ * @file MessageDispatcher.h
+ * @brief Table-driven dispatch of incoming ESP-NOW frames to typed handlers
+ * 
+ * Handlers are registered per message struct; the MessageType comes from MessageTraits, so
+ * registration cannot pair a struct with the wrong type. Frames are validated against the
+ * MESSAGE_SIZES registry before any cast and dispatched with a single table lookup.
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "config.h"
+#include "common.h"
+
+template <typename Context>
+class MessageDispatcher {
+public:
+    MessageDispatcher() : rejected(0), unhandled(0) {
+        for (uint8_t i = 0; i < TOTAL_FRAMES; ++i) {
+            handlers[i] = nullptr;
+        }
+    }
+
+    // Registers handler as the member of Context processing every valid Msg frame
+    template <typename Msg, void (Context::*handler)(const IncomingMsg& frame, const Msg& msg)>
+    void on() {
+        handlers[static_cast<uint8_t>(MessageTraits<Msg>::type)] = &invoke<Msg, handler>;
+    }
+
+    // Checks that a frame is valid and has a handler. Rejected frames are logged and counted
+    bool accept(const IncomingMsg& frame) {
+        if (!isValidFrame(frame.data, frame.len)) {
+            rejected++;
+            LOG_WARNING("Dropped malformed frame (type %u, %u bytes)", frame.len > 0 ? frame.data[0] : 0,
+                        (unsigned)frame.len);
+            return false;
+        }
+        if (handlers[frame.data[0]] == nullptr) {
+            unhandled++;
+            LOG_WARNING("Received unexpected %s message", MSG_NAME[frame.data[0]]);
+            return false;
+        }
+        return true;
+    }
+
+    // Calls the handler of an accepted frame
+    void dispatch(Context& context, const IncomingMsg& frame) const {
+        handlers[frame.data[0]](context, frame);
+    }
+
+    // Frames dropped for a bad version, type or size
+    uint32_t getRejectedCount() const { return rejected; }
+
+    // Valid frames of a type this node does not handle
+    uint32_t getUnhandledCount() const { return unhandled; }
+
+private:
+    typedef void (*Handler)(Context& context, const IncomingMsg& frame);
+
+    // Casts the validated frame to its struct and forwards it to the registered member
+    template <typename Msg, void (Context::*handler)(const IncomingMsg& frame, const Msg& msg)>
+    static void invoke(Context& context, const IncomingMsg& frame) {
+        (context.*handler)(frame, *reinterpret_cast<const Msg*>(frame.data));
+    }
+
+    Handler handlers[TOTAL_FRAMES]; // Indexed by MessageType
+    uint32_t rejected;
+    uint32_t unhandled;
+};
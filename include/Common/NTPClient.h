@@ -11,6 +11,7 @@
 #pragma once
 
 #include "config.h"
+#include "common.h"
 #include <time.h>
 #include <Arduino.h>
 
@@ -25,10 +26,22 @@ public:
     // Checks if the system time is valid
     bool isTimeValid();
 
+    // Reads the system time to share it with other nodes. Returns false while it is not valid
+    bool getEpochTime(EpochTime& time);
+
+    // Sets the system time from time received delay_ms ago, returns the correction applied in ms
+    int32_t setTime(const EpochTime& time, uint32_t delay_ms);
+
     // Checks if the current time is within nighttime hours
     bool isNightTime();
 
+    // Local time offset from UTC, applied by configTime() or by setTime()
+    static constexpr long GMT_OFFSET_S = 3600;
+    static constexpr int DAYLIGHT_OFFSET_S = 0;
+
 private:
+    bool timeZoneSet;
+
     // Define nighttime start and end hours (24-hour format)
     static constexpr uint8_t NIGHTTIME_START_HOUR = 23;
     static constexpr uint8_t NIGHTTIME_END_HOUR = 7;
@@ -0,0 +1,43 @@
+/**
+ * @file RttEstimator.h
+ * @brief Round-trip time estimator driving the retransmission timeout of a peer
+ * 
+ * Jacobson/Karels estimator as in RFC 6298: a smoothed RTT (gain 1/8) and its mean deviation
+ * (gain 1/4), kept in fixed point so the update is two shifts and two adds. The timeout is
+ * SRTT + 4 * RTTVAR, clamped between MIN_RTO_MS and MAX_RTO_MS. Only frames ACKed on their first
+ * transmission are sampled (Karn's rule); a timeout backs the estimate off until the next sample.
+ * 
+ * Plain data without constructor, so a copy can live in RTC memory across deep sleep. A zeroed
+ * estimator has no samples and uses INITIAL_RTO_MS.
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+struct RttEstimator {
+    int32_t srtt_x8;    // Smoothed round-trip time, in 1/8 ms
+    int32_t rttvar_x4;  // Round-trip time variation, in 1/4 ms
+    uint32_t rto_ms;    // Current retransmission timeout, 0 until the first sample or timeout
+    uint32_t samples;   // Round-trip times measured
+
+    // Forgets every measurement
+    void reset();
+
+    // Adds the round-trip time of a frame ACKed on its first transmission
+    void addSample(uint32_t rtt_ms);
+
+    // Keeps at least timeout_ms as timeout after a frame expired, until the next sample
+    void backOff(uint32_t timeout_ms);
+
+    // Time to wait for the ACK of a new frame
+    uint32_t timeout() const;
+
+    // Current estimates in ms, for diagnostics
+    uint32_t srttMs() const { return srtt_x8 >> 3; }
+    uint32_t rttvarMs() const { return rttvar_x4 >> 2; }
+};
@@ -0,0 +1,71 @@
+/**
+ * @file SampleCodec.h
+ * @brief Delta/zigzag-varint codec for batches of sensor readings
+ * 
+ * The first reading is stored as base values, every following one as the difference with the
+ * previous reading (for ages, the change of the step between readings, as wakes are periodic).
+ * Differences are zigzag-mapped so small negative steps stay small, then written as LEB128 varints.
+ * SHT31 readings taken one sleep period apart usually need one byte per field.
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "common.h"
+
+// Worst case bytes of one encoded reading (5-byte age varint plus two 3-byte value varints)
+constexpr uint8_t MAX_ENCODED_SAMPLE_SIZE = 11;
+
+// Appends readings to a caller-provided buffer without ever exceeding its capacity
+class SampleEncoder {
+public:
+    SampleEncoder(uint8_t* buffer, size_t capacity);
+
+    // Encodes a reading after the previous one. Returns false, leaving the buffer untouched, if it does not fit
+    bool add(const SampleRecord& sample);
+
+    // Number of bytes written so far
+    size_t size() const;
+
+    // Number of readings encoded so far
+    uint8_t count() const;
+
+private:
+    uint8_t* buffer;
+    size_t capacity;
+    size_t used;
+    uint8_t encoded;
+    SampleRecord previous;
+    int32_t previous_step; // Age difference between the two last readings
+};
+
+// Reads readings back, in the same order they were encoded
+class SampleDecoder {
+public:
+    SampleDecoder(const uint8_t* data, size_t len, uint8_t count);
+
+    // Decodes the next reading. Returns false when all readings were read or the data is malformed
+    bool next(SampleRecord& sample);
+
+    // True if the whole payload was consumed without errors after count readings
+    bool finished() const;
+
+    // Checks a payload holds exactly count well-formed readings, without storing them
+    static bool validate(const uint8_t* data, size_t len, uint8_t count);
+
+private:
+    const uint8_t* data;
+    size_t len;
+    size_t pos;
+    uint8_t remaining;
+    bool started;
+    bool error;
+    SampleRecord previous;
+    int32_t previous_step;
+
+    // Reads one varint, flagging an error if it is truncated or too long
+    bool readVarint(uint32_t& value);
+};
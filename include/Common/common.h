@@ -13,27 +13,58 @@
 
 constexpr uint8_t MAC_ADDRESS_LENGTH = 6;
 constexpr uint8_t MAX_WIFI_CHANNEL = 13;
-constexpr uint8_t TOTAL_FRAMES = 9;
 constexpr uint8_t ID_NOT_VALID = 255;
+constexpr uint8_t ESPNOW_MAX_PAYLOAD = 250; // ESP-NOW hard limit per frame (ESP_NOW_MAX_DATA_LEN)
+constexpr uint8_t BROADCAST_MAC_ADDR[MAC_ADDRESS_LENGTH] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+constexpr uint8_t MAX_SCENE_ROOMS = 16;     // Rooms addressable by the room_mask of a SceneMsg
+
+// Wire format version carried in every frame header. Bump PROTOCOL_VERSION when a frame layout changes
+// and keep MIN_PROTOCOL_VERSION at the oldest layout still understood, so nodes can be updated one by one.
+// Version 2 added the sequence number to MsgHeader, which shifts every field, so version 1 is not accepted.
+// Version 3 appended TLV options to AckMsg, version 2 ACKs are the same frame without options.
+constexpr uint8_t PROTOCOL_VERSION = 3;
+constexpr uint8_t MIN_PROTOCOL_VERSION = 2;
+
+// Registry of every message in the protocol: type, wire value, struct and smallest valid frame in bytes.
+// The enum, MSG_NAME, TOTAL_FRAMES, MESSAGE_SIZES and MessageTraits are all generated from this list,
+// so adding a message is one line here plus its struct below. Values must stay contiguous from 0x00
+#define MESSAGE_LIST(X) \
+    X(JOIN_SENSOR,       0x00, JoinSensorMsg,      sizeof(JoinSensorMsg))     \
+    X(JOIN_ROOM,         0x01, JoinRoomMsg,        sizeof(JoinRoomMsg))       \
+    X(ACK,               0x02, AckMsg,             ACK_HEADER_SIZE)           \
+    X(TEMP_HUMID,        0x03, TempHumidMsg,       sizeof(TempHumidMsg))      \
+    X(NEW_SLEEP_PERIOD,  0x04, NewSleepPeriodMsg,  sizeof(NewSleepPeriodMsg)) \
+    X(NEW_SCHEDULE,      0x05, NewScheduleMsg,     sizeof(NewScheduleMsg))    \
+    X(HEARTBEAT,         0x06, HeartbeatMsg,       sizeof(HeartbeatMsg))      \
+    X(LIGHTS_TOGGLE,     0x07, LightsToggleMsg,    sizeof(LightsToggleMsg))   \
+    X(LIGHTS_UPDATE,     0x08, LightsUpdateMsg,    sizeof(LightsUpdateMsg))   \
+    X(TEMP_HUMID_BATCH,  0x09, TempHumidBatchMsg,  BATCH_HEADER_SIZE)         \
+    X(TEMP_HUMID_PACKED, 0x0A, TempHumidPackedMsg, BATCH_HEADER_SIZE)         \
+    X(SCENE,             0x0B, SceneMsg,           sizeof(SceneMsg))          \
+    X(BEACON,            0x0C, BeaconMsg,          sizeof(BeaconMsg))
+
+#define MESSAGE_ENUM_ENTRY(name, value, msg, min_size) name = value,
+#define MESSAGE_NAME_ENTRY(name, value, msg, min_size) #name,
+#define MESSAGE_VALUE_ENTRY(name, value, msg, min_size) value,
+#define MESSAGE_COUNT_ENTRY(name, value, msg, min_size) + 1
+
+enum class MessageType : uint8_t {
+    MESSAGE_LIST(MESSAGE_ENUM_ENTRY)
+};
+
+constexpr uint8_t TOTAL_FRAMES = 0 MESSAGE_LIST(MESSAGE_COUNT_ENTRY);
 
 // Names of message types for debugging
 constexpr const char* MSG_NAME[TOTAL_FRAMES] = {
-    "JOIN_SENSOR", "JOIN_ROOM", "ACK", "TEMP_HUMID_DATA",
-    "NEW_SLEEP_PERIOD", "NEW_SCHEDULE", "HEARTBEAT",
-    "LIGHTS_TOGGLE", "LIGHTS_UPDATE"
+    MESSAGE_LIST(MESSAGE_NAME_ENTRY)
 };
 
-enum class MessageType : uint8_t {
-    JOIN_SENSOR      = 0x00,
-    JOIN_ROOM        = 0x01,
-    ACK              = 0x02, 
-    TEMP_HUMID       = 0x03,
-    NEW_SLEEP_PERIOD = 0x04,
-    NEW_SCHEDULE     = 0x05,
-    HEARTBEAT        = 0x06,
-    LIGHTS_TOGGLE    = 0x07,
-    LIGHTS_UPDATE    = 0x08
-};
+// Message tables are indexed by type, which only works if the registry values are 0, 1, 2...
+constexpr uint8_t MESSAGE_VALUES[TOTAL_FRAMES] = {MESSAGE_LIST(MESSAGE_VALUE_ENTRY)};
+constexpr bool messageValuesAreIndices(uint8_t i = 0) {
+    return i == TOTAL_FRAMES || (MESSAGE_VALUES[i] == i && messageValuesAreIndices(i + 1));
+}
+static_assert(messageValuesAreIndices(), "MESSAGE_LIST values must be contiguous and in order");
 
 enum class NodeType : uint8_t {
     NONE   = 0x00,
@@ -46,29 +77,101 @@ enum class TimeType : uint8_t {
     COLD = 0x01,
 };
 
-// Simple ACK message linking an ACK to a previous message
+// Action carried by a SceneMsg
+enum class SceneCommand : uint8_t {
+    LIGHTS   = 0x00, // Turn lights on/off
+    SCHEDULE = 0x01, // Apply the warm/cold schedule
+};
+
+// Header at the start of every frame. The type stays in byte 0 so receivers can dispatch on data[0]
+struct MsgHeader {
+    MessageType type;
+    uint8_t version;
+    uint8_t seq; // Per-peer sequence number, set by the reliable transport in CommunicationsBase
+
+    constexpr MsgHeader(MessageType type) : type(type), version(PROTOCOL_VERSION), seq(0) {}
+} __attribute__((packed));
+
+// Configuration carried by the options of an AckMsg. Each option is type, length and value bytes
+enum class AckOption : uint8_t {
+    SLEEP_PERIOD = 0x01, // uint32_t, new sleep period in ms
+    EPOCH_TIME   = 0x02, // EpochTime, Unix time at which the master built the ACK
+    SCHEDULE     = 0x03, // Time warm, Time cold
+};
+
+// Unix time with millisecond resolution, so receivers can compensate the delay of the frame
+struct EpochTime {
+    uint32_t seconds;
+    uint16_t millis;
+} __attribute__((packed));
+
+constexpr uint8_t ACK_HEADER_SIZE = 6;       // Bytes of AckMsg preceding the options
+constexpr uint8_t MAX_ACK_OPTIONS_SIZE = 32; // Room for every option at once, see AckOptions.h
+
+// ACK linking to a previous message by sequence number. sack bit i reports acked_seq - 1 - i as received too.
+// Downlink configuration rides along as options, so a change costs the receiver no extra frame
 struct AckMsg {
-    MessageType type = MessageType::ACK;   
+    MsgHeader header{MessageType::ACK};
     MessageType acked_msg; 
+    uint8_t acked_seq;
+    uint8_t sack;
+    uint8_t options[MAX_ACK_OPTIONS_SIZE]; // Only the options in use are sent
 } __attribute__((packed));
 
-// Holds temperature/humidity data for a room
+// Holds temperature/humidity data for a room in fixed-point (see encodeTemperature/encodeHumidity)
 struct TempHumidMsg {
-    MessageType type = MessageType::TEMP_HUMID;   
+    MsgHeader header{MessageType::TEMP_HUMID};
+    uint8_t room_id;
+    int16_t temperature; // Centi-degrees Celsius
+    uint16_t humidity;   // Centi-percent relative humidity
+} __attribute__((packed));
+
+// One buffered reading inside a TempHumidBatchMsg, timestamped relative to the moment the frame is sent
+struct SampleRecord {
+    uint32_t age_s;      // Seconds elapsed between the reading and the transmission of the frame
+    int16_t temperature; // Centi-degrees Celsius
+    uint16_t humidity;   // Centi-percent relative humidity
+} __attribute__((packed));
+
+constexpr uint8_t BATCH_HEADER_SIZE = 6; // Bytes of TempHumidBatchMsg preceding the samples
+constexpr uint8_t MAX_BATCH_SAMPLES = (ESPNOW_MAX_PAYLOAD - BATCH_HEADER_SIZE) / sizeof(SampleRecord);
+
+// Holds several buffered readings, oldest first. Only the first count records are sent
+struct TempHumidBatchMsg {
+    MsgHeader header{MessageType::TEMP_HUMID_BATCH};
+    uint8_t room_id;
+    uint8_t count;        // Number of valid records in samples
+    uint8_t uplink_every; // Wakes between uplinks, lets the master know when the next frame is due
+    SampleRecord samples[MAX_BATCH_SAMPLES];
+} __attribute__((packed));
+
+// Bytes on air for a TempHumidBatchMsg carrying sample_count records
+constexpr size_t batchMsgSize(uint8_t sample_count) {
+    return BATCH_HEADER_SIZE + sample_count * sizeof(SampleRecord);
+}
+
+constexpr uint8_t MAX_PACKED_PAYLOAD = ESPNOW_MAX_PAYLOAD - BATCH_HEADER_SIZE;
+
+// Same as TempHumidBatchMsg, but readings are compressed with SampleCodec. Only the encoded bytes are sent
+struct TempHumidPackedMsg {
+    MsgHeader header{MessageType::TEMP_HUMID_PACKED};
     uint8_t room_id;
-    float temperature;
-    float humidity;
+    uint8_t count;        // Number of readings encoded in payload
+    uint8_t uplink_every; // Wakes between uplinks, lets the master know when the next frame is due
+    uint8_t payload[MAX_PACKED_PAYLOAD];
 } __attribute__((packed));
 
-// Holds updated sleep period data
+// Holds updated sleep period data. No longer sent, replaced by AckOption::SLEEP_PERIOD; its value is kept
+// so the registry stays contiguous
 struct NewSleepPeriodMsg {
-    MessageType type = MessageType::NEW_SLEEP_PERIOD;   
+    MsgHeader header{MessageType::NEW_SLEEP_PERIOD};
     uint32_t new_period_ms;
+    uint8_t acked_seq;
 } __attribute__((packed));
 
 // Holds sensor join request data
 struct JoinSensorMsg {
-    MessageType type = MessageType::JOIN_SENSOR;
+    MsgHeader header{MessageType::JOIN_SENSOR};
     uint8_t room_id;
     uint32_t sleep_period_ms;
 } __attribute__((packed));
@@ -81,7 +184,7 @@ struct Time {
 
 // Holds room join request data, including warm/cold times
 struct JoinRoomMsg {
-    MessageType type = MessageType::JOIN_ROOM;
+    MsgHeader header{MessageType::JOIN_ROOM};
     uint8_t room_id;
     Time warm;
     Time cold;
@@ -90,33 +193,150 @@ struct JoinRoomMsg {
 
 // Holds new schedule data
 struct NewScheduleMsg {
-    MessageType type = MessageType::NEW_SCHEDULE;   
+    MsgHeader header{MessageType::NEW_SCHEDULE};
     Time cold;
     Time warm;
 } __attribute__((packed));
 
 // Holds heartbeat info
 struct HeartbeatMsg {
-    MessageType type = MessageType::HEARTBEAT;   
+    MsgHeader header{MessageType::HEARTBEAT};
     uint8_t room_id;
 } __attribute__((packed));
 
 // Holds update for lights state
 struct LightsUpdateMsg {
-    MessageType type = MessageType::LIGHTS_UPDATE;
+    MsgHeader header{MessageType::LIGHTS_UPDATE};
     bool is_on;
 } __attribute__((packed));
 
 // Hold new lights state
 struct LightsToggleMsg {
-    MessageType type = MessageType::LIGHTS_TOGGLE;
+    MsgHeader header{MessageType::LIGHTS_TOGGLE};
     bool turn_on; // true para encender, false para apagar
 } __attribute__((packed));
 
+// Command broadcast once to several RoomNodes. Each addressed room ACKs it with acked_seq = scene_id
+struct SceneMsg {
+    MsgHeader header{MessageType::SCENE};
+    uint8_t scene_id;    // Identifies the scene in ACKs and lets rooms ignore retransmissions
+    uint16_t room_mask;  // Bit i set when room i must apply the scene
+    SceneCommand command;
+    bool turn_on;        // SceneCommand::LIGHTS
+    Time warm;           // SceneCommand::SCHEDULE
+    Time cold;
+} __attribute__((packed));
+
+// Broadcast periodically by the master so joining nodes find its channel by listening
+struct BeaconMsg {
+    MsgHeader header{MessageType::BEACON};
+    uint8_t channel; // Channel the master operates on, frames can be heard on adjacent channels too
+} __attribute__((packed));
+
+// Frame sizes are part of the protocol, any change here must come with a PROTOCOL_VERSION bump
+static_assert(sizeof(MsgHeader) == 3, "MsgHeader wire size changed");
+static_assert(sizeof(Time) == 2, "Time wire size changed");
+static_assert(sizeof(EpochTime) == 6, "EpochTime wire size changed");
+static_assert(offsetof(AckMsg, options) == ACK_HEADER_SIZE, "AckMsg header size changed");
+static_assert(sizeof(AckMsg) == ACK_HEADER_SIZE + MAX_ACK_OPTIONS_SIZE, "AckMsg wire size changed");
+static_assert(sizeof(TempHumidMsg) == 8, "TempHumidMsg wire size changed");
+static_assert(sizeof(SampleRecord) == 8, "SampleRecord wire size changed");
+static_assert(offsetof(TempHumidBatchMsg, samples) == BATCH_HEADER_SIZE, "TempHumidBatchMsg header size changed");
+static_assert(sizeof(TempHumidBatchMsg) <= ESPNOW_MAX_PAYLOAD, "TempHumidBatchMsg exceeds ESP-NOW payload");
+static_assert(offsetof(TempHumidPackedMsg, payload) == BATCH_HEADER_SIZE, "TempHumidPackedMsg header size changed");
+static_assert(sizeof(TempHumidPackedMsg) == ESPNOW_MAX_PAYLOAD, "TempHumidPackedMsg wire size changed");
+static_assert(sizeof(NewSleepPeriodMsg) == 8, "NewSleepPeriodMsg wire size changed");
+static_assert(sizeof(JoinSensorMsg) == 8, "JoinSensorMsg wire size changed");
+static_assert(sizeof(JoinRoomMsg) == 9, "JoinRoomMsg wire size changed");
+static_assert(sizeof(NewScheduleMsg) == 7, "NewScheduleMsg wire size changed");
+static_assert(sizeof(HeartbeatMsg) == 4, "HeartbeatMsg wire size changed");
+static_assert(sizeof(LightsUpdateMsg) == 4, "LightsUpdateMsg wire size changed");
+static_assert(sizeof(LightsToggleMsg) == 4, "LightsToggleMsg wire size changed");
+static_assert(sizeof(SceneMsg) == 12, "SceneMsg wire size changed");
+static_assert(sizeof(BeaconMsg) == 4, "BeaconMsg wire size changed");
+
+// Fixed-point scale shared by temperature (centi-degrees) and humidity (centi-percent)
+constexpr float FIXED_POINT_SCALE = 100.0f;
+
+// Converts degrees Celsius to centi-degrees, rounding to nearest and saturating to int16_t
+constexpr int16_t encodeTemperature(float celsius) {
+    return celsius * FIXED_POINT_SCALE >= INT16_MAX ? INT16_MAX
+         : celsius * FIXED_POINT_SCALE <= INT16_MIN ? INT16_MIN
+         : static_cast<int16_t>(celsius * FIXED_POINT_SCALE + (celsius >= 0 ? 0.5f : -0.5f));
+}
+
+// Converts centi-degrees back to degrees Celsius
+constexpr float decodeTemperature(int16_t centi_celsius) {
+    return centi_celsius / FIXED_POINT_SCALE;
+}
+
+// Converts relative humidity in percent to centi-percent, clamped to 0-100 %
+constexpr uint16_t encodeHumidity(float percent) {
+    return percent <= 0.0f ? 0
+         : percent >= 100.0f ? static_cast<uint16_t>(100 * FIXED_POINT_SCALE)
+         : static_cast<uint16_t>(percent * FIXED_POINT_SCALE + 0.5f);
+}
+
+// Converts centi-percent back to relative humidity in percent
+constexpr float decodeHumidity(uint16_t centi_percent) {
+    return centi_percent / FIXED_POINT_SCALE;
+}
+
+// Round-trip checks, evaluated by the compiler for every target
+static_assert(encodeTemperature(decodeTemperature(2345)) == 2345, "Temperature round trip failed");
+static_assert(encodeTemperature(decodeTemperature(-1050)) == -1050, "Negative temperature round trip failed");
+static_assert(encodeTemperature(21.456f) == 2146, "Temperature rounding failed");
+static_assert(encodeTemperature(-0.004f) == 0, "Temperature rounding near zero failed");
+static_assert(encodeTemperature(500.0f) == INT16_MAX, "Temperature saturation failed");
+static_assert(encodeHumidity(decodeHumidity(5678)) == 5678, "Humidity round trip failed");
+static_assert(encodeHumidity(47.125f) == 4713, "Humidity rounding failed");
+static_assert(encodeHumidity(-3.0f) == 0 && encodeHumidity(104.0f) == 10000, "Humidity clamping failed");
+
+// Valid on-air sizes of a message. Fixed-size messages have min == max
+struct MessageSize {
+    uint8_t min;
+    uint8_t max;
+};
+
+#define MESSAGE_SIZE_ENTRY(name, value, msg, min_size) {min_size, sizeof(msg)},
+
+// Valid sizes of every message, indexed by MessageType
+constexpr MessageSize MESSAGE_SIZES[TOTAL_FRAMES] = {
+    MESSAGE_LIST(MESSAGE_SIZE_ENTRY)
+};
+
+// Maps each message struct to its MessageType at compile time
+template <typename Msg>
+struct MessageTraits;
+
+#define MESSAGE_TRAITS_ENTRY(name, value, msg, min_size)                \
+    template <>                                                          \
+    struct MessageTraits<msg> {                                          \
+        static constexpr MessageType type = MessageType::name;           \
+    };
+
+MESSAGE_LIST(MESSAGE_TRAITS_ENTRY)
+
+// Checks that a received frame has a protocol version this build understands, a known type and a valid
+// size for that type, so it can be cast to its struct without reading past the received bytes
+inline bool isValidFrame(const uint8_t* data, size_t len) {
+    if (len < sizeof(MsgHeader)) {
+        return false;
+    }
+    const MsgHeader* header = reinterpret_cast<const MsgHeader*>(data);
+    if (header->version < MIN_PROTOCOL_VERSION || header->version > PROTOCOL_VERSION) {
+        return false;
+    }
+    uint8_t type = static_cast<uint8_t>(header->type);
+    return type < TOTAL_FRAMES && len >= MESSAGE_SIZES[type].min && len <= MESSAGE_SIZES[type].max;
+}
+
 // Union of all message types
 union AllMessages {
     AckMsg ack;
     TempHumidMsg temp_humid;
+    TempHumidBatchMsg temp_humid_batch;
+    TempHumidPackedMsg temp_humid_packed;
     NewSleepPeriodMsg new_sleep;
     JoinSensorMsg join_sensor;
     JoinRoomMsg join_room;
@@ -124,6 +344,8 @@ union AllMessages {
     HeartbeatMsg heartbeat;
     LightsUpdateMsg lights_update;
     LightsToggleMsg lights_toggle;
+    SceneMsg scene;
+    BeaconMsg beacon;
 };
 
 #define MAX_MSG_SIZE sizeof(union AllMessages)
@@ -133,4 +355,5 @@ struct IncomingMsg {
     uint8_t mac_addr[MAC_ADDRESS_LENGTH];
     uint8_t data[MAX_MSG_SIZE];
     uint32_t len;
+    uint32_t received_ms; // millis() when the radio delivered the frame
 } __attribute__((packed));
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ * @file CompressedSeries.h
+ * @brief Delta-of-delta compressed time series of two fixed-point channels, stored in blocks
+ *
+ * Each point is a timestamp and two integer values (the temperature and humidity in centi-units the
+ * sensors send). Timestamps are nearly periodic, so they are stored as the change of the interval
+ * between points; values change slowly, so they are stored as the change from the previous value.
+ * Both use Gorilla-style prefix codes where a repeat costs a single bit. The bit stream is cut in
+ * fixed-size blocks that decode on their own, so once every block is full the oldest one is dropped
+ * like the slot of a ring.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// One decoded point
+struct SeriesPoint {
+    uint32_t timestamp;
+    int32_t a;
+    int32_t b;
+};
+
+// Independently decodable piece of the series
+struct SeriesBlock {
+    uint16_t count;                         // Points stored
+    uint16_t bits;                          // Bits of data in use
+    uint8_t data[SERIES_BLOCK_BYTES];
+};
+
+// Decoding position, kept between calls to CompressedSeries::next()
+struct SeriesCursor {
+    uint32_t block;         // Sequence number of the block being decoded
+    uint16_t index;         // Points of that block already decoded
+    uint16_t bit;           // Position of the next point in the block data
+    uint32_t timestamp;     // Previous point, the base of the next deltas
+    int32_t delta;
+    int32_t a;
+    int32_t b;
+};
+
+// Plain data so it can live inside SensorData, the blocks are owned by DataManager
+struct CompressedSeries {
+    SeriesBlock* blocks;    // nullptr if it could not be allocated
+    uint32_t num_blocks;
+    uint32_t tail;          // Sequence number of the oldest block
+    uint32_t head;          // Sequence number of the block being written, block seq is at blocks[seq % num_blocks]
+    uint32_t points;        // Points in all blocks
+
+    // Previous point of the head block, the base of the next deltas
+    uint32_t last_timestamp;
+    int32_t last_delta;
+    int32_t last_a;
+    int32_t last_b;
+
+    // Attaches a buffer of num_blocks blocks, nullptr disables the series
+    void init(SeriesBlock* buffer, uint32_t num_blocks);
+
+    // Appends a point, dropping the oldest block when every block is full
+    void append(const SeriesPoint& point);
+
+    // Points currently stored
+    uint32_t size() const { return points; }
+
+    // Bytes of block data in use, to measure the compression ratio
+    uint32_t usedBytes() const;
+
+    // Places a cursor before the oldest point
+    void begin(SeriesCursor& cursor) const;
+
+    // Places a cursor at the start of the block holding the first point at or after timestamp, found by
+    // binary search on the first timestamp of each block. Points are appended in time order
+    void seek(SeriesCursor& cursor, uint32_t timestamp) const;
+
+    // Decodes the point after the cursor. Returns false at the end of the series.
+    // If the block of the cursor was dropped meanwhile, it continues from the oldest point
+    bool next(SeriesCursor& cursor, SeriesPoint& out_point) const;
+};
@@ -11,35 +11,66 @@
 
 #include <Arduino.h>
 #include <freertos/semphr.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
 #include "Common/common.h"
+#include "Common/SampleCodec.h"
+#include "Common/AckOptions.h"
 #include "config.h"
+#include "SeqLock.h"
+#include "Rollup.h"
+#include "HistoryLog.h"
+#include "CompressedSeries.h"
 constexpr const float NO_HT_VALUE = 1000.0;
+// One reading of the room history
+struct SensorSample {
+    float temperature;
+    float humidity;
+    time_t timestamp;
+};
+
 // Structure to hold sensor-related data for a room
 struct SensorData {
     bool registered;
     uint8_t mac_addr[MAC_ADDRESS_LENGTH];
-    float temperature[MAX_DATA_POINTS];
-    float humidity[MAX_DATA_POINTS];
-    time_t timestamps[MAX_DATA_POINTS];
+    // Compressed history in centi-units, its blocks are allocated once when the room is added
+    CompressedSeries history;
     uint32_t sleep_period_ms;
-    uint16_t index;
-    uint16_t valid_data_points;
+    uint32_t valid_data_points; // Points in the history
+    uint32_t history_version;   // Bumped on every append, so cached queries can tell they are stale
     bool pending_update;
     uint32_t new_sleep_period_ms;
     uint32_t latest_sensor_reception;
+    uint8_t uplink_every; // Sleep periods between uplinks when the sensor sends batches
+    SensorSample latest;  // Newest sample of the history, valid once valid_data_points > 0
+    RollupSeries hourly;  // Min/max/avg per hour, allocated with the history
+    RollupSeries daily;   // Min/max/avg per day, allocated with the history
 
     SensorData() 
-        : registered(false), sleep_period_ms(DEFAULT_SLEEP_DURATION), index(0),
-          valid_data_points(0), pending_update(false), new_sleep_period_ms(DEFAULT_SLEEP_DURATION),
-          latest_sensor_reception(millis())
+        : registered(false), sleep_period_ms(DEFAULT_SLEEP_DURATION), valid_data_points(0), history_version(0),
+          pending_update(false), new_sleep_period_ms(DEFAULT_SLEEP_DURATION), latest_sensor_reception(millis()), uplink_every(1)
     {
-        memset(temperature, NO_HT_VALUE, MAX_DATA_POINTS * sizeof(float));
-        memset(humidity, NO_HT_VALUE, MAX_DATA_POINTS * sizeof(float));
-        memset(timestamps, 0, sizeof(timestamps));
         memset(mac_addr, 0, sizeof(mac_addr));
+        history.init(nullptr, 0);
+        hourly.init(nullptr, 0, HOUR_ROLLUP_PERIOD_S);
+        daily.init(nullptr, 0, DAY_ROLLUP_PERIOD_S);
     }
 };
 
+// Fields of SensorData the readers use, published without the history and rollup descriptors
+struct SensorState {
+    bool registered;
+    uint8_t mac_addr[MAC_ADDRESS_LENGTH];
+    bool pending_update;
+    bool has_sample;            // False until the first sample reaches the history
+    uint8_t uplink_every;
+    uint32_t sleep_period_ms;
+    uint32_t new_sleep_period_ms;
+    uint32_t latest_sensor_reception;
+    uint32_t history_version;
+    SensorSample latest;
+};
+
 // Structure to hold control-related data for a room
 struct ControlData {
     bool registered;
@@ -72,6 +103,35 @@ struct RoomData {
     }
 };
 
+// Small copy of the state the dashboard shows for a room, taken without copying the history
+struct RoomSummary {
+    bool sensor_registered;
+    bool control_registered;
+    bool has_sample;            // False until the sensor reports its first reading
+    SensorSample latest;
+    uint32_t sleep_period_ms;
+    Time warm;
+    Time cold;
+    bool lights_on;
+
+    bool isRegistered() const {
+        return sensor_registered || control_registered;
+    }
+};
+
+// Called for each history sample, oldest first. Returning false stops the visit
+typedef bool (*HistoryVisitor)(const SensorSample& sample, void* context);
+
+// Called for each rollup bucket, oldest first. Returning false stops the visit
+typedef bool (*RollupVisitor)(const RollupBucket& bucket, void* context);
+
+// Name and history size of a room as stored in ROOMS_CONFIG_PATH
+struct RoomConfig {
+    char name[MAX_ROOM_NAME_LENGTH];
+    uint32_t capacity;
+    uint32_t key;       // HistoryLog::roomKey() of the name, ties the logged samples to the room
+};
+
 // Manages data for all rooms, ensuring thread-safe operations
 class DataManager {
 public:
@@ -79,11 +139,56 @@ public:
     DataManager(const DataManager&) = delete;
     DataManager& operator=(const DataManager&) = delete;
 
+    // Registers the rooms listed in ROOMS_CONFIG_PATH, or the default ones if it is missing or cannot be parsed.
+    // Only a missing file is created with the defaults. LittleFS must be mounted
+    void loadRooms();
+
+    // Registers a room and allocates its history. Returns its ID, or ID_NOT_VALID if there is no room left
+    uint8_t addRoom(const char* name, uint32_t capacity);
+
+    // Writes the registered rooms to ROOMS_CONFIG_PATH. Fails if the file exists but could not be loaded
+    bool saveRooms() const;
+
+    // Refills the history of every room from the log on LittleFS. Call once, after loadRooms()
+    void loadHistory();
+
+    // Writes the samples received since the last flush once a batch is complete or old enough
+    void flushHistory(bool force = false);
+
+    // Returns the number of registered rooms, IDs go from 0 to getNumRooms() - 1
+    uint8_t getNumRooms() const;
+
+    // Returns the name of a room, or an empty string if the ID is not valid
+    const char* getRoomName(uint8_t room_id) const;
+
     // Adds new sensor data for a specific room
     void addSensorData(uint8_t room_id, float temperature, float humidity, time_t timestamp);
+
+    // Adds a batch of buffered readings (oldest first) received at reception_time
+    void addSensorDataBatch(uint8_t room_id, const SampleRecord* samples, uint8_t count, time_t reception_time,
+                            uint8_t uplink_every);
+
+    // Decodes a SampleCodec payload straight into the room history. Returns false if it is malformed
+    bool addSensorDataPacked(uint8_t room_id, const uint8_t* payload, size_t len, uint8_t count,
+                             time_t reception_time, uint8_t uplink_every);
     
-    // Retrieves data for a specific room
-    RoomData getRoomData(uint8_t room_id) const;
+    // Fills the summary of a room. Returns false if the ID is not valid
+    bool getRoomSummary(uint8_t room_id, RoomSummary& out_summary) const;
+
+    // Retrieves the latest reading of a room. Returns false if there is none
+    bool latestSample(uint8_t room_id, SensorSample& out_sample) const;
+
+    // Calls visitor for every sample of the room history between from and to (inclusive), oldest first, and
+    // returns how many were visited. The start is found by binary search, so older blocks are never decoded.
+    // Samples are copied out in small chunks so sensorMutex is never held while the visitor runs
+    uint32_t visitHistory(uint8_t room_id, time_t from, time_t to, HistoryVisitor visitor, void* context) const;
+
+    // Same as visitHistory() for the HOUR or DAY buckets overlapping [from, to]. The newest bucket may still be filling
+    uint32_t visitRollups(uint8_t room_id, HistoryResolution resolution, time_t from, time_t to, RollupVisitor visitor,
+                          void* context) const;
+
+    // Returns a counter that changes whenever a sample is added to the room history or rollups
+    uint32_t getHistoryVersion(uint8_t room_id) const;
     
     // Sets up sensor data for a room
     void sensorSetup(uint8_t room_id, const uint8_t* mac_addr, uint32_t sleep_period_ms);
@@ -108,6 +213,9 @@ public:
     
     // Checks if there is a pending update for a room
     bool isPendingUpdate(uint8_t room_id, NodeType node_type) const;
+
+    // Adds the pending updates of a node to the options of its next ACK
+    void fillAckOptions(uint8_t room_id, NodeType node_type, AckOptions& options) const;
     
     // Marks that the sleep period was successfully updated
     void sleepPeriodWasUpdated(uint8_t room_id);
@@ -116,7 +224,7 @@ public:
     bool getMacAddr(uint8_t room_id, NodeType node_type, uint8_t* out_mac_addr) const; 
     
     // Retrieves the room ID based on MAC address
-    uint8_t getId(uint8_t* mac_addr) const;
+    uint8_t getId(const uint8_t* mac_addr) const;
 
     // Updates latest room heartbeat
     void updateHeartbeat(uint8_t room_id);
@@ -137,10 +245,46 @@ public:
     void setLightsOn(uint8_t room_id, bool on);
 
 private:
-    RoomData rooms[NUM_ROOMS];
+    // Writers update rooms under the mutexes and then publish a copy, readers only use the copies
+    RoomData rooms[MAX_ROOMS];
+    SeqLock<SensorState> sensorState[MAX_ROOMS];    // Written only while holding sensorMutex
+    SeqLock<ControlData> controlState[MAX_ROOMS];   // Written only while holding controlMutex, it is small already
+    RoomConfig roomConfig[MAX_ROOMS];   // Never changes once the room is added, read without locking
+    volatile uint8_t numRooms;          // Only grows, so a valid ID stays valid
+    bool roomsFileBroken;               // ROOMS_CONFIG_PATH exists but could not be loaded, it is never overwritten
+    HistoryLog historyLog;              // Persists every sample stored by storeSample()
+    uint32_t reportedLogDrops;          // Log drops already reported by flushHistory()
+
+    // Samples copied per lock in visitHistory()
+    static constexpr uint8_t HISTORY_VISIT_CHUNK = 32;
+    static constexpr uint8_t ROLLUP_VISIT_CHUNK = 8;
     SemaphoreHandle_t sensorMutex;
     SemaphoreHandle_t controlMutex;
 
+    // Registers the DEFAULT_NUM_ROOMS rooms of config.h
+    void addDefaultRooms();
+
     // Validates the room ID
     bool roomIdIsValid(uint8_t room_id) const;
+
+    // Allocates the history and rollups of a room from PSRAM when present, else from internal RAM.
+    // Returns the raw points the history is sized for, the actual number depends on the compression
+    uint32_t allocateHistory(SensorData& sensor, uint32_t capacity);
+
+    // Publish the room state to readers, the matching mutex must be held
+    void publishSensor(uint8_t room_id);
+    void publishControl(uint8_t room_id);
+
+    // Stores one reading in the history and queues it for the log, sensorMutex must be held
+    void storeSample(uint8_t room_id, float temperature, float humidity, time_t timestamp);
+
+    // True if a buffered reading is not newer than the history, e.g. a batch resent under a new
+    // sequence number after the sensor joined again because every ACK was lost
+    static bool isStale(const SensorData& sensor, time_t timestamp);
+
+    // Feeds a replayed record to the history, see loadHistory()
+    static void replayRecord(const HistoryRecord& record, void* context);
+
+    // Stores one reading in the circular buffer, sensorMutex must be held
+    void appendSample(SensorData& sensor, float temperature, float humidity, time_t timestamp);
 };
@@ -0,0 +1,52 @@
+/**
+ * @file HistoryFrame.h
+ * @brief Binary WebSocket frame carrying a history query result
+ *
+ * Sent instead of the JSON "history" message when the client asks for format "binary". All fields are
+ * little endian and every array starts aligned to its element size, so the browser can read them with
+ * typed arrays over the received ArrayBuffer:
+ *
+ *   0  uint8   HISTORY_FRAME_TYPE
+ *   1  uint8   HISTORY_FRAME_VERSION
+ *   2  uint8   room ID
+ *   3  uint8   resolution (0 raw, 1 hour, 2 day)
+ *   4  uint8   flags, HISTORY_FRAME_WIDE_DELTAS and HISTORY_FRAME_RANGES
+ *   5  uint8   reserved, 0
+ *   6  uint16  point count n
+ *   8  uint32  base timestamp, seconds since the epoch
+ *  12  n x uint16 (uint32 if WIDE_DELTAS) seconds since the previous point, the base for the first one
+ *  ..  n x int16  temperature, hundredths of a degree
+ *  ..  n x int16  humidity, hundredths of a percent
+ *  ..  4 x n x int16  minimum and maximum temperature, minimum and maximum humidity, only with RANGES
+ *
+ * About 6 bytes per raw point against roughly 40 as JSON.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include "HistoryQuery.h"
+
+constexpr uint8_t HISTORY_FRAME_TYPE = 1;
+constexpr uint8_t HISTORY_FRAME_VERSION = 1;
+constexpr size_t HISTORY_FRAME_HEADER_SIZE = 12;
+constexpr uint8_t HISTORY_FRAME_WIDE_DELTAS = 0x01;    // Some gap between points does not fit in 16 bits
+constexpr uint8_t HISTORY_FRAME_RANGES = 0x02;         // Min/max arrays follow the averages
+
+class HistoryFrame {
+public:
+    // Returns the size of the frame holding the points, or 0 if they cannot be encoded because
+    // their timestamps are not in order
+    static size_t size(const HistoryPoint* points, uint16_t count, bool ranges);
+
+    // Writes the frame into out, which must hold size() bytes
+    static void write(uint8_t* out, uint8_t room_id, HistoryResolution resolution, const HistoryPoint* points,
+                      uint16_t count, bool ranges);
+
+private:
+    // Flags needed by the points, or false if their timestamps are not in order
+    static bool flags(const HistoryPoint* points, uint16_t count, bool ranges, uint8_t& out_flags);
+};
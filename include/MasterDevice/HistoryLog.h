@@ -0,0 +1,103 @@
+/**
+ * @file HistoryLog.h
+ * @brief Append-only log of the sensor samples on LittleFS, replayed at boot to refill the history
+ *
+ * Samples are buffered in RAM and written in batches to numbered segment files in HISTORY_LOG_DIR.
+ * Every record carries a CRC, so a record torn by a power cut is skipped on replay, and a 32-bit hash
+ * of the room name, so records are not replayed into another room when rooms.json is reordered. When the
+ * active segment is full a new one is started, adjacent small segments are merged dropping expired
+ * records, and the oldest segments are deleted beyond HISTORY_MAX_SEGMENTS.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "config.h"
+#include "Common/common.h"
+
+// One sample as stored on flash, the readings in the centi-units of encodeTemperature() and encodeHumidity()
+struct __attribute__((packed)) HistoryRecord {
+    uint32_t timestamp;
+    uint32_t room_key;      // HistoryLog::roomKey() of the room name when the sample was logged
+    int16_t temperature;
+    uint16_t humidity;
+    uint8_t room_id;
+    uint8_t reserved;
+    uint16_t crc;           // CRC-16/CCITT of the preceding bytes
+};
+
+static_assert(sizeof(HistoryRecord) == 16, "HistoryRecord must stay 16 bytes, segments are read in whole records");
+
+class HistoryLog {
+public:
+    // Receives each replayed record, oldest first
+    typedef void (*ReplayCallback)(const HistoryRecord& record, void* context);
+
+    HistoryLog();
+    HistoryLog(const HistoryLog&) = delete;
+    HistoryLog& operator=(const HistoryLog&) = delete;
+
+    // Finds the existing segments. LittleFS must be mounted
+    bool begin();
+
+    // Queues a sample for the next flush, it never touches flash
+    void append(uint8_t room_id, uint32_t room_key, time_t timestamp, int16_t temperature, uint16_t humidity);
+
+    // Writes the queued samples once there is a full batch or the oldest waited HISTORY_FLUSH_PERIOD_MS
+    void flush(bool force = false);
+
+    // Replays the newest records, at least needed[i] of room i when the log has them. Records whose key is not
+    // keys[room_id] were logged for a room that has since moved or been renamed and are skipped.
+    // Returns the records replayed
+    uint32_t replay(const uint32_t* needed, const uint32_t* keys, uint8_t num_rooms, ReplayCallback callback,
+                    void* context);
+
+    // 32-bit hash of a room name stored with its records
+    static uint32_t roomKey(const char* name);
+
+    // Samples lost because the RAM buffer was full
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    static constexpr uint8_t MAX_LISTED_SEGMENTS = 4 * HISTORY_MAX_SEGMENTS;
+
+    HistoryRecord pending[HISTORY_LOG_BUFFER];   // Samples waiting to be written
+    uint16_t pendingCount;
+    uint32_t oldestPendingMs;                    // millis() of the oldest queued sample
+    uint32_t dropped;
+    SemaphoreHandle_t logMutex;                  // Protects pending, never held during flash access
+
+    uint32_t segments[MAX_LISTED_SEGMENTS];      // Segment numbers, oldest first. The last one is active
+    uint8_t numSegments;
+    uint32_t activeSize;                         // Bytes in the active segment
+    uint32_t newestTimestamp;                    // Newest timestamp written, the reference for retention
+
+    // Writes records to the active segment, starting a new one when it is full
+    void write(const HistoryRecord* records, uint16_t count);
+
+    // Opens a new active segment and compacts the old ones
+    void startSegment();
+
+    // Merges the first adjacent pair of segments that fits one segment, dropping expired records
+    void compact();
+
+    // Deletes the oldest segments beyond HISTORY_MAX_SEGMENTS
+    void enforceRetention();
+
+    // Copies the valid, unexpired records of a segment to an open file. Returns the records copied
+    uint32_t copyRecords(uint32_t segment, File& out);
+
+    static void segmentPath(uint32_t segment, char* path, size_t size);
+    static uint32_t fileSize(uint32_t segment);
+    static uint16_t crc16(const uint8_t* data, size_t len);
+    static bool isValid(const HistoryRecord& record);
+
+    // True if the record was logged for the room now at its room_id
+    static bool belongsTo(const HistoryRecord& record, const uint32_t* keys, uint8_t num_rooms);
+};
@@ -0,0 +1,88 @@
+/**
+ * @file HistoryQuery.h
+ * @brief Time-range history queries downsampled with LTTB and cached until the room gets a new sample
+ *
+ * A query returns at most max_points points of a room between two timestamps. Longer ranges are reduced
+ * with Largest-Triangle-Three-Buckets, which keeps the peaks and dips a plain stride would skip. The
+ * result is kept in a small cache keyed by the request and the history version of the room, so reopening
+ * a chart does not decode the history again.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <freertos/semphr.h>
+#include "DataManager.h"
+#include "config.h"
+
+// One point of a query result. RAW points have min and max equal to the value
+struct HistoryPoint {
+    time_t timestamp;
+    float temperature;      // Sample value, or bucket average
+    float humidity;
+    float min_temperature;
+    float max_temperature;
+    float min_humidity;
+    float max_humidity;
+};
+
+// What a client asked for
+struct HistoryRequest {
+    uint8_t room_id;
+    HistoryResolution resolution;
+    time_t from;            // Inclusive range, use 0 and LONG_MAX for the whole history
+    time_t to;
+    uint16_t max_points;    // Clamped to [3, HISTORY_MAX_QUERY_POINTS], 0 means the maximum
+};
+
+// Called with the whole result, oldest point first. The points are only valid during the call
+typedef void (*HistoryResultHandler)(const HistoryPoint* points, uint16_t count, void* context);
+
+// Called for each point of the source of a query. Returning false stops the visit
+typedef bool (*HistoryPointVisitor)(const HistoryPoint& point, void* context);
+
+// Runs history queries for the web clients
+class HistoryQuery {
+public:
+    explicit HistoryQuery(DataManager& dataManager);
+    ~HistoryQuery();
+    HistoryQuery(const HistoryQuery&) = delete;
+    HistoryQuery& operator=(const HistoryQuery&) = delete;
+
+    // Calls handler once with the result, from the cache when the room history did not change. The result
+    // may be empty. Returns false without calling handler if the request is not valid or the query failed
+    bool run(const HistoryRequest& request, HistoryResultHandler handler, void* context);
+
+private:
+    // Times the query is restarted if the history drops a block while it is being read
+    static constexpr uint8_t MAX_QUERY_ATTEMPTS = 3;
+
+    struct CacheEntry {
+        bool valid;
+        HistoryRequest request;
+        uint32_t version;       // History version of the room when the result was computed
+        uint32_t last_used;
+        uint16_t count;
+        HistoryPoint* points;   // HISTORY_MAX_QUERY_POINTS points, allocated the first time the entry is used
+    };
+
+    DataManager& dataManager;
+    SemaphoreHandle_t queryMutex;       // Serialises queries, they share the cache
+    CacheEntry cache[HISTORY_QUERY_CACHE_ENTRIES];
+    uint32_t useCounter;
+
+    // Returns the entry holding the result of request at version, or nullptr
+    CacheEntry* lookup(const HistoryRequest& request, uint32_t version);
+
+    // Returns the least recently used entry with its buffer allocated, or nullptr if allocation failed
+    CacheEntry* reserve();
+
+    // Computes the result of request into entry. Returns false if the history changed under the query
+    bool compute(const HistoryRequest& request, CacheEntry& entry) const;
+
+    // Visits the valid samples or buckets of the request up to to as HistoryPoints
+    void visitSource(const HistoryRequest& request, time_t to, HistoryPointVisitor visitor, void* context) const;
+};
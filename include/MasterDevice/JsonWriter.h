@@ -0,0 +1,59 @@
+/**
+ * @file JsonWriter.h
+ * @brief Minimal streaming JSON writer that never allocates
+ *
+ * Values are written straight into a caller buffer as they are added. With a nullptr buffer nothing is
+ * written and only the length is counted, so a message can be measured first and then written into a
+ * buffer of the exact size.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class JsonWriter {
+public:
+    // buffer may be nullptr to only measure the output
+    JsonWriter(char* buffer, size_t capacity);
+
+    // Writes the key of the next member of the current object
+    void key(const char* name);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+
+    void string(const char* value);
+    void number(long value);
+    void decimal(float value);  // Two decimals, the resolution of the sensors. NaN and infinity become null
+    void boolean(bool value);
+
+    // Bytes written, or that would have been written when measuring
+    size_t length() const { return used; }
+
+    // True if the buffer was too small or the nesting too deep, the output is then incomplete
+    bool failed() const { return overflow; }
+
+private:
+    static constexpr uint8_t MAX_DEPTH = 8;
+
+    char* buffer;
+    size_t capacity;
+    size_t used;
+    bool overflow;
+    uint8_t depth;
+    bool first[MAX_DEPTH];  // No value written yet in the object or array at each depth
+    bool afterKey;          // The next value belongs to the key just written
+
+    // Writes the comma before a value when it is not the first of its container
+    void separator();
+    void writeString(const char* value);
+    void push();
+    void pop();
+    void write(char c);
+    void write(const char* data, size_t len);
+};
@@ -14,7 +14,4 @@
 class MasterCommunications : public CommunicationsBase {
 public:
     MasterCommunications();
-
-private:
-    void onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len) override;
 };
@@ -12,6 +12,7 @@
 #include "Common/mac_addrs.h"
 #include "MasterCommunications.h"
 #include "Common/NTPClient.h"
+#include "Common/MessageDispatcher.h"
 #include "DataManager.h"
 #include "WebServer.h"
 #include "WebSockets.h"
@@ -23,13 +24,28 @@
 // Structure to track pending updates for rooms
 struct PendingUpdate {
     uint8_t room_id;            // Room identifier
-    uint8_t attempts;           // Number of resend attempts
-    uint32_t lastAttemptMillis; // Timestamp of the last attempt
+    uint8_t attempts;           // Number of undelivered attempts
+    TxHandle ack_handle;        // Latest ACK carrying the update, confirmed by checkSleepUpdates()
 
     PendingUpdate() 
-        : room_id(0), attempts(0), lastAttemptMillis(0) {}
+        : room_id(0), attempts(0), ack_handle(INVALID_TX_HANDLE) {}
 };
 
+// Scene broadcast to several rooms, completed once every addressed room ACKs it or transmissions run out
+struct PendingScene {
+    bool active;
+    uint16_t pending_mask;   // Addressed rooms that have not ACKed yet
+    uint16_t acked_mask;     // Addressed rooms that applied the scene
+    uint8_t transmissions;   // Broadcasts sent so far
+    uint32_t sent_at_ms;     // Time of the last broadcast
+    SceneMsg msg;
+
+    PendingScene()
+        : active(false), pending_mask(0), acked_mask(0), transmissions(0), sent_at_ms(0) {}
+};
+
+static_assert(MAX_ROOMS <= MAX_SCENE_ROOMS, "Rooms do not fit the SceneMsg room_mask");
+
 // Class to coordinate communication, data management, and web interfaces
 class MasterController {
 public:
@@ -37,12 +53,13 @@ public:
     void initialize();
 
 private:
-    // Retry configurations
-    static constexpr uint8_t MAX_RETRIES = 3;           // Maximum number of resend attempts
-    static constexpr uint32_t RETRY_INTERVAL_MS = 5000; // Interval between retries in milliseconds
+    // Sleep period attempts before the SensorNode is reported as misbehaving
+    static constexpr uint8_t MAX_SLEEP_UPDATE_ATTEMPTS = 3;
 
-    PendingUpdate pendingSleepUpdate[NUM_ROOMS];       // Tracks sleep period updates
-    PendingUpdate pendingScheduleUpdate[NUM_ROOMS];    // Tracks schedule updates
+    PendingUpdate pendingSleepUpdate[MAX_ROOMS];       // Tracks sleep period updates
+    PendingScene pendingScene;                         // Scene in flight, one at a time
+    uint8_t nextSceneId;                               // Id of the next scene broadcast
+    SemaphoreHandle_t sceneMutex;                      // Protects pendingScene
 
     // Module instances
     MasterCommunications communications;  // Handles communication protocols
@@ -50,10 +67,12 @@ private:
     DataManager dataManager;              // Manages sensor and control data
     WebServer webServer;                  // Hosts the web interface
     WebSockets webSockets;                // Manages WebSocket communications
+    MessageDispatcher<MasterController> dispatcher; // Routes incoming frames to the on*() handlers
 
     // FreeRTOS task handles
     TaskHandle_t espnowTaskHandle;      // Handle for ESP-NOW Task
-    QueueHandle_t espnowQueue;          // Queue for incoming ESP-NOW messages
+    IngressRing ingress;                // Receive slots for incoming ESP-NOW messages
+    uint32_t reportedIngressDrops;      // Dropped frames already logged by checkIngressDrops()
     TaskHandle_t ntpSyncTaskHandle;     // Handle for NTP Sync Task 
 
     // Sets the master to sleep for the next 30min
@@ -64,14 +83,54 @@ private:
     static void scheduleChangedCallback(uint8_t room_id, uint8_t warm_hour, uint8_t warm_min, 
                                         uint8_t cold_hour, uint8_t cold_min);
     static void lightsToggleCallback(uint8_t room_id, bool turn_on);
+    static bool sceneCallback(uint16_t room_mask, SceneCommand command, bool turn_on, Time warm, Time cold);
+
+    // Completion callbacks of reliable sends
+    static void scheduleSendComplete(void* context, const uint8_t* mac_addr, MessageType type, bool delivered);
     
     // Task functions
     static void espnowTask(void* pvParameter);
     static void ntpSyncTask(void* pvParameter);
     static void updateCheckTask(void* pvParameter);
+    static void beaconTask(void* pvParameter);
+    static void webPublishTask(void* pvParameter);
+
+    // Validates, deduplicates and dispatches one received frame
+    void processFrame(const IncomingMsg& msg);
+
+    // Fills the dispatcher table, one registration per handled message
+    void registerHandlers();
+
+    // Handlers of incoming messages, called with frames already validated by the dispatcher
+    void onTempHumid(const IncomingMsg& frame, const TempHumidMsg& msg);
+    void onTempHumidBatch(const IncomingMsg& frame, const TempHumidBatchMsg& msg);
+    void onTempHumidPacked(const IncomingMsg& frame, const TempHumidPackedMsg& msg);
+    void onJoinSensor(const IncomingMsg& frame, const JoinSensorMsg& msg);
+    void onAck(const IncomingMsg& frame, const AckMsg& msg);
+    void onJoinRoom(const IncomingMsg& frame, const JoinRoomMsg& msg);
+    void onHeartbeat(const IncomingMsg& frame, const HeartbeatMsg& msg);
+    void onLightsUpdate(const IncomingMsg& frame, const LightsUpdateMsg& msg);
+
+    // Acknowledges sensor data with the pending updates of the SensorNode as ACK options
+    void acknowledgeSensorData(uint8_t room_id, const uint8_t* mac_addr, MessageType acked_msg, uint8_t acked_seq);
+
+    // Adds the current time to an ACK, if the master's clock is synchronized
+    void addTimeOption(AckOptions& options);
+
+    // Marks sleep periods as applied once the ACK carrying them reached the SensorNode
+    void checkSleepUpdates();
+
+    // Records the ACK of a room for the scene in flight
+    void onSceneAck(const uint8_t* mac_addr, uint8_t scene_id);
+
+    // Rebroadcasts the scene in flight, or completes it once transmissions run out
+    void checkPendingScene();
+
+    // Applies the outcome of a finished scene to the rooms and reports it to the web clients
+    void completeScene(const PendingScene& scene);
 
-    // Checks and resends pending updates
-    void checkAndResendUpdates();
+    // Logs frames dropped by the receive path since the last check
+    void checkIngressDrops();
 
     // Checks if latest heartbeat is valid for each room
     void checkHeartbeats();
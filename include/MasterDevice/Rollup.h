@@ -0,0 +1,55 @@
+/**
+ * @file Rollup.h
+ * @brief Fixed-period min/max/avg buckets kept next to the raw history of a room
+ *
+ * Every sample updates only the newest bucket, or opens a new one when it falls in a later period,
+ * so the rollups cost O(1) per sample and cover far more time than the raw ring. Periods are aligned
+ * to local time, so daily buckets run from local midnight to local midnight.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+// Resolutions the room history can be queried at
+enum class HistoryResolution : uint8_t {
+    RAW,
+    HOUR,
+    DAY
+};
+
+// Summary of the samples that fell in one period
+struct RollupBucket {
+    time_t start;             // Period start, a multiple of the period since the epoch in local time
+    uint32_t count;           // Samples in the bucket
+    float min_temperature;
+    float max_temperature;
+    float sum_temperature;
+    float min_humidity;
+    float max_humidity;
+    float sum_humidity;
+
+    float avgTemperature() const { return count > 0 ? sum_temperature / count : 0; }
+    float avgHumidity() const { return count > 0 ? sum_humidity / count : 0; }
+};
+
+// Ring of buckets of one period. Plain data so it can live inside SensorData
+struct RollupSeries {
+    RollupBucket* buckets;    // Owned by DataManager, nullptr if it could not be allocated
+    uint32_t capacity;
+    uint32_t period_s;
+    int32_t utc_offset_s;     // Local time offset from UTC the periods are aligned to
+    uint32_t appended;        // Buckets opened so far, the newest one is (appended - 1) % capacity
+
+    // Attaches a buffer of capacity buckets, nullptr disables the series
+    void init(RollupBucket* buffer, uint32_t capacity, uint32_t period_s, int32_t utc_offset_s = 0);
+
+    // Adds a sample to its bucket. Samples older than the newest bucket are ignored
+    void add(time_t timestamp, float temperature, float humidity);
+
+    // Buckets currently stored
+    uint32_t size() const;
+};
@@ -0,0 +1,63 @@
+/**
+ * @file SeqLock.h
+ * @brief Sequence lock publishing a small value to readers that never block the writer
+ *
+ * The writer bumps the sequence to an odd value, copies the value and bumps it again. Readers copy
+ * the value between two reads of the sequence and retry if it was odd or changed, so a reader on
+ * either core never makes the writer wait. There must be a single writer at a time: callers
+ * serialise writes with their own mutex.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+template <typename T>
+class SeqLock {
+public:
+    SeqLock() : sequence(0), value() {}
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    // Publishes a new value, the caller must be the only writer
+    void write(const T& new_value) {
+        uint32_t seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        value = new_value;
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns a consistent copy of the latest value
+    T read() const {
+        T copy;
+        uint32_t retries = 0;
+        while (true) {
+            uint32_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) == 0) {
+                copy = value;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sequence.load(std::memory_order_relaxed) == before) {
+                    return copy;
+                }
+            }
+            // A higher priority reader preempting the writer on its own core would spin forever
+            if (++retries >= MAX_SPIN_RETRIES) {
+                retries = 0;
+                vTaskDelay(1);
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t MAX_SPIN_RETRIES = 64;
+
+    std::atomic<uint32_t> sequence;   // Odd while a write is in progress
+    T value;
+};
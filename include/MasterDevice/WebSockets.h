@@ -10,25 +10,63 @@
 
 #include <ESPAsyncWebServer.h>
 #include <ArduinoJson.h>
+#include <atomic>
 #include "DataManager.h"
+#include "HistoryQuery.h"
+#include "JsonWriter.h"
+
+// Rooms waiting to be published are kept as bits of one word
+static_assert(MAX_ROOMS <= 32, "dirtyRooms holds one bit per room");
 
 // Class to manage WebSocket connections and messaging
 class WebSockets {
 public:
     WebSockets(DataManager& dataManager);
     void initialize(AsyncWebServer& server);
-    void sendDataUpdate(uint8_t room_id);
+
+    // Marks a room as changed, it goes out with the next flushUpdates(). Safe to call from any task
+    void publishRoom(uint8_t room_id);
+
+    // Sends the fields that changed in the rooms marked since the last call, all in one "updates" message.
+    // Each room carries a version that grows by one per delta. Called each WEB_SERVER_PERIOD
+    void flushUpdates();
+
     void setSleepDurationCallback(void (*callback)(uint8_t, uint32_t));
     void setScheduleCallback(void (*callback)(uint8_t room_id, uint8_t warm_hour, 
                              uint8_t warm_min, uint8_t cold_hour, uint8_t cold_min));
     void setLightsToggleCallback(void (*callback)(uint8_t, bool));
+    void setSceneCallback(bool (*callback)(uint16_t room_mask, SceneCommand command, bool turn_on,
+                          Time warm, Time cold));
+
+    // Reports to every client which rooms applied a scene
+    void sendSceneResult(uint8_t scene_id, uint16_t acked_mask, uint16_t failed_mask);
 
 private:
     AsyncWebSocket ws;                  // WebSocket instance
     DataManager& dataManager;           // Reference to DataManager
+    HistoryQuery historyQuery;          // Range queries and their cache for "getHistory"
     void (*sleepDurationCallback)(uint8_t, uint32_t); // Callback for sleep period changes
     void (*scheduleCallback)(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t); // Callback for schedule changes
     void (*lightsToggleCallback)(uint8_t, bool);
+    bool (*sceneCallback)(uint16_t, SceneCommand, bool, Time, Time); // Callback for multi-room scenes
+    std::atomic<uint32_t> dirtyRooms;   // Bit per room changed since the last flushUpdates()
+
+    // Last state sent to the clients for a room, deltas are computed against it
+    struct PublishedRoom {
+        uint32_t version;               // 0 until the room is first published
+        RoomSummary state;
+    };
+
+    // One element of an "updates" or "snapshot" message
+    struct RoomDelta {
+        uint8_t room_id;
+        uint32_t version;
+        uint16_t fields;                // RoomField bits to write
+        RoomSummary state;
+    };
+
+    SemaphoreHandle_t publishMutex;     // Protects published and orders deltas and snapshots
+    PublishedRoom published[MAX_ROOMS];
 
     // Handles incoming WebSocket events
     void onEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
@@ -43,12 +81,28 @@ private:
     // Processes the "setSchedule" action
     void handleSetSchedule(AsyncWebSocketClient* client, JsonObject& doc);
 
-    // Sends historical data to a client for a specific room
-    void sendHistoryData(AsyncWebSocketClient* client, uint8_t room_id);
+    // Sends historical data to a client for a time range of a room, raw samples or min/max/avg buckets,
+    // as a HistoryFrame if binary is set and JSON otherwise
+    void sendHistoryData(AsyncWebSocketClient* client, const HistoryRequest& request, bool binary);
 
     // Manages lights toggle petition from the user
     void handleToggleLights(AsyncWebSocketClient* client, JsonObject& root);
 
+    // Processes the "scene" action, one command for several rooms
+    void handleScene(AsyncWebSocketClient* client, JsonObject& root);
+
+    // Processes the "addRoom" action, the room is kept in ROOMS_CONFIG_PATH
+    void handleAddRoom(AsyncWebSocketClient* client, JsonObject& root);
+
+    // Writes an "updates" or "snapshot" message, or measures it when the writer has no buffer
+    void writeRooms(JsonWriter& writer, const char* type, const RoomDelta* deltas, uint8_t count) const;
+
+    // Writes the message into a socket buffer of its exact size. Returns nullptr if there is no memory
+    AsyncWebSocketMessageBuffer* makeRoomsMessage(const char* type, const RoomDelta* deltas, uint8_t count);
+
+    // Sends every published room with all its fields and current version to one client
+    void sendSnapshot(AsyncWebSocketClient* client);
+
     // Sends an error message to a client
     void sendError(AsyncWebSocketClient* client, const char* message);
 };
\ No newline at end of file
@@ -1,6 +1,6 @@
 /**
  * @file RoomNodeCommunications.h
- * @brief Handles communication for RoomNode, waiting for ACK messages from Master.
+ * @brief Handles communication for RoomNode, sharing the radio with other tasks through radioMutex.
  * 
  * @author Luis Moreno
  * @date Dec 8, 2024
@@ -15,21 +15,16 @@ class RoomCommunications : public CommunicationsBase {
 public:
     RoomCommunications(SemaphoreHandle_t* radioMutex);
 
-    // Waits for an ACK of a given type or times out
-    bool waitForAck(MessageType expected_ack, unsigned long timeout_ms);
+    // Sends a message to the master (assumes one peer) and waits until it is ACKed or given up on
+    bool sendToMaster(const uint8_t *data, size_t size);
 
-    // Called when an ACK is received, signals semaphore if it matches
-    void ackReceived(uint8_t *mac_addr, MessageType acked_msg);
+    // Sends a message to the master reliably without waiting for the outcome
+    bool postToMaster(const uint8_t *data, size_t size);
 
-    // Sends a message to the master (assumes one peer)
-    bool sendMsg(const uint8_t *data, size_t size);
+protected:
+    // Takes radioMutex around every transmission, retransmissions included
+    bool transmit(const uint8_t* mac_addr, const uint8_t* data, size_t size, TxHandle* handle) override;
 
 private:
-    void onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len) override;
-    int findPeerIndex(uint8_t* mac_addr);
-
-    volatile bool ack_received;
-    MessageType last_acked_msg;
-    SemaphoreHandle_t ackSemaphore;
     SemaphoreHandle_t* radioMutex;
 };
\ No newline at end of file
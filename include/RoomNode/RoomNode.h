@@ -12,12 +12,15 @@
 #include "Common/common.h"
 #include "config.h"
 #include "Common/NTPClient.h"
+#include "Common/MessageDispatcher.h"
 #include "RoomCommunications.h"
 #include "LD2410.h"
 #include "Lights.h"
 #include "Common/secrets.h"
 #include "AirConditioner.h"
 
+constexpr uint32_t NO_ROUND_TRIP = UINT32_MAX; // The round trip of an ACK could not be measured
+
 class RoomNode {
 public:
     RoomNode(uint8_t room_id);
@@ -32,7 +35,6 @@ public:
     void run();
 
 private:
-    const uint32_t HEARTBEAT_TIMEOUT = 2000;
     NTPClient ntpClient;
     RoomCommunications communications;
     LD2410 presenceSensor;
@@ -44,30 +46,47 @@ private:
     uint8_t room_id;
     bool connected;
     bool user_stop;
+    static constexpr int32_t CLOCK_LOG_THRESHOLD_MS = 1000; // Smaller corrections are routine drift
+    static constexpr uint16_t NO_SCENE = 0x100;
+    uint16_t last_scene_id; // Last scene applied, retransmissions of it are only ACKed again
     Time cold;
     Time warm;
 
-    QueueHandle_t espnowQueue;
+    IngressRing ingress;
     QueueHandle_t presenceQueue;
     QueueHandle_t lightsToggleQueue;
 
     TaskHandle_t espnowTaskHandle;
     TaskHandle_t lightsControlTaskHandle;
     TaskHandle_t presenceTaskHandle;
-    TaskHandle_t NTPSyncTaskHandle;
     TaskHandle_t HeartBeatTaskHandle;
     TaskHandle_t LightsToggleTaskHandle;
 
     SemaphoreHandle_t radioMutex;
 
+    MessageDispatcher<RoomNode> dispatcher; // Routes incoming frames to the on*() handlers
+
     // Task functions
     static void espnowTask(void* pvParameter);
     static void lightsControlTask(void* pvParameter);
     static void presenceTask(void* pvParameter);
-    static void NTPSyncTask(void* pvParameter);
     static void heartbeatTask(void* pvParameter);
     static void lightsToggleTask(void* pvParameter);
 
+    // Fills the dispatcher table, one registration per handled message
+    void registerHandlers();
+
+    // Handlers of incoming messages, called with frames already validated by the dispatcher
+    void onAck(const IncomingMsg& frame, const AckMsg& msg);
+    void onNewSchedule(const IncomingMsg& frame, const NewScheduleMsg& msg);
+    void onLightsToggle(const IncomingMsg& frame, const LightsToggleMsg& msg);
+    void onScene(const IncomingMsg& frame, const SceneMsg& msg);
+    void onBeacon(const IncomingMsg& frame, const BeaconMsg& msg);
+
+    // Sets the clock from the time option of an ACK, compensating its transit delay with round_trip_ms,
+    // the round trip of the ACKed frame, or NO_ROUND_TRIP to use the estimate of earlier exchanges
+    void setClock(const IncomingMsg& frame, const EpochTime& master_time, uint32_t round_trip_ms);
+
     // If initialization fails, sleeps to retry later
     void tryLater();
 
@@ -8,35 +8,27 @@
 #pragma once
 
 #include "Common/CommunicationsBase.h"
-#include <freertos/semphr.h>
 #include "PowerManager.h"
 
 class ESPNowHandler : public CommunicationsBase {
 public:
-    // Signals if a delay is needed, to make sure the NEW_SLEEP_PERIOD ACK is sent
-    bool wait_for_send;
-    
     // Constructs with reference to PowerManager for sleep updates
     ESPNowHandler(PowerManager& powerManager);
 
     // Initializes ESP-NOW and attempts to communicate with master
     bool initializeESPNOW(const uint8_t* master_mac_address, const uint8_t channel);
 
-    // Sends a message to the master
-    void sendMsg(const uint8_t* data, size_t size);
-
-    // Waits for an ACK of the specified type within a timeout
-    bool waitForAck(MessageType expected_ack, unsigned long timeout_ms);
+    // Sends a message to the master and waits until it is ACKed or all transmissions fail
+    bool sendToMaster(const uint8_t* data, size_t size);
 
 private:
-    // Handles incoming data; if ACK or new sleep period, process accordingly
+    // Handles incoming data; ACKs complete sent frames and carry configuration options
     void onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len) override;
 
-    PowerManager& powerManager;
+    // Applies the options of an ACK that concern the SensorNode
+    void applyAckOptions(const AckMsg& ack, size_t len);
 
-    volatile bool ack_received;
-    MessageType last_acked_msg;
-    SemaphoreHandle_t ackSemaphore; // Signals when ACK is received
+    PowerManager& powerManager;
 
     static ESPNowHandler* instance;
 };
\ No newline at end of file
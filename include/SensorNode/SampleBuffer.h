@@ -0,0 +1,58 @@
+/**
+ * @file SampleBuffer.h
+ * @brief Ring buffer of sensor readings kept in RTC memory across deep sleep cycles
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "Common/common.h"
+#include "Common/SampleCodec.h"
+
+// Reading stored with the node clock, which keeps running during deep sleep
+struct BufferedSample {
+    uint32_t taken_at_s;
+    int16_t temperature; // Centi-degrees Celsius
+    uint16_t humidity;   // Centi-percent relative humidity
+};
+
+// Plain data so it can live in RTC_DATA_ATTR memory, zero-initialized on cold boot
+class SampleBuffer {
+public:
+    // Stores a reading, overwriting the oldest one when full
+    void push(uint32_t taken_at_s, int16_t temperature, uint16_t humidity);
+
+    // Copies up to max_samples of the oldest readings into out, with ages relative to now_s
+    uint8_t fill(SampleRecord* out, uint8_t max_samples, uint32_t now_s) const;
+
+    // Encodes the oldest readings until the encoder is full, returns how many were encoded
+    uint8_t encode(SampleEncoder& encoder, uint32_t now_s) const;
+
+    // Discards the n oldest readings once they have been acknowledged
+    void drop(uint16_t n);
+
+    // Counts a wake-up since the last successful uplink
+    void countWake();
+
+    // Resets the wake counter after a successful uplink
+    void uplinkDone();
+
+    // True when enough wakes have passed or a full frame is waiting
+    bool uplinkDue() const;
+
+    uint16_t size() const;
+    bool isEmpty() const;
+
+private:
+    BufferedSample samples[SAMPLE_BUFFER_CAPACITY];
+    uint16_t head;               // Index of the oldest reading
+    uint16_t count;              // Number of buffered readings
+    uint8_t wakes_since_uplink;
+    uint32_t overwritten;        // Readings lost because the buffer was full
+
+    // Returns the i-th oldest reading with its age relative to now_s
+    SampleRecord toRecord(uint16_t i, uint32_t now_s) const;
+};
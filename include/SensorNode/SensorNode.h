@@ -10,16 +10,24 @@
 #include "SHT31Sensor.h"
 #include "ESPNowHandler.h"
 #include "PowerManager.h"
+#include "SampleBuffer.h"
 #include "esp_wifi.h"
 
 constexpr uint8_t SHT31_ADDRESS = 0x44;
 constexpr uint8_t SDA_PIN = 21;
 constexpr uint8_t SCL_PIN = 22;
 
+// Transport state of the link to the master, kept in RTC memory across deep sleep
+struct MasterLink {
+    uint8_t tx_seq;   // Next frame sequence number, so the master can spot retransmissions
+    RttEstimator rtt; // Round-trip time to the master, so every wake-up starts with a measured timeout
+};
+
 class SensorNode {
 public:
-    // Constructs with room ID, pointers to stored settings, and first_cycle flag
-    SensorNode(uint8_t room_id, uint32_t* sleep_duration, uint8_t* channel_wifi, bool* first_cycle);
+    // Constructs with room ID, pointers to stored settings, first_cycle flag, RTC sample buffer and link state
+    SensorNode(uint8_t room_id, uint32_t* sleep_duration, uint8_t* channel_wifi, bool* first_cycle,
+               SampleBuffer* sample_buffer, MasterLink* link);
 
     // Initializes sensor and ESP-NOW communication
     bool initialize();
@@ -40,10 +48,22 @@ private:
     PowerManager powerManager;
     uint8_t* channel_wifi;
     bool* first_cycle;
+    SampleBuffer* sample_buffer;
+    MasterLink* link; // Sequence number and round-trip time of previous wake-ups
+    bool just_joined; // Forces an uplink right after joining so the master learns the uplink interval
+
+    // Registers the master as peer, continuing the sequence numbers and RTT estimate of previous wake-ups
+    void registerMaster(uint8_t channel);
+
+    // Sends a single reading as a TEMP_HUMID message
+    bool sendSample(float temperature, float humidity);
+
+    // Sends every buffered reading in as few batch frames as possible
+    bool sendBufferedSamples();
 
-    // Sends sensor data message
-    void sendData();
+    // Sends the oldest buffered readings in one TEMP_HUMID_BATCH frame, returns how many were acknowledged
+    uint8_t sendBatchFrame();
 
-    // Waits for an ACK after sending a message
-    bool waitForAck();
+    // Same as sendBatchFrame, but compressed in a TEMP_HUMID_PACKED frame
+    uint8_t sendPackedFrame();
 };
\ No newline at end of file
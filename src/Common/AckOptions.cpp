@@ -0,0 +1,101 @@
+/**
+ * @file AckOptions.cpp
+ * @brief Implementation of the TLV options carried by AckMsg frames
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "Common/AckOptions.h"
+#include "config.h"
+#include <string.h>
+
+AckOptions::AckOptions() : used(0) {}
+
+bool AckOptions::add(AckOption type, const void* value, uint8_t len) {
+    if (used + ACK_OPTION_HEADER_SIZE + len > MAX_ACK_OPTIONS_SIZE) {
+        LOG_WARNING("ACK option %u does not fit, %u of %u bytes used", static_cast<uint8_t>(type), used,
+                    MAX_ACK_OPTIONS_SIZE);
+        return false;
+    }
+    buffer[used++] = static_cast<uint8_t>(type);
+    buffer[used++] = len;
+    memcpy(buffer + used, value, len);
+    used += len;
+    return true;
+}
+
+bool AckOptions::addSleepPeriod(uint32_t sleep_period_ms) {
+    return add(AckOption::SLEEP_PERIOD, &sleep_period_ms, sizeof(sleep_period_ms));
+}
+
+bool AckOptions::addEpochTime(const EpochTime& time) {
+    return add(AckOption::EPOCH_TIME, &time, sizeof(time));
+}
+
+bool AckOptions::addSchedule(const Time& warm, const Time& cold) {
+    Time schedule[2] = {warm, cold};
+    return add(AckOption::SCHEDULE, schedule, sizeof(schedule));
+}
+
+const uint8_t* AckOptions::data() const {
+    return buffer;
+}
+
+uint8_t AckOptions::size() const {
+    return used;
+}
+
+bool AckOptions::contains(AckOption type) const {
+    for (uint8_t pos = 0; pos + ACK_OPTION_HEADER_SIZE <= used; pos += ACK_OPTION_HEADER_SIZE + buffer[pos + 1]) {
+        if (buffer[pos] == static_cast<uint8_t>(type)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+AckOptionReader::AckOptionReader(const AckMsg& ack, size_t frame_len)
+    : data(ack.options), len(frame_len > ACK_HEADER_SIZE ? frame_len - ACK_HEADER_SIZE : 0), pos(0) {}
+
+bool AckOptionReader::next(AckOption& type, const uint8_t*& value, uint8_t& value_len) {
+    if (pos + ACK_OPTION_HEADER_SIZE > len) {
+        return false;
+    }
+    uint8_t option_len = data[pos + 1];
+    if (pos + ACK_OPTION_HEADER_SIZE + option_len > len) {
+        LOG_WARNING("Truncated ACK option %u ignored", data[pos]);
+        pos = len;
+        return false;
+    }
+    type = static_cast<AckOption>(data[pos]);
+    value = data + pos + ACK_OPTION_HEADER_SIZE;
+    value_len = option_len;
+    pos += ACK_OPTION_HEADER_SIZE + option_len;
+    return true;
+}
+
+bool AckOptionReader::readU32(const uint8_t* value, uint8_t len, uint32_t& out) {
+    if (len != sizeof(uint32_t)) {
+        return false;
+    }
+    memcpy(&out, value, sizeof(out));
+    return true;
+}
+
+bool AckOptionReader::readEpochTime(const uint8_t* value, uint8_t len, EpochTime& time) {
+    if (len != sizeof(EpochTime)) {
+        return false;
+    }
+    memcpy(&time, value, sizeof(time));
+    return true;
+}
+
+bool AckOptionReader::readSchedule(const uint8_t* value, uint8_t len, Time& warm, Time& cold) {
+    if (len != 2 * sizeof(Time)) {
+        return false;
+    }
+    memcpy(&warm, value, sizeof(Time));
+    memcpy(&cold, value + sizeof(Time), sizeof(Time));
+    return true;
+}
@@ -14,15 +14,49 @@
 
 CommunicationsBase* CommunicationsBase::instance = nullptr;
 
-CommunicationsBase::CommunicationsBase() : numPeers(0) {
+// Completion of a reliable frame, collected under peerMutex and reported once it is released
+struct SendCompletion {
+    SendCallback callback;
+    void* context;
+    MessageType type;
+    bool delivered;
+};
+
+// Calls the completion callbacks collected while peerMutex was held
+static void reportCompletions(const uint8_t* mac_addr, const SendCompletion* completions, int count) {
+    for (int i = 0; i < count; ++i) {
+        if (!completions[i].delivered) {
+            LOG_WARNING("%s message to %02X:%02X:%02X:%02X:%02X:%02X was not acknowledged",
+                        MSG_NAME[static_cast<uint8_t>(completions[i].type)],
+                        mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+        }
+        if (completions[i].callback) {
+            completions[i].callback(completions[i].context, mac_addr, completions[i].type, completions[i].delivered);
+        }
+    }
+}
+
+// Takes a window slot out of use and describes its outcome
+static SendCompletion releaseFrame(PendingFrame& frame, bool delivered) {
+    frame.in_use = false;
+    return {frame.callback, frame.context, static_cast<MessageType>(frame.data[0]), delivered};
+}
+
+CommunicationsBase::CommunicationsBase()
+    : ingress(nullptr), numPeers(0), driverPeers(0), peerClock(0), transportTaskHandle(nullptr),
+      transportEvents(nullptr), txIssued(0), txResolved(0), duplicateFrames(0) {
     instance = this;
     peerMutex = xSemaphoreCreateMutex();
-
-    // Initialize peers array
-    for (int i = 0; i < MAX_PEERS; ++i) {
-        memset(peers[i].mac_addr, 0, MAC_ADDRESS_LENGTH);
-        memset(&peers[i].peer_info, 0, sizeof(esp_now_peer_info_t));
-    }
+    beaconSemaphore = xSemaphoreCreateBinary();
+    beaconChannel = 0;
+    txMutex = xSemaphoreCreateMutex();
+    txSemaphore = xSemaphoreCreateBinary();
+    transportEvents = xQueueCreate(TRANSPORT_EVENT_SLOTS, sizeof(TransportEvent));
+    memset(txRecords, 0, sizeof(txRecords));
+
+    // Initialize peers array and index
+    memset(peers, 0, sizeof(peers));
+    memset(peerIndex, 0, sizeof(peerIndex));
 }
 
 CommunicationsBase::~CommunicationsBase() {
@@ -31,6 +65,22 @@ CommunicationsBase::~CommunicationsBase() {
         vSemaphoreDelete(peerMutex);
         peerMutex = nullptr;
     }
+    if (beaconSemaphore != nullptr) {
+        vSemaphoreDelete(beaconSemaphore);
+        beaconSemaphore = nullptr;
+    }
+    if (txMutex != nullptr) {
+        vSemaphoreDelete(txMutex);
+        txMutex = nullptr;
+    }
+    if (txSemaphore != nullptr) {
+        vSemaphoreDelete(txSemaphore);
+        txSemaphore = nullptr;
+    }
+    if (transportEvents != nullptr) {
+        vQueueDelete(transportEvents);
+        transportEvents = nullptr;
+    }
 
     instance = nullptr;
 }
@@ -73,8 +123,14 @@ bool CommunicationsBase::initializeESPNOW() {
         return false;
     }
 
-    // Register receive callback
+    // Register receive and send status callbacks
     esp_now_register_recv_cb(CommunicationsBase::onDataRecvStatic);
+    esp_now_register_send_cb(CommunicationsBase::onDataSentStatic);
+
+    // Start the retransmission timer of the reliable transport
+    if (transportTaskHandle == nullptr) {
+        xTaskCreate(transportTask, "Transport Task", 4096, this, 2, &transportTaskHandle);
+    }
 
     LOG_INFO("ESP-NOW initialized");
     return true;
@@ -90,33 +146,44 @@ bool CommunicationsBase::registerPeer(uint8_t* mac_address, uint8_t wifi_channel
         return false;
     }
 
-    if (numPeers >= MAX_PEERS) {
-        LOG_INFO("Maximum number of peers reached.");
+    // Check if peer already exists
+    if (findPeer(mac_address) != nullptr) {
+        LOG_INFO("Peer already registered.");
         xSemaphoreGive(peerMutex);
         return false;
     }
 
-    // Check if peer already exists
-    for (int i = 0; i < numPeers; ++i) {
-        if (memcmp(peers[i].mac_addr, mac_address, MAC_ADDRESS_LENGTH) == 0) {
-            LOG_INFO("Peer already registered.");
-            xSemaphoreGive(peerMutex);
-            return false;
+    int slot = -1;
+    for (int i = 0; i < MAX_PEERS; ++i) {
+        if (!peers[i].in_use) {
+            slot = i;
+            break;
         }
     }
+    if (slot < 0) {
+        LOG_WARNING("Maximum number of peers reached.");
+        xSemaphoreGive(peerMutex);
+        return false;
+    }
 
-    // Add the new peer
-    memcpy(peers[numPeers].mac_addr, mac_address, MAC_ADDRESS_LENGTH);
-    memcpy(peers[numPeers].peer_info.peer_addr, mac_address, MAC_ADDRESS_LENGTH);
-    peers[numPeers].peer_info.channel = wifi_channel;
-    peers[numPeers].peer_info.encrypt = false;
-
-    if (esp_now_add_peer(&peers[numPeers].peer_info) != ESP_OK) {
+    // Add the new peer with a fresh transport state
+    Peer& peer = peers[slot];
+    memset(&peer, 0, sizeof(Peer));
+    memcpy(peer.mac_addr, mac_address, MAC_ADDRESS_LENGTH);
+    memcpy(peer.peer_info.peer_addr, mac_address, MAC_ADDRESS_LENGTH);
+    peer.peer_info.channel = wifi_channel;
+    peer.peer_info.encrypt = false;
+    peer.last_used = ++peerClock;
+
+    // Added to the driver now so the first frame does not pay for it, it may be evicted again later
+    if (!ensureInDriver(peer)) {
         LOG_ERROR("Failed to add peer");
         xSemaphoreGive(peerMutex);
         return false;
     }
 
+    peer.in_use = true;
+    indexPeer(slot);
     numPeers++;
 
     LOG_INFO("Peer registered: ");
@@ -138,44 +205,110 @@ bool CommunicationsBase::unregisterPeer(uint8_t* mac_address) {
         return false;
     }
 
-    // Find the peer in the list
-    for (int i = 0; i < numPeers; ++i) {
-        if (memcmp(peers[i].mac_addr, mac_address, MAC_ADDRESS_LENGTH) == 0) {
-            // Remove the peer from ESP-NOW
-            if (esp_now_del_peer(mac_address) != ESP_OK) {
-                LOG_ERROR("Failed to remove peer from ESP-NOW.");
-                xSemaphoreGive(peerMutex);
-                return false;
-            }
-
-            // Shift remaining peers to fill the gap
-            for (int j = i; j < numPeers - 1; ++j) {
-                peers[j] = peers[j + 1];
-            }
-
-            // Clear the last peer entry
-            memset(&peers[numPeers - 1], 0, sizeof(Peer));
-
-            numPeers--;
-            LOG_INFO("Peer unregistered successfully.");
+    Peer* peer = findPeer(mac_address);
+    if (peer == nullptr) {
+        LOG_WARNING("Peer not found.");
+        xSemaphoreGive(peerMutex);
+        return false;
+    }
 
+    // Remove the peer from ESP-NOW
+    if (peer->in_driver) {
+        if (esp_now_del_peer(mac_address) != ESP_OK) {
+            LOG_ERROR("Failed to remove peer from ESP-NOW.");
             xSemaphoreGive(peerMutex);
-            return true;
+            return false;
         }
+        driverPeers--;
     }
 
-    LOG_WARNING("Peer not found.");
+    // Frames still waiting for an ACK can no longer be delivered
+    SendCompletion failed[SEND_WINDOW_SIZE];
+    int num_failed = 0;
+    for (PendingFrame& frame : peer->window) {
+        if (frame.in_use) {
+            failed[num_failed++] = releaseFrame(frame, false);
+        }
+    }
+
+    // The other peers keep their slots
+    unindexPeer(peer - peers);
+    memset(peer, 0, sizeof(Peer));
+    numPeers--;
+    LOG_INFO("Peer unregistered successfully.");
+
     xSemaphoreGive(peerMutex);
-    return false;
+    reportCompletions(mac_address, failed, num_failed);
+    return true;
 }
 
 // Sends a message to a specified peer
-bool CommunicationsBase::sendMsg(uint8_t* mac_addr, const uint8_t* data, size_t size) {
-    esp_err_t result = esp_now_send(mac_addr, data, size);
+bool CommunicationsBase::sendMsg(uint8_t* mac_addr, const uint8_t* data, size_t size, TxHandle* handle) {
+    return transmit(mac_addr, data, size, handle);
+}
+
+// Broadcast frames need the broadcast address registered in ESP-NOW, it is not kept in the peer list
+bool CommunicationsBase::sendBroadcast(const uint8_t* data, size_t size) {
+    if (!esp_now_is_peer_exist(BROADCAST_MAC_ADDR)) {
+        esp_now_peer_info_t broadcast_info;
+        memset(&broadcast_info, 0, sizeof(broadcast_info));
+        memcpy(broadcast_info.peer_addr, BROADCAST_MAC_ADDR, MAC_ADDRESS_LENGTH);
+        broadcast_info.channel = 0; // Current channel
+        broadcast_info.encrypt = false;
+        if (esp_now_add_peer(&broadcast_info) != ESP_OK) {
+            LOG_ERROR("Failed to add broadcast peer");
+            return false;
+        }
+    }
+    return transmit(BROADCAST_MAC_ADDR, data, size, nullptr);
+}
+
+// Hands a frame to ESP-NOW. Queuing only, the outcome arrives later in onDataSent()
+bool CommunicationsBase::transmit(const uint8_t* mac_addr, const uint8_t* data, size_t size, TxHandle* handle) {
+    if (handle) {
+        *handle = INVALID_TX_HANDLE;
+    }
+
+    TxHandle next;
+    esp_err_t result;
+    // A second attempt covers the peer being evicted from the driver between touchPeer() and the send
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        touchPeer(mac_addr);
+        if (xSemaphoreTake(txMutex, portMAX_DELAY) != pdTRUE) {
+            LOG_WARNING("Failed to take tx mutex.");
+            return false;
+        }
+
+        // The record is written before queuing, the send callback may run before esp_now_send() returns
+        next = txIssued + 1;
+        if (next == INVALID_TX_HANDLE) {
+            next++;
+        }
+        TxRecord& record = txRecords[next % TX_TRACK_SLOTS];
+        record.handle = next;
+        record.type = static_cast<MessageType>(data[0]);
+        record.status = TxStatus::PENDING;
+
+        result = esp_now_send(mac_addr, data, size);
+        if (result == ESP_OK) {
+            __atomic_store_n(&txIssued, next, __ATOMIC_RELEASE);
+        }
+        xSemaphoreGive(txMutex);
+
+        if (result != ESP_ERR_ESPNOW_NOT_FOUND) {
+            break;
+        }
+    }
+
     if (result == ESP_OK) {
-        LOG_INFO("%s message sent successfully to %02X:%02X:%02X:%02X:%02X:%02X\r\n", MSG_NAME[data[0]],
-                      mac_addr[0], mac_addr[1], mac_addr[2],
-                      mac_addr[3], mac_addr[4], mac_addr[5]);
+        if (data[0] != static_cast<uint8_t>(MessageType::BEACON)) { // Beacons would flood the log
+            LOG_INFO("%s message queued for %02X:%02X:%02X:%02X:%02X:%02X\r\n", MSG_NAME[data[0]],
+                          mac_addr[0], mac_addr[1], mac_addr[2],
+                          mac_addr[3], mac_addr[4], mac_addr[5]);
+        }
+        if (handle) {
+            *handle = next;
+        }
         return true;
     } else {
         LOG_ERROR("Error sending message: %d", result);
@@ -183,17 +316,583 @@ bool CommunicationsBase::sendMsg(uint8_t* mac_addr, const uint8_t* data, size_t
     }
 }
 
+// Stamps the peer's next sequence number on a copy of the message and keeps it until it is ACKed
+bool CommunicationsBase::sendReliable(const uint8_t* mac_addr, const uint8_t* data, size_t size,
+                                      SendCallback callback, void* context) {
+    if (size < sizeof(MsgHeader) || size > MAX_MSG_SIZE) {
+        LOG_ERROR("Invalid reliable message size: %u", (unsigned)size);
+        return false;
+    }
+
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) != pdTRUE) {
+        LOG_WARNING("Failed to take peer mutex.");
+        return false;
+    }
+
+    Peer* peer = findPeer(mac_addr);
+    if (peer == nullptr) {
+        xSemaphoreGive(peerMutex);
+        LOG_WARNING("Reliable send to unregistered peer.");
+        return false;
+    }
+
+    PendingFrame* frame = nullptr;
+    for (PendingFrame& slot : peer->window) {
+        if (!slot.in_use) {
+            frame = &slot;
+            break;
+        }
+    }
+    if (frame == nullptr) {
+        xSemaphoreGive(peerMutex);
+        LOG_WARNING("Send window full, %s message not sent", MSG_NAME[data[0]]);
+        return false;
+    }
+
+    frame->in_use = true;
+    frame->seq = peer->tx_seq++;
+    frame->transmissions = 1;
+    frame->len = size;
+    frame->sent_at_ms = millis();
+    frame->timeout_ms = peer->rtt.timeout();
+    frame->callback = callback;
+    frame->context = context;
+    memcpy(frame->data, data, size);
+    reinterpret_cast<MsgHeader*>(frame->data)->seq = frame->seq;
+
+    // Transmit a copy, the slot may be completed and reused as soon as the mutex is released
+    uint8_t buffer[MAX_MSG_SIZE];
+    memcpy(buffer, frame->data, size);
+    xSemaphoreGive(peerMutex);
+
+    transmit(mac_addr, buffer, size, nullptr);
+    return true;
+}
+
+// Wakes the task blocked in sendAndWait
+struct SendWaiter {
+    TaskHandle_t task;
+    volatile bool delivered;
+};
+
+static void wakeSendWaiter(void* context, const uint8_t* mac_addr, MessageType type, bool delivered) {
+    SendWaiter* waiter = static_cast<SendWaiter*>(context);
+    waiter->delivered = delivered;
+    xTaskNotifyGive(waiter->task);
+}
+
+// Sends a reliable message and blocks until its completion callback runs
+bool CommunicationsBase::sendAndWait(const uint8_t* mac_addr, const uint8_t* data, size_t size) {
+    SendWaiter waiter{xTaskGetCurrentTaskHandle(), false};
+    if (!sendReliable(mac_addr, data, size, wakeSendWaiter, &waiter)) {
+        return false;
+    }
+
+    // Every frame is completed, at the latest once it runs out of transmissions
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    return waiter.delivered;
+}
+
+// Hands an ACK received from a peer to the transport task, which completes the frames it covers
+void CommunicationsBase::handleAck(const uint8_t* mac_addr, const AckMsg& ack) {
+    LOG_INFO("ACK received for %s message (seq %u)", MSG_NAME[static_cast<uint8_t>(ack.acked_msg)], ack.acked_seq);
+    TransportEvent event;
+    event.kind = TransportEvent::ACKED;
+    memcpy(event.mac_addr, mac_addr, MAC_ADDRESS_LENGTH);
+    event.delivered = true;
+    event.acked_seq = ack.acked_seq;
+    event.sack = ack.sack;
+    postTransportEvent(event);
+}
+
+// Looks up the frame without completing it, the transport task does that when the ACK event arrives
+bool CommunicationsBase::ackRoundTrip(const uint8_t* mac_addr, uint8_t acked_seq, uint32_t received_ms,
+                                      uint32_t& rtt_ms) {
+    bool found = false;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            for (const PendingFrame& frame : peer->window) {
+                if (frame.in_use && frame.seq == acked_seq) {
+                    rtt_ms = received_ms - frame.sent_at_ms;
+                    found = true;
+                    break;
+                }
+            }
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return found;
+}
+
+// Releases the frames of a peer matching acked_seq or one of the SACK bits
+void CommunicationsBase::completeFrames(const uint8_t* mac_addr, uint8_t acked_seq, uint8_t sack) {
+    SendCompletion delivered[SEND_WINDOW_SIZE];
+    int num_delivered = 0;
+
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) != pdTRUE) {
+        LOG_WARNING("Failed to take peer mutex.");
+        return;
+    }
+
+    uint32_t now = millis();
+    Peer* peer = findPeer(mac_addr);
+    if (peer != nullptr) {
+        for (PendingFrame& frame : peer->window) {
+            if (!frame.in_use) {
+                continue;
+            }
+            uint8_t distance = acked_seq - frame.seq;
+            if (distance == 0 && frame.transmissions == 1) {
+                // Only an ACK of the one transmission times it, SACK bits arrive late (Karn's rule)
+                peer->rtt.addSample(now - frame.sent_at_ms);
+            }
+            if (distance == 0 || (distance <= 8 && (sack & (1 << (distance - 1))))) {
+                delivered[num_delivered++] = releaseFrame(frame, true);
+            }
+        }
+    }
+
+    xSemaphoreGive(peerMutex);
+    reportCompletions(mac_addr, delivered, num_delivered);
+}
+
 // Sends an acknowledgment message to a specified peer
-void CommunicationsBase::sendAck(const uint8_t* mac_addr, MessageType acked_msg) {
+TxHandle CommunicationsBase::sendAck(const uint8_t* mac_addr, MessageType acked_msg, uint8_t acked_seq,
+                                     const AckOptions* options) {
     AckMsg ack;
-    ack.type = MessageType::ACK;
     ack.acked_msg = acked_msg;
-    sendMsg((uint8_t*)mac_addr, reinterpret_cast<uint8_t*>(&ack), sizeof(ack));
+    ack.acked_seq = acked_seq;
+    ack.sack = 0;
+
+    size_t size = ACK_HEADER_SIZE;
+    if (options != nullptr) {
+        memcpy(ack.options, options->data(), options->size());
+        size += options->size();
+    }
+
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            ack.sack = recordReceived(*peer, acked_seq);
+        }
+        xSemaphoreGive(peerMutex);
+    }
+
+    TxHandle handle;
+    transmit(mac_addr, reinterpret_cast<uint8_t*>(&ack), size, &handle);
+    return handle;
+}
+
+// Checks the receive history, which sendAck() fills, for a frame already acknowledged
+bool CommunicationsBase::isDuplicate(const uint8_t* mac_addr, uint8_t seq) {
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+
+    bool duplicate = false;
+    Peer* peer = findPeer(mac_addr);
+    if (peer != nullptr && alreadyReceived(*peer, seq)) {
+        peer->rx_duplicates++;
+        duplicateFrames++;
+        duplicate = true;
+    }
+
+    xSemaphoreGive(peerMutex);
+    return duplicate;
+}
+
+// Starts a new receive session for a peer
+void CommunicationsBase::resetSession(const uint8_t* mac_addr) {
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            peer->rx_valid = false;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+}
+
+// Gets the sequence number the next reliable frame to a peer will use
+bool CommunicationsBase::getNextSeq(const uint8_t* mac_addr, uint8_t& seq) {
+    bool found = false;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            seq = peer->tx_seq;
+            found = true;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return found;
+}
+
+// Sets the sequence number the next reliable frame to a peer will use
+bool CommunicationsBase::setNextSeq(const uint8_t* mac_addr, uint8_t seq) {
+    bool found = false;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            peer->tx_seq = seq;
+            found = true;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return found;
+}
+
+// Copies the round-trip time estimate of a peer
+bool CommunicationsBase::getRtt(const uint8_t* mac_addr, RttEstimator& rtt) {
+    bool found = false;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            rtt = peer->rtt;
+            found = true;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return found;
+}
+
+// Restores the round-trip time estimate of a peer
+bool CommunicationsBase::setRtt(const uint8_t* mac_addr, const RttEstimator& rtt) {
+    bool found = false;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            peer->rtt = rtt;
+            found = true;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return found;
+}
+
+// Resolved handles keep their outcome until the record is reused TX_TRACK_SLOTS frames later
+TxStatus CommunicationsBase::getTxStatus(TxHandle handle) const {
+    if (handle == INVALID_TX_HANDLE) {
+        return TxStatus::FAILED;
+    }
+    TxHandle resolved = __atomic_load_n(&txResolved, __ATOMIC_ACQUIRE);
+    if (static_cast<int32_t>(handle - resolved) > 0) {
+        return TxStatus::PENDING;
+    }
+    const TxRecord& record = txRecords[handle % TX_TRACK_SLOTS];
+    return record.handle == handle ? record.status : TxStatus::UNKNOWN;
+}
+
+// Waits for the send callback of one frame
+TxStatus CommunicationsBase::waitForTx(TxHandle handle, uint32_t timeout_ms) {
+    uint32_t start = millis();
+    TxStatus status = getTxStatus(handle);
+    while (status == TxStatus::PENDING && millis() - start < timeout_ms) {
+        xSemaphoreTake(txSemaphore, 1); // Every report gives it, the tick timeout covers other waiters taking it
+        status = getTxStatus(handle);
+    }
+    return status;
+}
+
+// Waits until the radio has reported the last frame queued
+bool CommunicationsBase::waitForAllTx(uint32_t timeout_ms) {
+    return waitForTx(__atomic_load_n(&txIssued, __ATOMIC_ACQUIRE), timeout_ms) != TxStatus::PENDING;
+}
+
+// Copies the MAC-level delivery counters of a peer
+bool CommunicationsBase::getTxStats(const uint8_t* mac_addr, TxStats& stats) {
+    bool found = false;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            stats = peer->tx_stats;
+            found = true;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return found;
+}
+
+// Returns the total number of retransmissions dropped
+uint32_t CommunicationsBase::getDuplicateCount() const {
+    return duplicateFrames;
+}
+
+// Returns the number of retransmissions dropped for a peer
+uint32_t CommunicationsBase::getDuplicateCount(const uint8_t* mac_addr) {
+    uint32_t count = 0;
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            count = peer->rx_duplicates;
+        }
+        xSemaphoreGive(peerMutex);
+    }
+    return count;
+}
+
+// Checks whether seq is inside the receive history of a peer and marked as received
+bool CommunicationsBase::alreadyReceived(const Peer& peer, uint8_t seq) const {
+    if (!peer.rx_valid) {
+        return false;
+    }
+    uint8_t behind = peer.rx_seq - seq;
+    return behind < 32 && (peer.rx_history & (1UL << behind));
+}
+
+// Updates the receive history of a peer and reports which of the 8 frames before seq were received
+uint8_t CommunicationsBase::recordReceived(Peer& peer, uint8_t seq) {
+    int8_t ahead = static_cast<int8_t>(seq - peer.rx_seq);
+
+    if (!peer.rx_valid || ahead >= 32 || ahead <= -32) {
+        // First frame of the session or too far from the history to relate to it
+        peer.rx_valid = true;
+        peer.rx_seq = seq;
+        peer.rx_history = 1;
+    } else if (ahead > 0) {
+        peer.rx_history = (peer.rx_history << ahead) | 1;
+        peer.rx_seq = seq;
+    } else {
+        peer.rx_history |= 1UL << -ahead;
+    }
+
+    uint8_t behind = peer.rx_seq - seq;
+    uint8_t sack = 0;
+    for (uint8_t i = 0; i < 8 && behind + 1 + i < 32; ++i) {
+        if (peer.rx_history & (1UL << (behind + 1 + i))) {
+            sack |= 1 << i;
+        }
+    }
+    return sack;
 }
 
-// Sets the message queue for incoming messages
-void CommunicationsBase::setQueue(QueueHandle_t queue) {
-    dataQueue = queue;
+// FNV-1a over the address, the low bits select the bucket
+uint16_t CommunicationsBase::hashMac(const uint8_t* mac_addr) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < MAC_ADDRESS_LENGTH; ++i) {
+        hash = (hash ^ mac_addr[i]) * 16777619u;
+    }
+    return hash & (PEER_INDEX_SIZE - 1);
+}
+
+// Stores a slot in the first free bucket from its home bucket
+void CommunicationsBase::indexPeer(uint8_t slot) {
+    uint16_t bucket = hashMac(peers[slot].mac_addr);
+    while (peerIndex[bucket] != 0) {
+        bucket = (bucket + 1) & (PEER_INDEX_SIZE - 1);
+    }
+    peerIndex[bucket] = slot + 1;
+}
+
+// Empties the bucket of a slot and moves back later entries of the probe run, so lookups need no tombstones
+void CommunicationsBase::unindexPeer(uint8_t slot) {
+    uint16_t hole = hashMac(peers[slot].mac_addr);
+    while (peerIndex[hole] != slot + 1) {
+        hole = (hole + 1) & (PEER_INDEX_SIZE - 1);
+    }
+    peerIndex[hole] = 0;
+
+    uint16_t bucket = (hole + 1) & (PEER_INDEX_SIZE - 1);
+    while (peerIndex[bucket] != 0) {
+        uint16_t home = hashMac(peers[peerIndex[bucket] - 1].mac_addr);
+        // The entry can fill the hole unless its home lies cyclically in (hole, bucket]
+        if (((bucket - home) & (PEER_INDEX_SIZE - 1)) >= ((bucket - hole) & (PEER_INDEX_SIZE - 1))) {
+            peerIndex[hole] = peerIndex[bucket];
+            peerIndex[bucket] = 0;
+            hole = bucket;
+        }
+        bucket = (bucket + 1) & (PEER_INDEX_SIZE - 1);
+    }
+}
+
+// Returns the registered peer with the given MAC address
+Peer* CommunicationsBase::findPeer(const uint8_t* mac_addr) {
+    uint16_t bucket = hashMac(mac_addr);
+    while (peerIndex[bucket] != 0) {
+        Peer* peer = &peers[peerIndex[bucket] - 1];
+        if (memcmp(peer->mac_addr, mac_addr, MAC_ADDRESS_LENGTH) == 0) {
+            return peer;
+        }
+        bucket = (bucket + 1) & (PEER_INDEX_SIZE - 1);
+    }
+    return nullptr;
+}
+
+// Marks a registered peer as just used and makes sure the driver holds it
+void CommunicationsBase::touchPeer(const uint8_t* mac_addr) {
+    if (memcmp(mac_addr, BROADCAST_MAC_ADDR, MAC_ADDRESS_LENGTH) == 0) {
+        return;
+    }
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(mac_addr);
+        if (peer != nullptr) {
+            peer->last_used = ++peerClock;
+            if (!ensureInDriver(*peer)) {
+                LOG_ERROR("Failed to add peer to ESP-NOW.");
+            }
+        }
+        xSemaphoreGive(peerMutex);
+    }
+}
+
+// Makes room in the driver by removing the peer that has gone longest without a frame
+bool CommunicationsBase::ensureInDriver(Peer& peer) {
+    if (peer.in_driver) {
+        return true;
+    }
+
+    if (driverPeers >= MAX_DRIVER_PEERS) {
+        Peer* oldest = nullptr;
+        for (Peer& candidate : peers) {
+            if (candidate.in_use && candidate.in_driver &&
+                (oldest == nullptr || static_cast<int32_t>(candidate.last_used - oldest->last_used) < 0)) {
+                oldest = &candidate;
+            }
+        }
+        if (oldest == nullptr || esp_now_del_peer(oldest->mac_addr) != ESP_OK) {
+            LOG_ERROR("Failed to evict a peer from ESP-NOW.");
+            return false;
+        }
+        oldest->in_driver = false;
+        driverPeers--;
+    }
+
+    if (esp_now_add_peer(&peer.peer_info) != ESP_OK) {
+        return false;
+    }
+    peer.in_driver = true;
+    driverPeers++;
+    return true;
+}
+
+// Applies the events of the radio callbacks as they arrive and periodically checks the send windows for expired frames
+void CommunicationsBase::transportTask(void* pvParameters) {
+    CommunicationsBase* self = static_cast<CommunicationsBase*>(pvParameters);
+    uint32_t last_check = millis();
+    while (true) {
+        uint32_t elapsed = millis() - last_check;
+        TickType_t wait = elapsed < RETRANSMIT_CHECK_PERIOD ? pdMS_TO_TICKS(RETRANSMIT_CHECK_PERIOD - elapsed) : 0;
+        TransportEvent event;
+        if (xQueueReceive(self->transportEvents, &event, wait) == pdTRUE) {
+            self->applyTransportEvent(event);
+        }
+        if (millis() - last_check >= RETRANSMIT_CHECK_PERIOD) {
+            last_check = millis();
+            self->serviceRetransmissions();
+        }
+    }
+}
+
+// Does the part of a radio callback that needs peerMutex
+void CommunicationsBase::applyTransportEvent(const TransportEvent& event) {
+    if (event.kind == TransportEvent::ACKED) {
+        completeFrames(event.mac_addr, event.acked_seq, event.sack);
+        return;
+    }
+    if (xSemaphoreTake(peerMutex, portMAX_DELAY) == pdTRUE) {
+        Peer* peer = findPeer(event.mac_addr);
+        if (peer != nullptr) {
+            if (event.delivered) {
+                peer->tx_stats.delivered++;
+            } else {
+                peer->tx_stats.failed++;
+            }
+        }
+        xSemaphoreGive(peerMutex);
+    }
+}
+
+// Called from the radio callbacks, so it must not wait for room in the queue
+void CommunicationsBase::postTransportEvent(const TransportEvent& event) {
+    if (transportEvents == nullptr || xQueueSend(transportEvents, &event, 0) != pdTRUE) {
+        LOG_WARNING("Transport event queue full, event dropped");
+    }
+}
+
+// Handles one expired frame per pass so the radio is never used while holding peerMutex
+void CommunicationsBase::serviceRetransmissions() {
+    uint8_t mac_addr[MAC_ADDRESS_LENGTH];
+    uint8_t buffer[MAX_MSG_SIZE];
+
+    while (true) {
+        if (xSemaphoreTake(peerMutex, portMAX_DELAY) != pdTRUE) {
+            return;
+        }
+
+        uint32_t now = millis();
+        Peer* peer = nullptr;
+        PendingFrame* expired = nullptr;
+        for (int i = 0; i < MAX_PEERS && expired == nullptr; ++i) {
+            if (!peers[i].in_use) {
+                continue;
+            }
+            for (PendingFrame& frame : peers[i].window) {
+                if (frame.in_use && now - frame.sent_at_ms >= frame.timeout_ms) {
+                    memcpy(mac_addr, peers[i].mac_addr, MAC_ADDRESS_LENGTH);
+                    peer = &peers[i];
+                    expired = &frame;
+                    break;
+                }
+            }
+        }
+
+        if (expired == nullptr) {
+            xSemaphoreGive(peerMutex);
+            return;
+        }
+
+        if (expired->transmissions >= MAX_TRANSMISSIONS) {
+            SendCompletion failed = releaseFrame(*expired, false);
+            xSemaphoreGive(peerMutex);
+            reportCompletions(mac_addr, &failed, 1);
+            continue;
+        }
+
+        // Retransmit with the same sequence number so the receiver can detect the duplicate,
+        // doubling the timeout as the ACK is probably just late
+        expired->transmissions++;
+        expired->sent_at_ms = now;
+        peer->rtt.backOff(2 * expired->timeout_ms);
+        expired->timeout_ms = peer->rtt.timeout();
+        size_t len = expired->len;
+        memcpy(buffer, expired->data, len);
+        LOG_WARNING("No ACK for %s message (seq %u), retransmitting (%u/%u), timeout %u ms", MSG_NAME[buffer[0]],
+                    expired->seq, expired->transmissions, MAX_TRANSMISSIONS, (unsigned)expired->timeout_ms);
+        xSemaphoreGive(peerMutex);
+
+        transmit(mac_addr, buffer, len, nullptr);
+    }
+}
+
+// Listens channel by channel for the master beacon instead of sending JOIN requests on each one
+uint8_t CommunicationsBase::findMaster(uint8_t preferred_channel) {
+    uint8_t start = (preferred_channel >= 1 && preferred_channel <= MAX_WIFI_CHANNEL) ? preferred_channel : 1;
+
+    for (uint8_t i = 0; i < MAX_WIFI_CHANNEL; i++) {
+        uint8_t channel = 1 + (start - 1 + i) % MAX_WIFI_CHANNEL;
+        esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
+
+        xSemaphoreTake(beaconSemaphore, 0); // Discard beacons heard before this channel
+        if (xSemaphoreTake(beaconSemaphore, pdMS_TO_TICKS(BEACON_LISTEN_MS)) == pdTRUE) {
+            LOG_INFO("Master beacon heard on channel %u, master on channel %u", channel, beaconChannel);
+            return beaconChannel;
+        }
+    }
+    return 0;
+}
+
+// Records the channel announced by a beacon of the master
+void CommunicationsBase::beaconReceived(const uint8_t* mac_addr, const BeaconMsg& beacon) {
+    if (memcmp(mac_addr, master_mac_addr, MAC_ADDRESS_LENGTH) != 0 ||
+        beacon.channel < 1 || beacon.channel > MAX_WIFI_CHANNEL) {
+        return;
+    }
+    beaconChannel = beacon.channel;
+    xSemaphoreGive(beaconSemaphore);
+}
+
+// Sets the receive slots for incoming messages
+void CommunicationsBase::setIngress(IngressRing* ring) {
+    ingress = ring;
 }
 
 // Static callback to handle incoming ESP-NOW data
@@ -203,17 +902,49 @@ void CommunicationsBase::onDataRecvStatic(const uint8_t* mac_addr, const uint8_t
     }
 }
 
-// Handles received ESP-NOW data by enqueuing the message
+// Static callback to handle the outcome of ESP-NOW transmissions
+void CommunicationsBase::onDataSentStatic(const uint8_t* mac_addr, esp_now_send_status_t status) {
+    if (instance) {
+        instance->onDataSent(mac_addr, status);
+    }
+}
+
+// ESP-NOW reports frames in the order they were queued, so this is the oldest pending handle
+void CommunicationsBase::onDataSent(const uint8_t* mac_addr, esp_now_send_status_t status) {
+    bool delivered = status == ESP_NOW_SEND_SUCCESS;
+    TxHandle handle = txResolved + 1;
+    if (handle == INVALID_TX_HANDLE) {
+        handle++;
+    }
+
+    TxRecord& record = txRecords[handle % TX_TRACK_SLOTS];
+    if (record.handle == handle) {
+        record.status = delivered ? TxStatus::DELIVERED : TxStatus::FAILED;
+        if (!delivered) {
+            LOG_WARNING("%s message to %02X:%02X:%02X:%02X:%02X:%02X not acknowledged by the MAC",
+                        MSG_NAME[static_cast<uint8_t>(record.type)],
+                        mac_addr[0], mac_addr[1], mac_addr[2], mac_addr[3], mac_addr[4], mac_addr[5]);
+        }
+    }
+    __atomic_store_n(&txResolved, handle, __ATOMIC_RELEASE);
+
+    // Broadcasts have no peer to count them for
+    if (memcmp(mac_addr, BROADCAST_MAC_ADDR, MAC_ADDRESS_LENGTH) != 0) {
+        TransportEvent event;
+        event.kind = TransportEvent::SENT;
+        memcpy(event.mac_addr, mac_addr, MAC_ADDRESS_LENGTH);
+        event.delivered = delivered;
+        event.acked_seq = 0;
+        event.sack = 0;
+        postTransportEvent(event);
+    }
+
+    xSemaphoreGive(txSemaphore);
+}
+
+// Handles received ESP-NOW data by storing it in a receive slot for the FreeRTOS task
 void CommunicationsBase::onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len){
-    // Enqueue the message for processing in the FreeRTOS task
-    IncomingMsg incoming_msg;
-    memcpy(incoming_msg.mac_addr, mac_addr, MAC_ADDRESS_LENGTH);
-    memcpy(incoming_msg.data, data, len);
-    incoming_msg.len = len;
-
-    if (dataQueue) {
-        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-        xQueueSendFromISR(dataQueue, &incoming_msg, &xHigherPriorityTaskWoken);
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    if (ingress) {
+        ingress->push(mac_addr, data, len); // Drops are counted in the ring statistics
     }
 }
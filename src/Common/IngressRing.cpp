@@ -0,0 +1,74 @@
+/**
+ * @file IngressRing.cpp
+ * @brief Implementation of the single-producer/single-consumer receive slot ring
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "Common/IngressRing.h"
+#include <string.h>
+
+IngressRing::IngressRing() : head(0), tail(0) {
+    ready = xSemaphoreCreateCounting(INGRESS_SLOTS, 0);
+    memset(&stats, 0, sizeof(stats));
+}
+
+IngressRing::~IngressRing() {
+    if (ready != nullptr) {
+        vSemaphoreDelete(ready);
+        ready = nullptr;
+    }
+}
+
+// Runs in the Wi-Fi task: one copy into the slot, then the index is published
+bool IngressRing::push(const uint8_t* mac_addr, const uint8_t* data, int len) {
+    if (len <= 0 || len > (int)MAX_MSG_SIZE) {
+        stats.oversize++;
+        return false;
+    }
+
+    uint32_t released = __atomic_load_n(&tail, __ATOMIC_ACQUIRE);
+    uint32_t in_use = head - released;
+    if (in_use >= INGRESS_SLOTS) {
+        stats.overflow++;
+        return false;
+    }
+
+    IncomingMsg& slot = slots[head % INGRESS_SLOTS];
+    memcpy(slot.mac_addr, mac_addr, MAC_ADDRESS_LENGTH);
+    memcpy(slot.data, data, len);
+    slot.len = len;
+    slot.received_ms = millis();
+
+    // Make the slot contents visible before the consumer can see the new head
+    __atomic_store_n(&head, head + 1, __ATOMIC_RELEASE);
+    stats.received++;
+    if (in_use + 1 > stats.high_water) {
+        stats.high_water = in_use + 1;
+    }
+
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    xSemaphoreGiveFromISR(ready, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    return true;
+}
+
+// Returns the oldest published slot, or nullptr if none arrives before the timeout
+IncomingMsg* IngressRing::acquire(TickType_t timeout) {
+    if (xSemaphoreTake(ready, timeout) != pdTRUE) {
+        return nullptr;
+    }
+    // The semaphore count guarantees head is past tail, the acquire load pairs with push()
+    __atomic_load_n(&head, __ATOMIC_ACQUIRE);
+    return &slots[tail % INGRESS_SLOTS];
+}
+
+// Hands the oldest slot back to the producer
+void IngressRing::release() {
+    __atomic_store_n(&tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+IngressStats IngressRing::getStats() const {
+    return stats;
+}
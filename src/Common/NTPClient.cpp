@@ -9,14 +9,14 @@
  */
 
 #include "Common/NTPClient.h"
+#include <sys/time.h>
 
-NTPClient::NTPClient() {
-    // Constructor can initialize variables if needed
-}
+NTPClient::NTPClient() : timeZoneSet(false) {}
 
 // Initializes the NTP client and synchronizes time
 bool NTPClient::initialize() {
-    configTime(3600, 0, "pool.ntp.org", "time.nist.gov");
+    configTime(GMT_OFFSET_S, DAYLIGHT_OFFSET_S, "pool.ntp.org", "time.nist.gov");
+    timeZoneSet = true;
     struct tm timeinfo;
 
     // Wait until time is synchronized
@@ -47,6 +47,43 @@ bool NTPClient::isTimeValid() {
     return now > 1732288146; // Set to Nov 22, 2024
 }
 
+// Reads the current time with millisecond resolution
+bool NTPClient::getEpochTime(EpochTime& time) {
+    if (!isTimeValid()) {
+        return false;
+    }
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    time.seconds = now.tv_sec;
+    time.millis = now.tv_usec / 1000;
+    return true;
+}
+
+// Sets the clock to a time received from another node, advanced by the time it spent in transit
+int32_t NTPClient::setTime(const EpochTime& time, uint32_t delay_ms) {
+    if (!timeZoneSet) {
+        // Same zone configTime() would set, without starting SNTP
+        char tz[16];
+        snprintf(tz, sizeof(tz), "UTC%ld", -GMT_OFFSET_S / 3600);
+        setenv("TZ", tz, 1);
+        tzset();
+        timeZoneSet = true;
+    }
+
+    int64_t received_ms = static_cast<int64_t>(time.seconds) * 1000 + time.millis + delay_ms;
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    int64_t local_ms = static_cast<int64_t>(now.tv_sec) * 1000 + now.tv_usec / 1000;
+
+    struct timeval tv;
+    tv.tv_sec = received_ms / 1000;
+    tv.tv_usec = (received_ms % 1000) * 1000;
+    settimeofday(&tv, nullptr);
+
+    int64_t correction = received_ms - local_ms;
+    return correction > INT32_MAX ? INT32_MAX : correction < INT32_MIN ? INT32_MIN : static_cast<int32_t>(correction);
+}
+
 // Checks if the current time is within nighttime hours
 bool NTPClient::isNightTime() {
     struct tm timeinfo;
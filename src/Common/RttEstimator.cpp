@@ -0,0 +1,54 @@
+/**
+ * @file RttEstimator.cpp
+ * @brief Implementation of the Jacobson/Karels round-trip time estimator
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "Common/RttEstimator.h"
+#include <string.h>
+
+void RttEstimator::reset() {
+    memset(this, 0, sizeof(*this));
+}
+
+void RttEstimator::addSample(uint32_t rtt_ms) {
+    int32_t rtt = rtt_ms < MAX_RTO_MS ? rtt_ms : MAX_RTO_MS;
+    if (rtt == 0) {
+        rtt = 1; // Below the resolution of millis(), still a valid measurement
+    }
+
+    if (samples == 0) {
+        // First measurement: SRTT = R, RTTVAR = R / 2
+        srtt_x8 = rtt << 3;
+        rttvar_x4 = rtt << 1;
+    } else {
+        // SRTT += (R - SRTT) / 8, RTTVAR += (|R - SRTT| - RTTVAR) / 4, using the scaled values
+        int32_t error = rtt - (srtt_x8 >> 3);
+        srtt_x8 += error;
+        if (error < 0) {
+            error = -error;
+        }
+        rttvar_x4 += error - (rttvar_x4 >> 2);
+    }
+    samples++;
+
+    // RTO = SRTT + max(G, 4 * RTTVAR), G being the period of the retransmission check
+    uint32_t variation = rttvar_x4 > (int32_t)RETRANSMIT_CHECK_PERIOD ? rttvar_x4 : RETRANSMIT_CHECK_PERIOD;
+    uint32_t rto = (srtt_x8 >> 3) + variation;
+    rto_ms = rto < MIN_RTO_MS ? MIN_RTO_MS : (rto > MAX_RTO_MS ? MAX_RTO_MS : rto);
+}
+
+void RttEstimator::backOff(uint32_t timeout_ms) {
+    if (timeout_ms > MAX_RTO_MS) {
+        timeout_ms = MAX_RTO_MS;
+    }
+    if (timeout() < timeout_ms) {
+        rto_ms = timeout_ms;
+    }
+}
+
+uint32_t RttEstimator::timeout() const {
+    return rto_ms != 0 ? rto_ms : INITIAL_RTO_MS;
+}
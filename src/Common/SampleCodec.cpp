@@ -0,0 +1,133 @@
+/**
+ * @file SampleCodec.cpp
+ * @brief Implementation of the delta/zigzag-varint codec for batches of sensor readings
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "Common/SampleCodec.h"
+
+// Maps signed values to unsigned so that small magnitudes produce short varints (0,-1,1,-2 -> 0,1,2,3)
+static inline uint32_t zigzagEncode(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+static inline int32_t zigzagDecode(uint32_t value) {
+    return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+}
+
+// Writes value as LEB128 at out, returns the number of bytes used
+static inline uint8_t writeVarint(uint32_t value, uint8_t* out) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = static_cast<uint8_t>(value);
+    return n;
+}
+
+SampleEncoder::SampleEncoder(uint8_t* buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), used(0), encoded(0), previous({0, 0, 0}), previous_step(0) {}
+
+bool SampleEncoder::add(const SampleRecord& sample) {
+    if (encoded == UINT8_MAX) {
+        return false;
+    }
+
+    // Encode into scratch first so a reading that does not fit leaves the buffer untouched
+    uint8_t scratch[MAX_ENCODED_SAMPLE_SIZE];
+    uint8_t n = 0;
+    if (encoded == 0) {
+        n += writeVarint(sample.age_s, scratch + n);
+        n += writeVarint(zigzagEncode(sample.temperature), scratch + n);
+        n += writeVarint(sample.humidity, scratch + n);
+    } else {
+        // Readings are oldest first and roughly one sleep period apart, so only the change of step is stored
+        int32_t step = static_cast<int32_t>(previous.age_s - sample.age_s);
+        n += writeVarint(zigzagEncode(step - previous_step), scratch + n);
+        n += writeVarint(zigzagEncode(sample.temperature - previous.temperature), scratch + n);
+        n += writeVarint(zigzagEncode(sample.humidity - previous.humidity), scratch + n);
+    }
+
+    if (used + n > capacity) {
+        return false;
+    }
+    memcpy(buffer + used, scratch, n);
+    used += n;
+    if (encoded > 0) {
+        previous_step = static_cast<int32_t>(previous.age_s - sample.age_s);
+    }
+    encoded++;
+    previous = sample;
+    return true;
+}
+
+size_t SampleEncoder::size() const {
+    return used;
+}
+
+uint8_t SampleEncoder::count() const {
+    return encoded;
+}
+
+SampleDecoder::SampleDecoder(const uint8_t* data, size_t len, uint8_t count)
+    : data(data), len(len), pos(0), remaining(count), started(false), error(false), previous({0, 0, 0}),
+      previous_step(0) {}
+
+bool SampleDecoder::readVarint(uint32_t& value) {
+    value = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+        if (pos >= len) {
+            error = true;
+            return false;
+        }
+        uint8_t byte = data[pos++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    error = true;
+    return false;
+}
+
+bool SampleDecoder::next(SampleRecord& sample) {
+    if (remaining == 0 || error) {
+        return false;
+    }
+
+    uint32_t age, temperature, humidity;
+    if (!readVarint(age) || !readVarint(temperature) || !readVarint(humidity)) {
+        return false;
+    }
+
+    if (!started) {
+        sample.age_s = age;
+        sample.temperature = static_cast<int16_t>(zigzagDecode(temperature));
+        sample.humidity = static_cast<uint16_t>(humidity);
+        started = true;
+    } else {
+        previous_step += zigzagDecode(age);
+        sample.age_s = previous.age_s - previous_step;
+        sample.temperature = static_cast<int16_t>(previous.temperature + zigzagDecode(temperature));
+        sample.humidity = static_cast<uint16_t>(previous.humidity + zigzagDecode(humidity));
+    }
+
+    previous = sample;
+    remaining--;
+    return true;
+}
+
+bool SampleDecoder::finished() const {
+    return remaining == 0 && !error && pos == len;
+}
+
+bool SampleDecoder::validate(const uint8_t* data, size_t len, uint8_t count) {
+    SampleDecoder decoder(data, len, count);
+    SampleRecord sample;
+    while (decoder.next(sample)) {
+    }
+    return decoder.finished();
+}
@@ -0,0 +1,225 @@
+/**
+ * @file CompressedSeries.cpp
+ * @brief Implementation of the block-compressed time series
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "MasterDevice/CompressedSeries.h"
+
+static_assert(SERIES_BLOCK_BYTES * 8 <= UINT16_MAX, "SeriesBlock::bits must address every bit of a block");
+
+namespace {
+// Largest encoding of a point after the first one of a block: 3 fields of a 4-bit prefix and 32 bits
+constexpr uint16_t MAX_POINT_BITS = 3 * (4 + 32);
+
+// Prefix codes, each row is {prefix, prefix bits, payload bits}. The payload holds the value plus an offset
+struct Code {
+    uint8_t prefix;
+    uint8_t prefix_bits;
+    uint8_t payload_bits;
+};
+
+// Change of the interval between timestamps, in seconds
+constexpr Code TIMESTAMP_CODES[] = {{0x2, 2, 7}, {0x6, 3, 9}, {0xE, 4, 12}};
+// Change of a value, in centi-units
+constexpr Code VALUE_CODES[] = {{0x2, 2, 4}, {0x6, 3, 7}, {0xE, 4, 12}};
+constexpr uint8_t NUM_CODES = 3;
+
+void writeBits(SeriesBlock& block, uint32_t value, uint8_t count) {
+    for (int8_t i = count - 1; i >= 0; i--) {
+        uint16_t pos = block.bits++;
+        uint8_t mask = 0x80 >> (pos & 7);
+        if ((value >> i) & 1) {
+            block.data[pos >> 3] |= mask;
+        } else {
+            block.data[pos >> 3] &= ~mask;
+        }
+    }
+}
+
+uint32_t readBits(const SeriesBlock& block, uint16_t& pos, uint8_t count) {
+    uint32_t value = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        value = (value << 1) | ((block.data[pos >> 3] >> (7 - (pos & 7))) & 1);
+        pos++;
+    }
+    return value;
+}
+
+// Range of a payload of n bits: [-(2^(n-1) - 1), 2^(n-1)]
+int32_t lowest(uint8_t payload_bits) {
+    return -((1 << (payload_bits - 1)) - 1);
+}
+
+void writeCoded(SeriesBlock& block, int32_t value, const Code* codes) {
+    if (value == 0) {
+        writeBits(block, 0, 1);
+        return;
+    }
+    for (uint8_t i = 0; i < NUM_CODES; i++) {
+        int32_t low = lowest(codes[i].payload_bits);
+        if (value >= low && value <= low + (1 << codes[i].payload_bits) - 1) {
+            writeBits(block, codes[i].prefix, codes[i].prefix_bits);
+            writeBits(block, static_cast<uint32_t>(value - low), codes[i].payload_bits);
+            return;
+        }
+    }
+    writeBits(block, 0xF, 4);
+    writeBits(block, static_cast<uint32_t>(value), 32);
+}
+
+int32_t readCoded(const SeriesBlock& block, uint16_t& pos, const Code* codes) {
+    // Counts the leading ones of the prefix, a zero ends it
+    uint8_t ones = 0;
+    while (ones < 4 && readBits(block, pos, 1) == 1) {
+        ones++;
+    }
+    if (ones == 0) {
+        return 0;
+    }
+    if (ones == 4) {
+        return static_cast<int32_t>(readBits(block, pos, 32));
+    }
+    const Code& code = codes[ones - 1];
+    return static_cast<int32_t>(readBits(block, pos, code.payload_bits)) + lowest(code.payload_bits);
+}
+
+bool fitsInt32(int64_t value) {
+    return value >= INT32_MIN && value <= INT32_MAX;
+}
+}
+
+void CompressedSeries::init(SeriesBlock* buffer, uint32_t num_blocks) {
+    this->blocks = buffer;
+    this->num_blocks = buffer != nullptr ? num_blocks : 0;
+    tail = 0;
+    head = 0;
+    points = 0;
+    last_timestamp = 0;
+    last_delta = 0;
+    last_a = 0;
+    last_b = 0;
+    if (this->num_blocks > 0) {
+        blocks[0].count = 0;
+        blocks[0].bits = 0;
+    }
+}
+
+void CompressedSeries::append(const SeriesPoint& point) {
+    if (num_blocks == 0) {
+        return;
+    }
+    SeriesBlock* block = &blocks[head % num_blocks];
+
+    int64_t delta = static_cast<int64_t>(point.timestamp) - last_timestamp;
+    int64_t delta_of_delta = delta - last_delta;
+    int64_t delta_a = static_cast<int64_t>(point.a) - last_a;
+    int64_t delta_b = static_cast<int64_t>(point.b) - last_b;
+    bool fits = fitsInt32(delta) && fitsInt32(delta_of_delta) && fitsInt32(delta_a) && fitsInt32(delta_b);
+
+    // A new block starts from a raw point, which also covers jumps too large for a delta
+    if (block->count > 0 && (!fits || block->bits + MAX_POINT_BITS > SERIES_BLOCK_BYTES * 8)) {
+        head++;
+        if (head - tail >= num_blocks) {
+            points -= blocks[tail % num_blocks].count;
+            tail++;
+        }
+        block = &blocks[head % num_blocks];
+        block->count = 0;
+        block->bits = 0;
+    }
+
+    if (block->count == 0) {
+        writeBits(*block, point.timestamp, 32);
+        writeBits(*block, static_cast<uint32_t>(point.a), 32);
+        writeBits(*block, static_cast<uint32_t>(point.b), 32);
+        last_delta = 0;
+    } else {
+        writeCoded(*block, static_cast<int32_t>(delta_of_delta), TIMESTAMP_CODES);
+        writeCoded(*block, static_cast<int32_t>(delta_a), VALUE_CODES);
+        writeCoded(*block, static_cast<int32_t>(delta_b), VALUE_CODES);
+        last_delta = static_cast<int32_t>(delta);
+    }
+    last_timestamp = point.timestamp;
+    last_a = point.a;
+    last_b = point.b;
+    block->count++;
+    points++;
+}
+
+uint32_t CompressedSeries::usedBytes() const {
+    uint32_t bytes = 0;
+    for (uint32_t seq = tail; num_blocks > 0 && seq != head + 1; seq++) {
+        bytes += sizeof(SeriesBlock::count) + sizeof(SeriesBlock::bits) + (blocks[seq % num_blocks].bits + 7) / 8;
+    }
+    return bytes;
+}
+
+void CompressedSeries::begin(SeriesCursor& cursor) const {
+    memset(&cursor, 0, sizeof(cursor));
+    cursor.block = tail;
+}
+
+void CompressedSeries::seek(SeriesCursor& cursor, uint32_t timestamp) const {
+    begin(cursor);
+    if (num_blocks == 0) {
+        return;
+    }
+    // Last block starting at or before timestamp, the earlier ones only hold older points
+    uint32_t low = tail;
+    uint32_t high = head;
+    while (low < high) {
+        uint32_t mid = low + (high - low + 1) / 2;
+        const SeriesBlock& block = blocks[mid % num_blocks];
+        uint16_t pos = 0;
+        if (block.count > 0 && readBits(block, pos, 32) <= timestamp) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    cursor.block = low;
+}
+
+bool CompressedSeries::next(SeriesCursor& cursor, SeriesPoint& out_point) const {
+    if (num_blocks == 0) {
+        return false;
+    }
+    while (true) {
+        if (cursor.block < tail) {
+            cursor.block = tail;
+            cursor.index = 0;
+            cursor.bit = 0;
+        }
+        if (cursor.index < blocks[cursor.block % num_blocks].count) {
+            break;
+        }
+        if (cursor.block == head) {
+            return false;
+        }
+        cursor.block++;
+        cursor.index = 0;
+        cursor.bit = 0;
+    }
+
+    const SeriesBlock& block = blocks[cursor.block % num_blocks];
+    if (cursor.index == 0) {
+        cursor.timestamp = readBits(block, cursor.bit, 32);
+        cursor.a = static_cast<int32_t>(readBits(block, cursor.bit, 32));
+        cursor.b = static_cast<int32_t>(readBits(block, cursor.bit, 32));
+        cursor.delta = 0;
+    } else {
+        cursor.delta += readCoded(block, cursor.bit, TIMESTAMP_CODES);
+        cursor.timestamp += cursor.delta;
+        cursor.a += readCoded(block, cursor.bit, VALUE_CODES);
+        cursor.b += readCoded(block, cursor.bit, VALUE_CODES);
+    }
+    cursor.index++;
+
+    out_point.timestamp = cursor.timestamp;
+    out_point.a = cursor.a;
+    out_point.b = cursor.b;
+    return true;
+}
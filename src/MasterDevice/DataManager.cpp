@@ -7,33 +7,307 @@
  */
 
 #include "MasterDevice/DataManager.h"
+#include <esp_heap_caps.h>
+#include "Common/NTPClient.h"
+
+namespace {
+
+// NO_HT_VALUE is beyond the centi-unit range, it is logged as a code no real reading maps to
+constexpr int16_t LOGGED_NO_TEMPERATURE = INT16_MIN;
+constexpr uint16_t LOGGED_NO_HUMIDITY = UINT16_MAX;
+
+int16_t logTemperature(float temperature) {
+    return temperature == NO_HT_VALUE ? LOGGED_NO_TEMPERATURE : encodeTemperature(temperature);
+}
+
+uint16_t logHumidity(float humidity) {
+    return humidity == NO_HT_VALUE ? LOGGED_NO_HUMIDITY : encodeHumidity(humidity);
+}
+
+} // namespace
 
 // Constructor initializes mutexes for thread-safe operations
-DataManager::DataManager() {
+DataManager::DataManager() : numRooms(0), roomsFileBroken(false), reportedLogDrops(0) {
     sensorMutex = xSemaphoreCreateMutex();
     controlMutex = xSemaphoreCreateMutex();
+    memset(roomConfig, 0, sizeof(roomConfig));
+}
+
+void DataManager::loadRooms() {
+    if (!LittleFS.exists(ROOMS_CONFIG_PATH)) {
+        LOG_WARNING("No %s, registering the default rooms", ROOMS_CONFIG_PATH);
+        addDefaultRooms();
+        saveRooms(); // So the defaults can be edited without reflashing
+        return;
+    }
+
+    File file = LittleFS.open(ROOMS_CONFIG_PATH, "r");
+    if (file) {
+        DynamicJsonDocument doc(2048);
+        DeserializationError error = deserializeJson(doc, file);
+        file.close();
+        if (!error) {
+            JsonArray list = doc["rooms"].as<JsonArray>();
+            for (size_t i = 0; i < list.size(); i++) {
+                const char* name = list[i]["name"].as<const char*>();
+                uint32_t capacity = list[i].containsKey("capacity") ? list[i]["capacity"].as<uint32_t>()
+                                                                    : DEFAULT_HISTORY_POINTS;
+                addRoom(name != nullptr ? name : "", capacity);
+            }
+            LOG_INFO("Loaded %u rooms from %s", numRooms, ROOMS_CONFIG_PATH);
+            return;
+        }
+        LOG_ERROR("Failed to parse %s: %s", ROOMS_CONFIG_PATH, error.c_str());
+    } else {
+        LOG_ERROR("Failed to open %s", ROOMS_CONFIG_PATH);
+    }
+
+    // The file is the user's, it is left as it is so it can be fixed
+    LOG_WARNING("Running with the default rooms, %s is not written until it loads again", ROOMS_CONFIG_PATH);
+    roomsFileBroken = true;
+    addDefaultRooms();
+}
+
+void DataManager::addDefaultRooms() {
+    for (uint8_t i = 0; i < DEFAULT_NUM_ROOMS; i++) {
+        addRoom(DEFAULT_ROOM_NAME[i], DEFAULT_HISTORY_POINTS);
+    }
+}
+
+uint8_t DataManager::addRoom(const char* name, uint32_t capacity) {
+    xSemaphoreTake(controlMutex, portMAX_DELAY);
+    xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        uint8_t room_id = numRooms;
+        if (room_id >= MAX_ROOMS) {
+            xSemaphoreGive(sensorMutex);
+            xSemaphoreGive(controlMutex);
+            LOG_ERROR("Cannot add room %s, all %u rooms are in use", name, MAX_ROOMS);
+            return ID_NOT_VALID;
+        }
+        RoomConfig& config = roomConfig[room_id];
+        strncpy(config.name, name, MAX_ROOM_NAME_LENGTH - 1);
+        config.name[MAX_ROOM_NAME_LENGTH - 1] = '\0';
+        config.key = HistoryLog::roomKey(config.name);
+        config.capacity = allocateHistory(rooms[room_id].sensor, capacity);
+        publishSensor(room_id);
+        publishControl(room_id);
+        numRooms = room_id + 1; // Published last, readers check it before touching the slot
+    xSemaphoreGive(sensorMutex);
+    xSemaphoreGive(controlMutex);
+
+    LOG_INFO("Added room %u (%s) with %u history points in %s", room_id, config.name, (unsigned)config.capacity,
+             psramFound() ? "PSRAM" : "internal RAM");
+    return room_id;
+}
+
+bool DataManager::saveRooms() const {
+    if (roomsFileBroken) {
+        LOG_ERROR("%s could not be loaded, not overwriting it", ROOMS_CONFIG_PATH);
+        return false;
+    }
+
+    DynamicJsonDocument doc(2048);
+    JsonArray list = doc.createNestedArray("rooms");
+    uint8_t count = numRooms;
+    for (uint8_t i = 0; i < count; i++) {
+        JsonObject room = list.createNestedObject();
+        room["name"] = roomConfig[i].name;
+        room["capacity"] = roomConfig[i].capacity;
+    }
+
+    File file = LittleFS.open(ROOMS_CONFIG_PATH, "w");
+    if (!file) {
+        LOG_ERROR("Failed to open %s for writing", ROOMS_CONFIG_PATH);
+        return false;
+    }
+    serializeJson(doc, file);
+    file.close();
+    return true;
+}
+
+uint8_t DataManager::getNumRooms() const {
+    return numRooms;
+}
+
+const char* DataManager::getRoomName(uint8_t room_id) const {
+    return room_id < numRooms ? roomConfig[room_id].name : "";
+}
+
+uint32_t DataManager::allocateHistory(SensorData& sensor, uint32_t capacity) {
+    // The S3 master keeps tens of thousands of points per room in PSRAM, internal RAM only a few hundred
+    bool use_psram = psramFound();
+    while (true) {
+        uint32_t limit = use_psram ? MAX_PSRAM_HISTORY_POINTS : MAX_INTERNAL_HISTORY_POINTS;
+        uint32_t points = capacity < limit ? capacity : limit;
+        uint32_t caps = use_psram ? MALLOC_CAP_SPIRAM : (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+
+        // One block more than needed, the newest one is only partly filled
+        uint32_t num_blocks = (points * SERIES_BITS_PER_POINT + SERIES_BLOCK_BYTES * 8 - 1) / (SERIES_BLOCK_BYTES * 8) + 1;
+        SeriesBlock* blocks = static_cast<SeriesBlock*>(heap_caps_malloc(num_blocks * sizeof(SeriesBlock), caps));
+        if (blocks != nullptr) {
+            sensor.history.init(blocks, num_blocks);
+            sensor.valid_data_points = 0;
+
+            // Rollups are small next to the raw ring, a room without them still works
+            uint32_t hours = use_psram ? PSRAM_HOUR_ROLLUPS : INTERNAL_HOUR_ROLLUPS;
+            uint32_t days = use_psram ? PSRAM_DAY_ROLLUPS : INTERNAL_DAY_ROLLUPS;
+            sensor.hourly.init(static_cast<RollupBucket*>(heap_caps_malloc(hours * sizeof(RollupBucket), caps)),
+                               hours, HOUR_ROLLUP_PERIOD_S, NTPClient::GMT_OFFSET_S);
+            sensor.daily.init(static_cast<RollupBucket*>(heap_caps_malloc(days * sizeof(RollupBucket), caps)),
+                              days, DAY_ROLLUP_PERIOD_S, NTPClient::GMT_OFFSET_S);
+            if (sensor.hourly.capacity == 0 || sensor.daily.capacity == 0) {
+                LOG_WARNING("Not enough memory for the history rollups");
+            }
+            return points;
+        }
+
+        if (!use_psram) {
+            LOG_ERROR("Not enough memory for %u history points", (unsigned)points);
+            return 0;
+        }
+        LOG_WARNING("PSRAM allocation of %u history points failed, falling back to internal RAM", (unsigned)points);
+        use_psram = false;
+    }
 }
 
 void DataManager::addSensorData(uint8_t room_id, float temperature, float humidity, time_t timestamp) {
     if (roomIdIsValid(room_id)){
         xSemaphoreTake(sensorMutex, portMAX_DELAY);
-            RoomData& room = rooms[room_id];
-            uint16_t idx = room.sensor.index;
-            room.sensor.temperature[idx] = temperature;
-            room.sensor.humidity[idx] = humidity;
-            room.sensor.timestamps[idx] = timestamp;
+            storeSample(room_id, temperature, humidity, timestamp);
             rooms[room_id].sensor.latest_sensor_reception = millis();
-            room.sensor.valid_data_points++;
-            if (room.sensor.valid_data_points > MAX_DATA_POINTS) {
-                room.sensor.valid_data_points = MAX_DATA_POINTS;
+            publishSensor(room_id);
+        xSemaphoreGive(sensorMutex);
+    }
+}
+
+void DataManager::addSensorDataBatch(uint8_t room_id, const SampleRecord* samples, uint8_t count,
+                                     time_t reception_time, uint8_t uplink_every) {
+    if (roomIdIsValid(room_id)){
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
+            SensorData& sensor = rooms[room_id].sensor;
+            uint8_t stale = 0;
+            for (uint8_t i = 0; i < count; i++) {
+                time_t timestamp = reception_time - samples[i].age_s;
+                if (isStale(sensor, timestamp)) {
+                    stale++;
+                    continue;
+                }
+                storeSample(room_id, decodeTemperature(samples[i].temperature), decodeHumidity(samples[i].humidity),
+                            timestamp);
             }
-            // Update index for circular buffer
-            room.sensor.index = (idx + 1) % MAX_DATA_POINTS;
-            
+            if (stale > 0) {
+                LOG_WARNING("Dropped %u readings of room %u already in the history", stale, room_id);
+            }
+            sensor.uplink_every = uplink_every > 0 ? uplink_every : 1;
+            sensor.latest_sensor_reception = millis();
+            publishSensor(room_id);
         xSemaphoreGive(sensorMutex);
     }
 }
 
+bool DataManager::addSensorDataPacked(uint8_t room_id, const uint8_t* payload, size_t len, uint8_t count,
+                                      time_t reception_time, uint8_t uplink_every) {
+    if (!roomIdIsValid(room_id)){
+        return false;
+    }
+    // Checked before taking the lock so a corrupt frame never leaves a partial batch in the history
+    if (!SampleDecoder::validate(payload, len, count)) {
+        LOG_WARNING("Malformed packed batch from room %u", room_id);
+        return false;
+    }
+
+    xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        SensorData& sensor = rooms[room_id].sensor;
+        SampleDecoder decoder(payload, len, count);
+        SampleRecord sample;
+        uint8_t stale = 0;
+        while (decoder.next(sample)) {
+            time_t timestamp = reception_time - sample.age_s;
+            if (isStale(sensor, timestamp)) {
+                stale++;
+                continue;
+            }
+            storeSample(room_id, decodeTemperature(sample.temperature), decodeHumidity(sample.humidity), timestamp);
+        }
+        if (stale > 0) {
+            LOG_WARNING("Dropped %u readings of room %u already in the history", stale, room_id);
+        }
+        sensor.uplink_every = uplink_every > 0 ? uplink_every : 1;
+        sensor.latest_sensor_reception = millis();
+        publishSensor(room_id);
+    xSemaphoreGive(sensorMutex);
+    return true;
+}
+
+void DataManager::loadHistory() {
+    if (!historyLog.begin()) {
+        return;
+    }
+    uint8_t count = numRooms;
+    uint32_t needed[MAX_ROOMS];
+    uint32_t keys[MAX_ROOMS];
+    for (uint8_t i = 0; i < count; i++) {
+        needed[i] = roomConfig[i].capacity;
+        keys[i] = roomConfig[i].key;
+    }
+
+    // Nothing else runs yet, but the lock keeps the publish rules of the writers
+    xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        historyLog.replay(needed, keys, count, replayRecord, this);
+        for (uint8_t i = 0; i < count; i++) {
+            publishSensor(i);
+        }
+    xSemaphoreGive(sensorMutex);
+}
+
+void DataManager::flushHistory(bool force) {
+    uint32_t dropped = historyLog.getDropped();
+    historyLog.flush(force);
+    if (dropped != reportedLogDrops) {
+        LOG_WARNING("%u samples were not logged, the history log buffer was full", (unsigned)(dropped - reportedLogDrops));
+        reportedLogDrops = dropped;
+    }
+}
+
+void DataManager::replayRecord(const HistoryRecord& record, void* context) {
+    DataManager* self = static_cast<DataManager*>(context);
+    float temperature = record.temperature == LOGGED_NO_TEMPERATURE ? NO_HT_VALUE : decodeTemperature(record.temperature);
+    float humidity = record.humidity == LOGGED_NO_HUMIDITY ? NO_HT_VALUE : decodeHumidity(record.humidity);
+    self->appendSample(self->rooms[record.room_id].sensor, temperature, humidity, record.timestamp);
+}
+
+bool DataManager::isStale(const SensorData& sensor, time_t timestamp) {
+    return sensor.valid_data_points > 0 && timestamp <= sensor.latest.timestamp;
+}
+
+void DataManager::storeSample(uint8_t room_id, float temperature, float humidity, time_t timestamp) {
+    appendSample(rooms[room_id].sensor, temperature, humidity, timestamp);
+    historyLog.append(room_id, roomConfig[room_id].key, timestamp, logTemperature(temperature), logHumidity(humidity));
+}
+
+void DataManager::appendSample(SensorData& sensor, float temperature, float humidity, time_t timestamp) {
+    if (sensor.history.num_blocks == 0) {
+        return;
+    }
+    // Readings arrive in centi-units, so the round trip is exact. NO_HT_VALUE is stored as is
+    SeriesPoint point;
+    point.timestamp = static_cast<uint32_t>(timestamp);
+    point.a = lroundf(temperature * FIXED_POINT_SCALE);
+    point.b = lroundf(humidity * FIXED_POINT_SCALE);
+    sensor.history.append(point);
+    sensor.latest.temperature = temperature;
+    sensor.latest.humidity = humidity;
+    sensor.latest.timestamp = timestamp;
+    sensor.valid_data_points = sensor.history.size();
+    sensor.history_version++;
+
+    // Readings without time or with a failed measurement would skew the buckets
+    if (timestamp != 0 && temperature != NO_HT_VALUE && humidity != NO_HT_VALUE) {
+        sensor.hourly.add(timestamp, temperature, humidity);
+        sensor.daily.add(timestamp, temperature, humidity);
+    }
+}
+
 void DataManager::setNewSleepPeriod(uint8_t room_id, uint32_t new_sleep_period_ms) {
     if (roomIdIsValid(room_id)){
         xSemaphoreTake(sensorMutex, portMAX_DELAY);
@@ -41,72 +315,205 @@ void DataManager::setNewSleepPeriod(uint8_t room_id, uint32_t new_sleep_period_m
                 rooms[room_id].sensor.new_sleep_period_ms = new_sleep_period_ms;
                 rooms[room_id].sensor.pending_update = true;
             }
+            publishSensor(room_id);
         xSemaphoreGive(sensorMutex);
     }
 }
 
 uint32_t DataManager::getNewSleepPeriod(uint8_t room_id) const {
     if (roomIdIsValid(room_id)){
-        xSemaphoreTake(sensorMutex, portMAX_DELAY);
-            uint32_t new_sleep_period_ms = rooms[room_id].sensor.new_sleep_period_ms;
-        xSemaphoreGive(sensorMutex);
-        return new_sleep_period_ms;
+        return sensorState[room_id].read().new_sleep_period_ms;
     } else{
         return 0;
     }
 }
 
+void DataManager::fillAckOptions(uint8_t room_id, NodeType node_type, AckOptions& options) const {
+    if (!roomIdIsValid(room_id)) {
+        return;
+    }
+    if (node_type == NodeType::SENSOR) {
+        SensorState sensor = sensorState[room_id].read();
+        if (sensor.pending_update) {
+            options.addSleepPeriod(sensor.new_sleep_period_ms);
+        }
+    } else if (node_type == NodeType::ROOM) {
+        ControlData control = controlState[room_id].read();
+        if (control.pending_update) {
+            options.addSchedule(control.new_warm, control.new_cold);
+        }
+    }
+}
+
 bool DataManager::isPendingUpdate(uint8_t room_id, NodeType node_type) const {
     if (roomIdIsValid(room_id)){
-        bool pending;
         if (node_type == NodeType::SENSOR){
-            xSemaphoreTake(sensorMutex, portMAX_DELAY);
-                pending = rooms[room_id].sensor.pending_update;
-            xSemaphoreGive(sensorMutex);
+            return sensorState[room_id].read().pending_update;
         } else{
-            xSemaphoreTake(controlMutex, portMAX_DELAY);
-                pending = rooms[room_id].control.pending_update;
-            xSemaphoreGive(controlMutex);
+            return controlState[room_id].read().pending_update;
         }
-        
-        return pending;
     } else {
         return false;
     }
 }
 
-RoomData DataManager::getRoomData(uint8_t room_id) const {
-    RoomData data;
-    if (roomIdIsValid(room_id)){
-        xSemaphoreTake(controlMutex, portMAX_DELAY);
+bool DataManager::getRoomSummary(uint8_t room_id, RoomSummary& out_summary) const {
+    if (!roomIdIsValid(room_id)) {
+        return false;
+    }
+    ControlData control = controlState[room_id].read();
+    out_summary.control_registered = control.registered;
+    out_summary.warm = control.warm;
+    out_summary.cold = control.cold;
+    out_summary.lights_on = control.lights_on;
+
+    SensorState sensor = sensorState[room_id].read();
+    out_summary.sensor_registered = sensor.registered;
+    out_summary.sleep_period_ms = sensor.sleep_period_ms;
+    out_summary.has_sample = sensor.has_sample;
+    out_summary.latest = sensor.latest;
+    return true;
+}
+
+bool DataManager::latestSample(uint8_t room_id, SensorSample& out_sample) const {
+    if (!roomIdIsValid(room_id)) {
+        return false;
+    }
+    SensorState sensor = sensorState[room_id].read();
+    out_sample = sensor.latest;
+    return sensor.has_sample;
+}
+
+uint32_t DataManager::visitHistory(uint8_t room_id, time_t from, time_t to, HistoryVisitor visitor,
+                                   void* context) const {
+    if (!roomIdIsValid(room_id) || visitor == nullptr || from > to) {
+        return 0;
+    }
+    const CompressedSeries& history = rooms[room_id].sensor.history;
+    SensorSample chunk[HISTORY_VISIT_CHUNK];
+    SeriesCursor cursor;
+    SeriesPoint point;
+    uint32_t visited = 0;
+
+    xSemaphoreTake(sensorMutex, portMAX_DELAY);
+        history.seek(cursor, from < 0 ? 0 : static_cast<uint32_t>(from));
+    xSemaphoreGive(sensorMutex);
+
+    bool done = false;
+    while (!done) {
+        uint8_t count = 0;
+        // Blocks dropped by the series while the visitor ran are skipped by the cursor
         xSemaphoreTake(sensorMutex, portMAX_DELAY);
-            data = rooms[room_id];
+            while (count < HISTORY_VISIT_CHUNK && history.next(cursor, point)) {
+                // The block found by seek() may start before from
+                if (static_cast<time_t>(point.timestamp) < from) {
+                    continue;
+                }
+                if (static_cast<time_t>(point.timestamp) > to) {
+                    done = true;
+                    break;
+                }
+                chunk[count].temperature = point.a / FIXED_POINT_SCALE;
+                chunk[count].humidity = point.b / FIXED_POINT_SCALE;
+                chunk[count].timestamp = point.timestamp;
+                count++;
+            }
         xSemaphoreGive(sensorMutex);
-        xSemaphoreGive(controlMutex);
+
+        for (uint8_t i = 0; i < count; i++) {
+            visited++;
+            if (!visitor(chunk[i], context)) {
+                return visited;
+            }
+        }
+        if (count < HISTORY_VISIT_CHUNK) {
+            done = true;
+        }
     }
-    return data;
+    return visited;
+}
+
+uint32_t DataManager::visitRollups(uint8_t room_id, HistoryResolution resolution, time_t from, time_t to,
+                                   RollupVisitor visitor, void* context) const {
+    if (!roomIdIsValid(room_id) || visitor == nullptr || resolution == HistoryResolution::RAW || from > to) {
+        return 0;
+    }
+    const RollupSeries& series = resolution == HistoryResolution::HOUR ? rooms[room_id].sensor.hourly
+                                                                       : rooms[room_id].sensor.daily;
+    RollupBucket chunk[ROLLUP_VISIT_CHUNK];
+    uint32_t next = 0;  // Position in opening order of the next bucket to visit
+    bool first = true;
+    bool done = false;
+    uint32_t visited = 0;
+
+    while (!done) {
+        uint8_t count = 0;
+        xSemaphoreTake(sensorMutex, portMAX_DELAY);
+            uint32_t oldest = series.appended - series.size();
+            if (first) {
+                // Buckets are opened in time order: binary search the first one that ends after from
+                uint32_t low = oldest;
+                uint32_t high = series.appended;
+                while (low < high) {
+                    uint32_t mid = low + (high - low) / 2;
+                    if (series.buckets[mid % series.capacity].start + static_cast<time_t>(series.period_s) <= from) {
+                        low = mid + 1;
+                    } else {
+                        high = mid;
+                    }
+                }
+                next = low;
+                first = false;
+            } else if (next < oldest) {
+                next = oldest;
+            }
+            while (count < ROLLUP_VISIT_CHUNK && next != series.appended) {
+                const RollupBucket& bucket = series.buckets[next % series.capacity];
+                if (bucket.start > to) {
+                    done = true;
+                    break;
+                }
+                chunk[count++] = bucket;
+                next++;
+            }
+        xSemaphoreGive(sensorMutex);
+
+        for (uint8_t i = 0; i < count; i++) {
+            visited++;
+            if (!visitor(chunk[i], context)) {
+                return visited;
+            }
+        }
+        if (count < ROLLUP_VISIT_CHUNK) {
+            done = true;
+        }
+    }
+    return visited;
+}
+
+uint32_t DataManager::getHistoryVersion(uint8_t room_id) const {
+    if (!roomIdIsValid(room_id)) {
+        return 0;
+    }
+    return sensorState[room_id].read().history_version;
 }
 
 bool DataManager::getMacAddr(uint8_t room_id, NodeType node_type, uint8_t* out_mac_addr) const {
     if (roomIdIsValid(room_id) && out_mac_addr != nullptr){
         if (node_type == NodeType::SENSOR){
-            xSemaphoreTake(sensorMutex, portMAX_DELAY);
-                if (!rooms[room_id].sensor.registered){
-                    LOG_WARNING("Sensor MAC address is not registered.");
-                    xSemaphoreGive(sensorMutex);
-                    return false;
-                }
-                memcpy(out_mac_addr, rooms[room_id].sensor.mac_addr, MAC_ADDRESS_LENGTH);
-            xSemaphoreGive(sensorMutex);
+            SensorState sensor = sensorState[room_id].read();
+            if (!sensor.registered){
+                LOG_WARNING("Sensor MAC address is not registered.");
+                return false;
+            }
+            memcpy(out_mac_addr, sensor.mac_addr, MAC_ADDRESS_LENGTH);
         } else {
-            xSemaphoreTake(controlMutex, portMAX_DELAY);
-                if (!rooms[room_id].control.registered){
-                    LOG_WARNING("Control MAC address is not registered.");
-                    xSemaphoreGive(controlMutex);
-                    return false;
-                }
-                memcpy(out_mac_addr, rooms[room_id].control.mac_addr, MAC_ADDRESS_LENGTH);
-            xSemaphoreGive(controlMutex);
+            ControlData control = controlState[room_id].read();
+            if (!control.registered){
+                LOG_WARNING("Control MAC address is not registered.");
+                return false;
+            }
+            memcpy(out_mac_addr, control.mac_addr, MAC_ADDRESS_LENGTH);
         }
         return true;
     }
@@ -122,7 +529,9 @@ void DataManager::sensorSetup(uint8_t room_id, const uint8_t* mac_addr, uint32_t
             rooms[room_id].sensor.new_sleep_period_ms = sleep_period_ms;
             rooms[room_id].sensor.pending_update = false; // No pending update initially
             rooms[room_id].sensor.registered = true; // Register sensor
+            rooms[room_id].sensor.uplink_every = 1; // Until the first batch says otherwise
             rooms[room_id].sensor.latest_sensor_reception = millis();
+            publishSensor(room_id);
         xSemaphoreGive(sensorMutex);
     }
 }
@@ -135,6 +544,7 @@ void DataManager::setNewSchedule(uint8_t room_id, uint8_t warm_hour, uint8_t war
             rooms[room_id].control.new_cold.min = cold_min;
             rooms[room_id].control.new_warm.hour = warm_hour;
             rooms[room_id].control.new_warm.min = warm_min;
+            publishControl(room_id);
         xSemaphoreGive(controlMutex);
     }
 }
@@ -145,6 +555,7 @@ void DataManager::scheduleWasUpdated(uint8_t room_id) {
             rooms[room_id].control.pending_update = false;
             rooms[room_id].control.cold = rooms[room_id].control.new_cold;
             rooms[room_id].control.warm = rooms[room_id].control.new_warm;
+            publishControl(room_id);
         xSemaphoreGive(controlMutex);
         LOG_INFO("Schedule was successfully updated");
     }
@@ -155,42 +566,32 @@ void DataManager::sleepPeriodWasUpdated(uint8_t room_id){
         xSemaphoreTake(sensorMutex, portMAX_DELAY);
             rooms[room_id].sensor.sleep_period_ms = rooms[room_id].sensor.new_sleep_period_ms;
             rooms[room_id].sensor.pending_update = false;
+            publishSensor(room_id);
         xSemaphoreGive(sensorMutex);
         LOG_INFO("Sleep Period was successfully updated");
     }
 }
 
 bool DataManager::roomIdIsValid(uint8_t room_id) const {
-    if (room_id >= NUM_ROOMS){
+    if (room_id >= numRooms){
         LOG_WARNING("The Room ID is not valid.");
         return false;
     }
     return true;
 }
 
-uint8_t DataManager::getId(uint8_t* mac_addr) const {
-    xSemaphoreTake(controlMutex, portMAX_DELAY);
-    xSemaphoreTake(sensorMutex, portMAX_DELAY);
-        for (uint8_t i = 0; i < NUM_ROOMS; i++){
-            if (rooms[i].sensor.registered){
-                if(memcmp(rooms[i].sensor.mac_addr, mac_addr, MAC_ADDRESS_LENGTH) == 0){
-                    // Release semaphores before returning
-                    xSemaphoreGive(sensorMutex); 
-                    xSemaphoreGive(controlMutex);
-                    return i;
-                }
-            }
-            if (rooms[i].control.registered){
-                if(memcmp(rooms[i].control.mac_addr, mac_addr, MAC_ADDRESS_LENGTH) == 0){
-                    // Release semaphore before returning
-                    xSemaphoreGive(sensorMutex); 
-                    xSemaphoreGive(controlMutex);
-                    return i;
-                }
-            }
+uint8_t DataManager::getId(const uint8_t* mac_addr) const {
+    // Runs for every frame in espnowTask, so it never waits for a web task holding a mutex
+    for (uint8_t i = 0; i < numRooms; i++){
+        SensorState sensor = sensorState[i].read();
+        if (sensor.registered && memcmp(sensor.mac_addr, mac_addr, MAC_ADDRESS_LENGTH) == 0){
+            return i;
         }
-    xSemaphoreGive(sensorMutex);
-    xSemaphoreGive(controlMutex);
+        ControlData control = controlState[i].read();
+        if (control.registered && memcmp(control.mac_addr, mac_addr, MAC_ADDRESS_LENGTH) == 0){
+            return i;
+        }
+    }
     LOG_WARNING("MAC address is not registered.");
     return ID_NOT_VALID;
 }
@@ -207,6 +608,7 @@ void DataManager::controlSetup(uint8_t room_id, const uint8_t* mac_addr, bool li
             rooms[room_id].control.registered = true; 
             rooms[room_id].control.pending_update = false; // No pending update initially
             rooms[room_id].control.latest_heartbeat = millis();
+            publishControl(room_id);
         xSemaphoreGive(controlMutex);
 
         LOG_INFO("Control setup for room %u: Warm=%02u:%02u, Cold=%02u:%02u", room_id, warm_hour, warm_min, cold_hour, cold_min);
@@ -217,6 +619,7 @@ void DataManager::updateHeartbeat(uint8_t room_id){
     if (roomIdIsValid(room_id)) {
         xSemaphoreTake(controlMutex, portMAX_DELAY);
             rooms[room_id].control.latest_heartbeat = millis();
+            publishControl(room_id);
         xSemaphoreGive(controlMutex);
 
         LOG_INFO("Heartbeat from room with ID %u was successfully updated", room_id);
@@ -225,33 +628,24 @@ void DataManager::updateHeartbeat(uint8_t room_id){
 
 uint32_t DataManager::getLatestHeartbeat(uint8_t room_id){
     if (roomIdIsValid(room_id)){
-        uint32_t latest_heartbeat;
-        xSemaphoreTake(controlMutex, portMAX_DELAY);
-            latest_heartbeat = rooms[room_id].control.latest_heartbeat;
-        xSemaphoreGive(controlMutex);
-        return latest_heartbeat;
+        return controlState[room_id].read().latest_heartbeat;
     }
     return 0;
 }
 
 bool DataManager::isRegistered(uint8_t room_id, NodeType type){
     bool value = false;
+    if (!roomIdIsValid(room_id)){
+        return false;
+    }
     if (type == NodeType::NONE){
-        xSemaphoreTake(controlMutex, portMAX_DELAY);
-        xSemaphoreTake(sensorMutex, portMAX_DELAY);
-            value = rooms[room_id].isRegistered();
-        xSemaphoreGive(sensorMutex);
-        xSemaphoreGive(controlMutex);
+        value = sensorState[room_id].read().registered || controlState[room_id].read().registered;
     }
     else if (type == NodeType::ROOM){
-        xSemaphoreTake(controlMutex, portMAX_DELAY);
-            value = rooms[room_id].control.registered;
-        xSemaphoreGive(controlMutex);
+        value = controlState[room_id].read().registered;
     }
     else if (type == NodeType::SENSOR){
-        xSemaphoreTake(sensorMutex, portMAX_DELAY);
-            value = rooms[room_id].sensor.registered;
-        xSemaphoreGive(sensorMutex);
+        value = sensorState[room_id].read().registered;
     }
     else {
         LOG_WARNING("Unknown NodeType provided to isRegistered.");
@@ -264,23 +658,22 @@ void DataManager::unregisterNode(uint8_t room_id, NodeType type){
     if (type == NodeType::ROOM){
         xSemaphoreTake(controlMutex, portMAX_DELAY);
             rooms[room_id].control.registered = false; 
+            publishControl(room_id);
         xSemaphoreGive(controlMutex);
     } else if (type == NodeType::SENSOR){
         xSemaphoreTake(sensorMutex, portMAX_DELAY);
             rooms[room_id].sensor.registered = false; 
+            publishSensor(room_id);
         xSemaphoreGive(sensorMutex);
     }
 }
 
 bool DataManager::checkIfSensorActive(uint8_t room_id){
-    uint32_t latest_time;
-    uint32_t sleep_period;
-    xSemaphoreTake(sensorMutex, portMAX_DELAY);
-        latest_time = rooms[room_id].sensor.latest_sensor_reception;
-        sleep_period = rooms[room_id].sensor.sleep_period_ms;
-    xSemaphoreGive(sensorMutex);
+    SensorState sensor = sensorState[room_id].read();
+    // Batching sensors only talk every uplink_every sleep periods
+    uint32_t sleep_period = sensor.sleep_period_ms * sensor.uplink_every;
 
-    if (millis() - latest_time > sleep_period * 1.2){
+    if (millis() - sensor.latest_sensor_reception > sleep_period * 1.2){
         return false;
     }
     return true;
@@ -290,6 +683,27 @@ void DataManager::setLightsOn(uint8_t room_id, bool on) {
     if (roomIdIsValid(room_id)) {
         xSemaphoreTake(controlMutex, portMAX_DELAY);
         rooms[room_id].control.lights_on = on;
+        publishControl(room_id);
         xSemaphoreGive(controlMutex);
     }
-}
\ No newline at end of file
+}
+
+void DataManager::publishSensor(uint8_t room_id) {
+    const SensorData& sensor = rooms[room_id].sensor;
+    SensorState state;
+    state.registered = sensor.registered;
+    memcpy(state.mac_addr, sensor.mac_addr, MAC_ADDRESS_LENGTH);
+    state.pending_update = sensor.pending_update;
+    state.has_sample = sensor.valid_data_points > 0;
+    state.uplink_every = sensor.uplink_every;
+    state.sleep_period_ms = sensor.sleep_period_ms;
+    state.new_sleep_period_ms = sensor.new_sleep_period_ms;
+    state.latest_sensor_reception = sensor.latest_sensor_reception;
+    state.history_version = sensor.history_version;
+    state.latest = sensor.latest;
+    sensorState[room_id].write(state);
+}
+
+void DataManager::publishControl(uint8_t room_id) {
+    controlState[room_id].write(rooms[room_id].control);
+}
@@ -0,0 +1,99 @@
+/**
+ * @file HistoryFrame.cpp
+ * @brief Implementation of the binary history frame
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "MasterDevice/HistoryFrame.h"
+#include <math.h>
+
+namespace {
+
+void putUint16(uint8_t*& out, uint16_t value) {
+    *out++ = value & 0xFF;
+    *out++ = value >> 8;
+}
+
+void putUint32(uint8_t*& out, uint32_t value) {
+    putUint16(out, value & 0xFFFF);
+    putUint16(out, value >> 16);
+}
+
+// Hundredths, saturated to the int16 range
+void putFixed(uint8_t*& out, float value) {
+    long fixed = lroundf(value * FIXED_POINT_SCALE);
+    if (fixed > INT16_MAX) {
+        fixed = INT16_MAX;
+    } else if (fixed < INT16_MIN) {
+        fixed = INT16_MIN;
+    }
+    putUint16(out, static_cast<uint16_t>(static_cast<int16_t>(fixed)));
+}
+
+void putValues(uint8_t*& out, const HistoryPoint* points, uint16_t count, float HistoryPoint::*field) {
+    for (uint16_t i = 0; i < count; i++) {
+        putFixed(out, points[i].*field);
+    }
+}
+
+} // namespace
+
+bool HistoryFrame::flags(const HistoryPoint* points, uint16_t count, bool ranges, uint8_t& out_flags) {
+    out_flags = ranges ? HISTORY_FRAME_RANGES : 0;
+    for (uint16_t i = 1; i < count; i++) {
+        if (points[i].timestamp < points[i - 1].timestamp) {
+            return false;
+        }
+        if (points[i].timestamp - points[i - 1].timestamp > UINT16_MAX) {
+            out_flags |= HISTORY_FRAME_WIDE_DELTAS;
+        }
+    }
+    return true;
+}
+
+size_t HistoryFrame::size(const HistoryPoint* points, uint16_t count, bool ranges) {
+    uint8_t frame_flags;
+    if (!flags(points, count, ranges, frame_flags)) {
+        return 0;
+    }
+    size_t delta_size = (frame_flags & HISTORY_FRAME_WIDE_DELTAS) ? sizeof(uint32_t) : sizeof(uint16_t);
+    size_t value_arrays = ranges ? 6 : 2;
+    return HISTORY_FRAME_HEADER_SIZE + count * (delta_size + value_arrays * sizeof(int16_t));
+}
+
+void HistoryFrame::write(uint8_t* out, uint8_t room_id, HistoryResolution resolution, const HistoryPoint* points,
+                         uint16_t count, bool ranges) {
+    uint8_t frame_flags;
+    flags(points, count, ranges, frame_flags);
+    uint32_t base = count > 0 ? static_cast<uint32_t>(points[0].timestamp) : 0;
+
+    *out++ = HISTORY_FRAME_TYPE;
+    *out++ = HISTORY_FRAME_VERSION;
+    *out++ = room_id;
+    *out++ = static_cast<uint8_t>(resolution);
+    *out++ = frame_flags;
+    *out++ = 0;
+    putUint16(out, count);
+    putUint32(out, base);
+
+    uint32_t previous = base;
+    for (uint16_t i = 0; i < count; i++) {
+        uint32_t timestamp = static_cast<uint32_t>(points[i].timestamp);
+        if (frame_flags & HISTORY_FRAME_WIDE_DELTAS) {
+            putUint32(out, timestamp - previous);
+        } else {
+            putUint16(out, timestamp - previous);
+        }
+        previous = timestamp;
+    }
+    putValues(out, points, count, &HistoryPoint::temperature);
+    putValues(out, points, count, &HistoryPoint::humidity);
+    if (ranges) {
+        putValues(out, points, count, &HistoryPoint::min_temperature);
+        putValues(out, points, count, &HistoryPoint::max_temperature);
+        putValues(out, points, count, &HistoryPoint::min_humidity);
+        putValues(out, points, count, &HistoryPoint::max_humidity);
+    }
+}
@@ -0,0 +1,374 @@
+/**
+ * @file HistoryLog.cpp
+ * @brief Implementation of the append-only sample log on LittleFS
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "MasterDevice/HistoryLog.h"
+
+namespace {
+// Records moved per read while copying or replaying a segment
+constexpr uint16_t RECORDS_PER_READ = 32;
+constexpr size_t RECORD_SIZE = sizeof(HistoryRecord);
+constexpr size_t CRC_COVERED_BYTES = RECORD_SIZE - sizeof(uint16_t);
+constexpr size_t PATH_LENGTH = 32;
+}
+
+HistoryLog::HistoryLog()
+    : pendingCount(0), oldestPendingMs(0), dropped(0), numSegments(0), activeSize(0), newestTimestamp(0) {
+    logMutex = xSemaphoreCreateMutex();
+}
+
+bool HistoryLog::begin() {
+    if (!LittleFS.exists(HISTORY_LOG_DIR) && !LittleFS.mkdir(HISTORY_LOG_DIR)) {
+        LOG_ERROR("Failed to create %s", HISTORY_LOG_DIR);
+        return false;
+    }
+
+    File dir = LittleFS.open(HISTORY_LOG_DIR);
+    if (!dir || !dir.isDirectory()) {
+        LOG_ERROR("Failed to open %s", HISTORY_LOG_DIR);
+        return false;
+    }
+
+    numSegments = 0;
+    File entry = dir.openNextFile();
+    while (entry) {
+        const char* name = entry.name();
+        const char* slash = strrchr(name, '/');
+        name = slash != nullptr ? slash + 1 : name;
+        char* end;
+        uint32_t segment = strtoul(name, &end, 16);
+        bool is_segment = end != name && strcmp(end, ".log") == 0;
+        entry.close();
+
+        char path[PATH_LENGTH];
+        snprintf(path, sizeof(path), "%s/%s", HISTORY_LOG_DIR, name);
+        if (!is_segment) {
+            // Leftover of a compaction cut by a reset, the segments it merged are still there
+            LittleFS.remove(path);
+        } else {
+            // Insertion keeps the list sorted, when it is full the oldest segment is dropped
+            if (numSegments == MAX_LISTED_SEGMENTS) {
+                if (segment < segments[0]) {
+                    LittleFS.remove(path);
+                    entry = dir.openNextFile();
+                    continue;
+                }
+                char oldest[PATH_LENGTH];
+                segmentPath(segments[0], oldest, sizeof(oldest));
+                LittleFS.remove(oldest);
+                memmove(segments, segments + 1, (numSegments - 1) * sizeof(segments[0]));
+                numSegments--;
+            }
+            uint8_t i = numSegments;
+            while (i > 0 && segments[i - 1] > segment) {
+                segments[i] = segments[i - 1];
+                i--;
+            }
+            segments[i] = segment;
+            numSegments++;
+        }
+        entry = dir.openNextFile();
+    }
+    dir.close();
+
+    // A torn record at the end of the last segment would misalign every later append
+    if (numSegments > 0) {
+        activeSize = fileSize(segments[numSegments - 1]);
+    }
+    if (numSegments == 0 || activeSize % RECORD_SIZE != 0 || activeSize >= HISTORY_SEGMENT_BYTES) {
+        startSegment();
+    }
+    LOG_INFO("History log has %u segments", numSegments);
+    return true;
+}
+
+void HistoryLog::append(uint8_t room_id, uint32_t room_key, time_t timestamp, int16_t temperature, uint16_t humidity) {
+    HistoryRecord record;
+    record.timestamp = static_cast<uint32_t>(timestamp);
+    record.temperature = temperature;
+    record.humidity = humidity;
+    record.room_id = room_id;
+    record.room_key = room_key;
+    record.reserved = 0;
+    record.crc = crc16(reinterpret_cast<const uint8_t*>(&record), CRC_COVERED_BYTES);
+
+    xSemaphoreTake(logMutex, portMAX_DELAY);
+        if (pendingCount == HISTORY_LOG_BUFFER) {
+            dropped++;
+        } else {
+            if (pendingCount == 0) {
+                oldestPendingMs = millis();
+            }
+            pending[pendingCount++] = record;
+        }
+    xSemaphoreGive(logMutex);
+}
+
+void HistoryLog::flush(bool force) {
+    // Only the update check task flushes, so the copy can live in a static buffer
+    static HistoryRecord batch[HISTORY_LOG_BUFFER];
+    uint16_t count = 0;
+
+    xSemaphoreTake(logMutex, portMAX_DELAY);
+        if (pendingCount > 0 &&
+            (force || pendingCount >= HISTORY_LOG_BATCH || millis() - oldestPendingMs >= HISTORY_FLUSH_PERIOD_MS)) {
+            count = pendingCount;
+            memcpy(batch, pending, count * RECORD_SIZE);
+            pendingCount = 0;
+        }
+    xSemaphoreGive(logMutex);
+
+    if (count > 0) {
+        write(batch, count);
+    }
+}
+
+uint32_t HistoryLog::replay(const uint32_t* needed, const uint32_t* keys, uint8_t num_rooms, ReplayCallback callback,
+                            void* context) {
+    if (numSegments == 0 || callback == nullptr) {
+        return 0;
+    }
+    uint32_t remaining[MAX_ROOMS];
+    uint8_t unsatisfied = 0;
+    for (uint8_t i = 0; i < num_rooms && i < MAX_ROOMS; i++) {
+        remaining[i] = needed[i];
+        if (remaining[i] > 0) {
+            unsatisfied++;
+        }
+    }
+
+    HistoryRecord records[RECORDS_PER_READ];
+    char path[PATH_LENGTH];
+
+    // Walks back from the newest segment until every room has the samples it needs
+    uint8_t first = numSegments;
+    while (first > 0 && unsatisfied > 0) {
+        first--;
+        segmentPath(segments[first], path, sizeof(path));
+        File file = LittleFS.open(path, "r");
+        size_t bytes;
+        while (file && (bytes = file.read(reinterpret_cast<uint8_t*>(records), sizeof(records))) > 0) {
+            for (size_t i = 0; i < bytes / RECORD_SIZE; i++) {
+                uint8_t room_id = records[i].room_id;
+                if (belongsTo(records[i], keys, num_rooms) && isValid(records[i]) && remaining[room_id] > 0) {
+                    if (--remaining[room_id] == 0) {
+                        unsatisfied--;
+                    }
+                }
+            }
+        }
+        file.close();
+    }
+
+    // Then replays forward from there, so every room receives its samples oldest first
+    uint32_t replayed = 0;
+    uint32_t foreign = 0;
+    for (uint8_t s = first; s < numSegments; s++) {
+        segmentPath(segments[s], path, sizeof(path));
+        File file = LittleFS.open(path, "r");
+        size_t bytes;
+        while (file && (bytes = file.read(reinterpret_cast<uint8_t*>(records), sizeof(records))) > 0) {
+            for (size_t i = 0; i < bytes / RECORD_SIZE; i++) {
+                if (!isValid(records[i])) {
+                    continue;
+                }
+                if (records[i].timestamp > newestTimestamp) {
+                    newestTimestamp = records[i].timestamp;
+                }
+                if (belongsTo(records[i], keys, num_rooms)) {
+                    callback(records[i], context);
+                    replayed++;
+                } else {
+                    foreign++;
+                }
+            }
+        }
+        file.close();
+    }
+    LOG_INFO("Replayed %u history records from %u segments", (unsigned)replayed, numSegments - first);
+    if (foreign > 0) {
+        LOG_WARNING("Skipped %u history records of rooms no longer in %s", (unsigned)foreign, ROOMS_CONFIG_PATH);
+    }
+    return replayed;
+}
+
+void HistoryLog::write(const HistoryRecord* records, uint16_t count) {
+    char path[PATH_LENGTH];
+    while (count > 0) {
+        uint32_t room = (HISTORY_SEGMENT_BYTES - activeSize) / RECORD_SIZE;
+        if (room == 0) {
+            startSegment();
+            continue;
+        }
+        uint16_t chunk = count < room ? count : room;
+
+        segmentPath(segments[numSegments - 1], path, sizeof(path));
+        File file = LittleFS.open(path, "a");
+        size_t written = file ? file.write(reinterpret_cast<const uint8_t*>(records), chunk * RECORD_SIZE) : 0;
+        file.close();
+        activeSize += written;
+        if (written != chunk * RECORD_SIZE) {
+            LOG_ERROR("History log write failed, %u samples lost", count);
+            // Keeps appends aligned to whole records after a partial write
+            if (activeSize % RECORD_SIZE != 0) {
+                startSegment();
+            }
+            return;
+        }
+
+        for (uint16_t i = 0; i < chunk; i++) {
+            if (records[i].timestamp > newestTimestamp) {
+                newestTimestamp = records[i].timestamp;
+            }
+        }
+        records += chunk;
+        count -= chunk;
+    }
+}
+
+void HistoryLog::startSegment() {
+    uint32_t segment = numSegments > 0 ? segments[numSegments - 1] + 1 : 1;
+    char path[PATH_LENGTH];
+    segmentPath(segment, path, sizeof(path));
+    File file = LittleFS.open(path, "w");
+    file.close();
+
+    segments[numSegments++] = segment;
+    activeSize = 0;
+
+    compact();
+    enforceRetention();
+}
+
+void HistoryLog::compact() {
+    // The active segment is never merged
+    for (uint8_t i = 0; i + 2 < numSegments; i++) {
+        uint32_t older = segments[i];
+        uint32_t newer = segments[i + 1];
+        if (fileSize(older) + fileSize(newer) > HISTORY_SEGMENT_BYTES) {
+            continue;
+        }
+
+        char older_path[PATH_LENGTH];
+        char newer_path[PATH_LENGTH];
+        char tmp_path[PATH_LENGTH + 4];  // Room for the ".tmp" suffix
+        segmentPath(older, older_path, sizeof(older_path));
+        segmentPath(newer, newer_path, sizeof(newer_path));
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", older_path);
+
+        File out = LittleFS.open(tmp_path, "w");
+        if (!out) {
+            return;
+        }
+        uint32_t kept = copyRecords(older, out);
+        kept += copyRecords(newer, out);
+        out.close();
+
+        // The rename replaces the older segment atomically. A reset before the newer one is removed
+        // only leaves its records twice
+        if (!LittleFS.rename(tmp_path, older_path)) {
+            LittleFS.remove(tmp_path);
+            return;
+        }
+        LittleFS.remove(newer_path);
+        memmove(segments + i + 1, segments + i + 2, (numSegments - i - 2) * sizeof(segments[0]));
+        numSegments--;
+        LOG_INFO("Merged history segments %08x and %08x, %u records kept", (unsigned)older, (unsigned)newer,
+                 (unsigned)kept);
+        return;
+    }
+}
+
+void HistoryLog::enforceRetention() {
+    char path[PATH_LENGTH];
+    while (numSegments > 1) {
+        segmentPath(segments[0], path, sizeof(path));
+
+        bool expired = false;
+        File file = LittleFS.open(path, "r");
+        if (file && file.size() >= RECORD_SIZE) {
+            // The last whole record is the newest of the segment
+            HistoryRecord last;
+            file.seek((file.size() / RECORD_SIZE - 1) * RECORD_SIZE);
+            if (file.read(reinterpret_cast<uint8_t*>(&last), RECORD_SIZE) == RECORD_SIZE && isValid(last)) {
+                expired = last.timestamp + HISTORY_RETENTION_S < newestTimestamp;
+            }
+        }
+        file.close();
+
+        if (numSegments <= HISTORY_MAX_SEGMENTS && !expired) {
+            return;
+        }
+        LittleFS.remove(path);
+        memmove(segments, segments + 1, (numSegments - 1) * sizeof(segments[0]));
+        numSegments--;
+    }
+}
+
+uint32_t HistoryLog::copyRecords(uint32_t segment, File& out) {
+    char path[PATH_LENGTH];
+    segmentPath(segment, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    if (!file) {
+        return 0;
+    }
+
+    HistoryRecord records[RECORDS_PER_READ];
+    uint32_t copied = 0;
+    size_t bytes;
+    while ((bytes = file.read(reinterpret_cast<uint8_t*>(records), sizeof(records))) > 0) {
+        for (size_t i = 0; i < bytes / RECORD_SIZE; i++) {
+            if (isValid(records[i]) && records[i].timestamp + HISTORY_RETENTION_S >= newestTimestamp) {
+                out.write(reinterpret_cast<const uint8_t*>(&records[i]), RECORD_SIZE);
+                copied++;
+            }
+        }
+    }
+    file.close();
+    return copied;
+}
+
+void HistoryLog::segmentPath(uint32_t segment, char* path, size_t size) {
+    snprintf(path, size, "%s/%08x.log", HISTORY_LOG_DIR, (unsigned)segment);
+}
+
+uint32_t HistoryLog::fileSize(uint32_t segment) {
+    char path[PATH_LENGTH];
+    segmentPath(segment, path, sizeof(path));
+    File file = LittleFS.open(path, "r");
+    uint32_t size = file ? file.size() : 0;
+    file.close();
+    return size;
+}
+
+uint16_t HistoryLog::crc16(const uint8_t* data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= static_cast<uint16_t>(data[i]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint32_t HistoryLog::roomKey(const char* name) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (const char* c = name; *c != '\0'; c++) {
+        hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+    }
+    return hash;
+}
+
+bool HistoryLog::belongsTo(const HistoryRecord& record, const uint32_t* keys, uint8_t num_rooms) {
+    return record.room_id < num_rooms && keys[record.room_id] == record.room_key;
+}
+
+bool HistoryLog::isValid(const HistoryRecord& record) {
+    return crc16(reinterpret_cast<const uint8_t*>(&record), CRC_COVERED_BYTES) == record.crc;
+}
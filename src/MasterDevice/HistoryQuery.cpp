@@ -0,0 +1,337 @@
+/**
+ * @file HistoryQuery.cpp
+ * @brief Implementation of the time-range history queries
+ *
+ * A result longer than max_points is built in three passes over the range, none of which buffers the
+ * source: the first counts the points, the second stores the average of every LTTB bucket in the slot
+ * of the output that bucket will fill, and the third picks from each bucket the point that forms the
+ * largest triangle with the point picked before and the average of the next bucket, which is still in
+ * its slot. Only the cache entry buffer is used.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "MasterDevice/HistoryQuery.h"
+#include <esp_heap_caps.h>
+#include <math.h>
+
+namespace {
+
+// First pass, size and end of the range
+struct CountPass {
+    uint32_t count;
+    time_t last;
+};
+
+// Result that needs no downsampling
+struct CopyPass {
+    HistoryPoint* points;
+    uint16_t capacity;
+    uint32_t index;
+};
+
+// Second pass, bucket averages
+struct AveragePass {
+    HistoryPoint* points;
+    uint32_t total;
+    uint16_t max_points;
+    double every;           // Points per bucket
+    uint32_t index;
+    int32_t bucket;
+    uint32_t in_bucket;
+    double sum_timestamp;
+    double sum_temperature;
+    double sum_humidity;
+};
+
+// Third pass, one point per bucket
+struct SelectPass {
+    HistoryPoint* points;
+    uint32_t total;
+    uint16_t max_points;
+    double every;
+    uint32_t index;
+    int32_t bucket;
+    HistoryPoint previous;  // Last point picked
+    HistoryPoint best;
+    double best_area;
+};
+
+// Forwards the samples or buckets of the source as HistoryPoints
+struct SourceAdapter {
+    HistoryPointVisitor visitor;
+    void* context;
+};
+
+bool sampleToPoint(const SensorSample& sample, void* context) {
+    if (sample.timestamp == 0 || sample.temperature == NO_HT_VALUE || sample.humidity == NO_HT_VALUE) {
+        return true;
+    }
+    SourceAdapter* adapter = static_cast<SourceAdapter*>(context);
+    HistoryPoint point;
+    point.timestamp = sample.timestamp;
+    point.temperature = point.min_temperature = point.max_temperature = sample.temperature;
+    point.humidity = point.min_humidity = point.max_humidity = sample.humidity;
+    return adapter->visitor(point, adapter->context);
+}
+
+bool bucketToPoint(const RollupBucket& bucket, void* context) {
+    if (bucket.count == 0) {
+        return true;
+    }
+    SourceAdapter* adapter = static_cast<SourceAdapter*>(context);
+    HistoryPoint point;
+    point.timestamp = bucket.start;
+    point.temperature = bucket.avgTemperature();
+    point.humidity = bucket.avgHumidity();
+    point.min_temperature = bucket.min_temperature;
+    point.max_temperature = bucket.max_temperature;
+    point.min_humidity = bucket.min_humidity;
+    point.max_humidity = bucket.max_humidity;
+    return adapter->visitor(point, adapter->context);
+}
+
+// Bucket of the point at index, for 1 <= index <= total - 2
+int32_t bucketOf(uint32_t index, double every, uint16_t max_points) {
+    int32_t bucket = static_cast<int32_t>((index - 1) / every);
+    return bucket < max_points - 3 ? bucket : max_points - 3;
+}
+
+bool countPoint(const HistoryPoint& point, void* context) {
+    CountPass* pass = static_cast<CountPass*>(context);
+    pass->count++;
+    pass->last = point.timestamp;
+    return true;
+}
+
+bool copyPoint(const HistoryPoint& point, void* context) {
+    CopyPass* pass = static_cast<CopyPass*>(context);
+    if (pass->index >= pass->capacity) {
+        return false;
+    }
+    pass->points[pass->index++] = point;
+    return true;
+}
+
+void storeAverage(AveragePass* pass) {
+    if (pass->in_bucket == 0) {
+        return;
+    }
+    HistoryPoint& average = pass->points[pass->bucket + 1];
+    average.timestamp = static_cast<time_t>(pass->sum_timestamp / pass->in_bucket);
+    average.temperature = pass->sum_temperature / pass->in_bucket;
+    average.humidity = pass->sum_humidity / pass->in_bucket;
+    pass->in_bucket = 0;
+    pass->sum_timestamp = pass->sum_temperature = pass->sum_humidity = 0;
+}
+
+bool averagePoint(const HistoryPoint& point, void* context) {
+    AveragePass* pass = static_cast<AveragePass*>(context);
+    uint32_t index = pass->index++;
+    if (index == 0) {
+        pass->points[0] = point;
+        return true;
+    }
+    if (index >= pass->total - 1) {
+        pass->points[pass->max_points - 1] = point;
+        return false;
+    }
+    int32_t bucket = bucketOf(index, pass->every, pass->max_points);
+    if (bucket != pass->bucket) {
+        storeAverage(pass);
+        pass->bucket = bucket;
+    }
+    pass->in_bucket++;
+    pass->sum_timestamp += point.timestamp;
+    pass->sum_temperature += point.temperature;
+    pass->sum_humidity += point.humidity;
+    return true;
+}
+
+// Twice the area of the triangle, summed over both channels. Time is relative to a to keep the precision
+double triangleArea(const HistoryPoint& a, const HistoryPoint& b, const HistoryPoint& c) {
+    double xb = static_cast<double>(b.timestamp - a.timestamp);
+    double xc = static_cast<double>(c.timestamp - a.timestamp);
+    double temperature = fabs(xb * (c.temperature - a.temperature) - xc * (b.temperature - a.temperature));
+    double humidity = fabs(xb * (c.humidity - a.humidity) - xc * (b.humidity - a.humidity));
+    return temperature + humidity;
+}
+
+bool selectPoint(const HistoryPoint& point, void* context) {
+    SelectPass* pass = static_cast<SelectPass*>(context);
+    uint32_t index = pass->index++;
+    if (index == 0) {
+        pass->previous = point;
+        return true;
+    }
+    if (index >= pass->total - 1) {
+        pass->points[pass->bucket + 1] = pass->best;
+        return false;
+    }
+    int32_t bucket = bucketOf(index, pass->every, pass->max_points);
+    if (bucket != pass->bucket) {
+        // The average of this bucket in its slot is not needed any more
+        if (pass->bucket >= 0) {
+            pass->points[pass->bucket + 1] = pass->best;
+            pass->previous = pass->best;
+        }
+        pass->bucket = bucket;
+        pass->best_area = -1;
+    }
+    double area = triangleArea(pass->previous, point, pass->points[bucket + 2]);
+    if (area > pass->best_area) {
+        pass->best_area = area;
+        pass->best = point;
+    }
+    return true;
+}
+
+bool sameRequest(const HistoryRequest& a, const HistoryRequest& b) {
+    return a.room_id == b.room_id && a.resolution == b.resolution && a.from == b.from && a.to == b.to &&
+           a.max_points == b.max_points;
+}
+
+} // namespace
+
+HistoryQuery::HistoryQuery(DataManager& dataManager) : dataManager(dataManager), useCounter(0) {
+    queryMutex = xSemaphoreCreateMutex();
+    if (queryMutex == nullptr) {
+        LOG_ERROR("Failed to create history query mutex");
+    }
+    for (uint8_t i = 0; i < HISTORY_QUERY_CACHE_ENTRIES; i++) {
+        cache[i].valid = false;
+        cache[i].points = nullptr;
+    }
+}
+
+HistoryQuery::~HistoryQuery() {
+    for (uint8_t i = 0; i < HISTORY_QUERY_CACHE_ENTRIES; i++) {
+        heap_caps_free(cache[i].points);
+    }
+    if (queryMutex != nullptr) {
+        vSemaphoreDelete(queryMutex);
+    }
+}
+
+bool HistoryQuery::run(const HistoryRequest& request, HistoryResultHandler handler, void* context) {
+    if (request.room_id >= dataManager.getNumRooms() || handler == nullptr || request.from > request.to) {
+        return false;
+    }
+    HistoryRequest key = request;
+    if (key.max_points == 0 || key.max_points > HISTORY_MAX_QUERY_POINTS) {
+        key.max_points = HISTORY_MAX_QUERY_POINTS;
+    } else if (key.max_points < 3) {
+        key.max_points = 3;
+    }
+
+    xSemaphoreTake(queryMutex, portMAX_DELAY);
+        // Read before computing: a sample added meanwhile leaves the entry stale, never the other way round
+        uint32_t version = dataManager.getHistoryVersion(key.room_id);
+        CacheEntry* entry = lookup(key, version);
+        if (entry == nullptr) {
+            entry = reserve();
+            if (entry != nullptr) {
+                bool computed = false;
+                for (uint8_t attempt = 0; attempt < MAX_QUERY_ATTEMPTS && !computed; attempt++) {
+                    computed = compute(key, *entry);
+                }
+                if (computed) {
+                    entry->valid = true;
+                    entry->request = key;
+                    entry->version = version;
+                } else {
+                    LOG_WARNING("History of room %u kept changing during the query", key.room_id);
+                    entry = nullptr;
+                }
+            }
+        }
+        if (entry != nullptr) {
+            entry->last_used = ++useCounter;
+            handler(entry->points, entry->count, context);
+        }
+    xSemaphoreGive(queryMutex);
+    return entry != nullptr;
+}
+
+HistoryQuery::CacheEntry* HistoryQuery::lookup(const HistoryRequest& request, uint32_t version) {
+    for (uint8_t i = 0; i < HISTORY_QUERY_CACHE_ENTRIES; i++) {
+        if (cache[i].valid && cache[i].version == version && sameRequest(cache[i].request, request)) {
+            return &cache[i];
+        }
+    }
+    return nullptr;
+}
+
+HistoryQuery::CacheEntry* HistoryQuery::reserve() {
+    CacheEntry* oldest = &cache[0];
+    for (uint8_t i = 1; i < HISTORY_QUERY_CACHE_ENTRIES; i++) {
+        if (!cache[i].valid || (oldest->valid && cache[i].last_used < oldest->last_used)) {
+            oldest = &cache[i];
+            if (!oldest->valid) {
+                break;
+            }
+        }
+    }
+    oldest->valid = false;
+    if (oldest->points == nullptr) {
+        uint32_t caps = psramFound() ? MALLOC_CAP_SPIRAM : MALLOC_CAP_8BIT;
+        oldest->points = static_cast<HistoryPoint*>(heap_caps_malloc(HISTORY_MAX_QUERY_POINTS * sizeof(HistoryPoint),
+                                                                     caps));
+        if (oldest->points == nullptr) {
+            LOG_ERROR("Failed to allocate history query cache entry");
+        }
+    }
+    return oldest->points != nullptr ? oldest : nullptr;
+}
+
+bool HistoryQuery::compute(const HistoryRequest& request, CacheEntry& entry) const {
+    CountPass count = {0, 0};
+    visitSource(request, request.to, countPoint, &count);
+    entry.count = 0;
+    if (count.count == 0) {
+        return true;
+    }
+    // Samples added during the query are newer than count.last, so later passes end at it
+    if (count.count <= request.max_points) {
+        CopyPass copy = {entry.points, request.max_points, 0};
+        visitSource(request, count.last, copyPoint, &copy);
+        entry.count = copy.index;
+        return copy.index == count.count;
+    }
+
+    AveragePass average = {};
+    average.points = entry.points;
+    average.total = count.count;
+    average.max_points = request.max_points;
+    average.every = static_cast<double>(count.count - 2) / (request.max_points - 2);
+    average.bucket = -1;
+    visitSource(request, count.last, averagePoint, &average);
+    storeAverage(&average);
+    if (average.index != count.count) {
+        return false;   // A block was dropped, some slots would hold another query's data
+    }
+
+    SelectPass select = {};
+    select.points = entry.points;
+    select.total = count.count;
+    select.max_points = request.max_points;
+    select.every = average.every;
+    select.bucket = -1;
+    visitSource(request, count.last, selectPoint, &select);
+    if (select.index != count.count) {
+        return false;
+    }
+    entry.count = request.max_points;
+    return true;
+}
+
+void HistoryQuery::visitSource(const HistoryRequest& request, time_t to, HistoryPointVisitor visitor,
+                               void* context) const {
+    SourceAdapter adapter = {visitor, context};
+    if (request.resolution == HistoryResolution::RAW) {
+        dataManager.visitHistory(request.room_id, request.from, to, sampleToPoint, &adapter);
+    } else {
+        dataManager.visitRollups(request.room_id, request.resolution, request.from, to, bucketToPoint, &adapter);
+    }
+}
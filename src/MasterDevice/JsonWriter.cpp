@@ -0,0 +1,140 @@
+/**
+ * @file JsonWriter.cpp
+ * @brief Implementation of the streaming JSON writer
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "MasterDevice/JsonWriter.h"
+#include <math.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity)
+    : buffer(buffer), capacity(capacity), used(0), overflow(false), depth(0), afterKey(false) {
+    first[0] = true;
+}
+
+void JsonWriter::key(const char* name) {
+    separator();
+    writeString(name);
+    write(':');
+    afterKey = true;
+}
+
+void JsonWriter::beginObject() {
+    separator();
+    write('{');
+    push();
+}
+
+void JsonWriter::endObject() {
+    pop();
+    write('}');
+}
+
+void JsonWriter::beginArray() {
+    separator();
+    write('[');
+    push();
+}
+
+void JsonWriter::endArray() {
+    pop();
+    write(']');
+}
+
+void JsonWriter::string(const char* value) {
+    separator();
+    writeString(value);
+}
+
+void JsonWriter::writeString(const char* value) {
+    write('"');
+    for (const char* c = value; *c != '\0'; c++) {
+        switch (*c) {
+            case '"': write("\\\"", 2); break;
+            case '\\': write("\\\\", 2); break;
+            case '\n': write("\\n", 2); break;
+            case '\r': write("\\r", 2); break;
+            case '\t': write("\\t", 2); break;
+            default:
+                if (static_cast<uint8_t>(*c) < 0x20) {
+                    char escaped[7];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<uint8_t>(*c));
+                    write(escaped, 6);
+                } else {
+                    write(*c);  // UTF-8 bytes go through unchanged
+                }
+        }
+    }
+    write('"');
+}
+
+void JsonWriter::number(long value) {
+    separator();
+    char text[24];  // Fits a 64-bit long, as on the host builds
+    int len = snprintf(text, sizeof(text), "%ld", value);
+    write(text, len < static_cast<int>(sizeof(text)) ? len : sizeof(text) - 1);
+}
+
+void JsonWriter::decimal(float value) {
+    separator();
+    if (isnan(value) || isinf(value)) {
+        write("null", 4);
+        return;
+    }
+    char text[48];  // Fits -FLT_MAX with two decimals
+    int len = snprintf(text, sizeof(text), "%.2f", value);
+    write(text, len < static_cast<int>(sizeof(text)) ? len : sizeof(text) - 1);
+}
+
+void JsonWriter::boolean(bool value) {
+    separator();
+    if (value) {
+        write("true", 4);
+    } else {
+        write("false", 5);
+    }
+}
+
+void JsonWriter::separator() {
+    if (afterKey) {
+        afterKey = false;
+        return;
+    }
+    if (!first[depth]) {
+        write(',');
+    }
+    first[depth] = false;
+}
+
+void JsonWriter::push() {
+    if (depth + 1 >= MAX_DEPTH) {
+        overflow = true;
+        return;
+    }
+    first[++depth] = true;
+}
+
+void JsonWriter::pop() {
+    if (depth > 0) {
+        depth--;
+    }
+}
+
+void JsonWriter::write(char c) {
+    if (buffer != nullptr) {
+        if (used >= capacity) {
+            overflow = true;
+            return;
+        }
+        buffer[used] = c;
+    }
+    used++;
+}
+
+void JsonWriter::write(const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        write(data[i]);
+    }
+}
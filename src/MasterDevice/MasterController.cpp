@@ -12,11 +12,14 @@
 static MasterController* instance = nullptr;
 
 MasterController::MasterController() 
-    : communications(), 
-      webSockets(dataManager) 
+    : nextSceneId(0),
+      communications(), 
+      webSockets(dataManager),
+      reportedIngressDrops(0)
 {
     instance = this;
-    espnowQueue = xQueueCreate(10, sizeof(IncomingMsg));
+    sceneMutex = xSemaphoreCreateMutex();
+    registerHandlers();
 }
 
 void MasterController::initialize() {
@@ -32,7 +35,7 @@ void MasterController::initialize() {
         LOG_ERROR("ESP-NOW initialization failed. Entering deep sleep.");
         tryLater();
     }
-    communications.setQueue(espnowQueue);
+    communications.setIngress(&ingress);
     
     // Initialize NTP and Web Server
     while(!ntpClient.initialize());
@@ -45,6 +48,11 @@ void MasterController::initialize() {
     webSockets.setSleepDurationCallback(MasterController::sleepPeriodChangedCallback);
     webSockets.setScheduleCallback(MasterController::scheduleChangedCallback);
     webSockets.setLightsToggleCallback(MasterController::lightsToggleCallback);
+    webSockets.setSceneCallback(MasterController::sceneCallback);
+
+    // Rooms and their history are read from LittleFS, mounted by the web server
+    dataManager.loadRooms();
+    dataManager.loadHistory();
 
     // Start Web Server Aync Execution
     webServer.start(); // Runs in any core by default
@@ -68,6 +76,18 @@ void MasterController::initialize() {
     if (result != pdPASS) {
         LOG_ERROR("Failed to create Update Check Task");
     }
+
+    // Create Web Publish Task
+    result = xTaskCreatePinnedToCore(webPublishTask,"Web Publish Task",4096,this,1,nullptr,1);
+    if (result != pdPASS) {
+        LOG_ERROR("Failed to create Web Publish Task");
+    }
+
+    // Create Beacon Task
+    result = xTaskCreatePinnedToCore(beaconTask,"Beacon Task",2048,this,1,nullptr,1);
+    if (result != pdPASS) {
+        LOG_ERROR("Failed to create Beacon Task");
+    }
 }
 
 void MasterController::sleepPeriodChangedCallback(uint8_t room_id, uint32_t new_sleep_period_ms) {
@@ -83,16 +103,15 @@ void MasterController::scheduleChangedCallback(uint8_t room_id, uint8_t warm_hou
                       room_id, warm_hour, warm_min, cold_hour, cold_min);
         instance->dataManager.setNewSchedule(room_id, warm_hour, warm_min, cold_hour, cold_min);
         NewScheduleMsg scheduleMsg;
-        scheduleMsg.type = MessageType::NEW_SCHEDULE;
         scheduleMsg.warm = {warm_hour, warm_min};
         scheduleMsg.cold = {cold_hour, cold_min};
         uint8_t dest_mac[MAC_ADDRESS_LENGTH];
         if(instance->dataManager.getMacAddr(room_id, NodeType::ROOM, dest_mac)){
-            instance->communications.sendMsg(dest_mac, reinterpret_cast<uint8_t*>(&scheduleMsg), sizeof(scheduleMsg));
-            LOG_INFO("Sent NEW_SCHEDULE to room %u", 
-                        room_id);
-            instance->pendingScheduleUpdate[room_id].attempts++;
-            instance->pendingScheduleUpdate[room_id].lastAttemptMillis = millis();;
+            // Retransmitted by the transport until the RoomNode ACKs it, see scheduleSendComplete()
+            if (instance->communications.sendReliable(dest_mac, reinterpret_cast<uint8_t*>(&scheduleMsg), 
+                                                      sizeof(scheduleMsg), scheduleSendComplete, instance)) {
+                LOG_INFO("Sent NEW_SCHEDULE to room %u", room_id);
+            }
         } else {
             LOG_ERROR("Failed to get MAC address for room %u. Cannot send NEW_SCHEDULE.", room_id);
         }
@@ -103,193 +122,400 @@ void MasterController::scheduleChangedCallback(uint8_t room_id, uint8_t warm_hou
 void MasterController::lightsToggleCallback(uint8_t room_id, bool turn_on) {
     if (instance) {
         LightsToggleMsg toggleMsg;
-        toggleMsg.type = MessageType::LIGHTS_TOGGLE;
         toggleMsg.turn_on = turn_on;
 
         uint8_t room_mac[MAC_ADDRESS_LENGTH];
         if (instance->dataManager.getMacAddr(room_id, NodeType::ROOM, room_mac)) {
-            instance->communications.sendMsg(room_mac, reinterpret_cast<uint8_t*>(&toggleMsg), sizeof(LightsToggleMsg));
-            LOG_INFO("Sent LIGHTS_TOGGLE to room %u: %s", room_id, turn_on ? "ON" : "OFF");
+            if (instance->communications.sendReliable(room_mac, reinterpret_cast<uint8_t*>(&toggleMsg), sizeof(LightsToggleMsg))) {
+                LOG_INFO("Sent LIGHTS_TOGGLE to room %u: %s", room_id, turn_on ? "ON" : "OFF");
+            }
         } else {
             LOG_ERROR("Failed to get MAC address for room %u. Cannot toggle lights.", room_id);
         }
     }
 }
 
+// Broadcasts one SCENE frame for every addressed room instead of one unicast per room
+bool MasterController::sceneCallback(uint16_t room_mask, SceneCommand command, bool turn_on, Time warm, Time cold) {
+    if (!instance) {
+        return false;
+    }
+    MasterController* self = instance;
+
+    // Only registered RoomNodes are expected to ACK
+    for (uint8_t i = 0; i < self->dataManager.getNumRooms(); i++) {
+        if ((room_mask & (1u << i)) && !self->dataManager.isRegistered(i, NodeType::ROOM)) {
+            room_mask &= ~(1u << i);
+        }
+    }
+    room_mask &= (1u << self->dataManager.getNumRooms()) - 1;
+    if (room_mask == 0) {
+        LOG_WARNING("Scene addresses no registered room");
+        return false;
+    }
+
+    xSemaphoreTake(self->sceneMutex, portMAX_DELAY);
+    if (self->pendingScene.active) {
+        xSemaphoreGive(self->sceneMutex);
+        LOG_WARNING("Scene %u still in progress, new scene rejected", self->pendingScene.msg.scene_id);
+        return false;
+    }
+
+    PendingScene& scene = self->pendingScene;
+    scene.active = true;
+    scene.pending_mask = room_mask;
+    scene.acked_mask = 0;
+    scene.transmissions = 1;
+    scene.sent_at_ms = millis();
+    scene.msg.scene_id = self->nextSceneId++;
+    scene.msg.room_mask = room_mask;
+    scene.msg.command = command;
+    scene.msg.turn_on = turn_on;
+    scene.msg.warm = warm;
+    scene.msg.cold = cold;
+    SceneMsg msg = scene.msg;
+    xSemaphoreGive(self->sceneMutex);
+
+    if (command == SceneCommand::SCHEDULE) {
+        for (uint8_t i = 0; i < self->dataManager.getNumRooms(); i++) {
+            if (room_mask & (1u << i)) {
+                self->dataManager.setNewSchedule(i, warm.hour, warm.min, cold.hour, cold.min);
+            }
+        }
+    }
+
+    self->communications.sendBroadcast(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
+    LOG_INFO("Broadcast scene %u to rooms 0x%04X", msg.scene_id, room_mask);
+    return true;
+}
+
+void MasterController::onSceneAck(const uint8_t* mac_addr, uint8_t scene_id) {
+    uint8_t room_id = dataManager.getId(mac_addr);
+    if (room_id == ID_NOT_VALID) {
+        return;
+    }
+
+    PendingScene finished;
+    xSemaphoreTake(sceneMutex, portMAX_DELAY);
+    if (!pendingScene.active || pendingScene.msg.scene_id != scene_id) {
+        xSemaphoreGive(sceneMutex);
+        return;
+    }
+    pendingScene.pending_mask &= ~(1u << room_id);
+    pendingScene.acked_mask |= pendingScene.msg.room_mask & (1u << room_id);
+    bool done = pendingScene.pending_mask == 0;
+    if (done) {
+        finished = pendingScene;
+        pendingScene.active = false;
+    }
+    xSemaphoreGive(sceneMutex);
+
+    if (done) {
+        completeScene(finished);
+    }
+}
+
+void MasterController::checkPendingScene() {
+    PendingScene finished;
+    bool done = false;
+    bool resend = false;
+    SceneMsg msg;
+
+    xSemaphoreTake(sceneMutex, portMAX_DELAY);
+    // One broadcast waits for several rooms, so it keeps the conservative timeout instead of a peer's RTO
+    if (pendingScene.active && millis() - pendingScene.sent_at_ms >= INITIAL_RTO_MS) {
+        if (pendingScene.transmissions >= MAX_TRANSMISSIONS) {
+            finished = pendingScene;
+            pendingScene.active = false;
+            done = true;
+        } else {
+            // Rooms that already applied it only ACK again
+            pendingScene.transmissions++;
+            pendingScene.sent_at_ms = millis();
+            msg = pendingScene.msg;
+            resend = true;
+        }
+    }
+    xSemaphoreGive(sceneMutex);
+
+    if (resend) {
+        communications.sendBroadcast(reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
+        LOG_WARNING("Scene %u not ACKed by every room, broadcasting again", msg.scene_id);
+    }
+    if (done) {
+        completeScene(finished);
+    }
+}
+
+void MasterController::completeScene(const PendingScene& scene) {
+    uint16_t failed_mask = scene.msg.room_mask & ~scene.acked_mask;
+    LOG_INFO("Scene %u completed, acked by 0x%04X, failed for 0x%04X", scene.msg.scene_id, scene.acked_mask,
+             failed_mask);
+
+    for (uint8_t i = 0; i < dataManager.getNumRooms(); i++) {
+        if (!(scene.msg.room_mask & (1u << i))) {
+            continue;
+        }
+        if (scene.msg.command == SceneCommand::SCHEDULE) {
+            if (scene.acked_mask & (1u << i)) {
+                dataManager.scheduleWasUpdated(i);
+            } else {
+                // Same outcome as a unicast NEW_SCHEDULE that is never ACKed
+                LOG_WARNING("RoomNode with ID %u is not responding to new schedule update", i);
+                dataManager.unregisterNode(i, NodeType::ROOM);
+            }
+        }
+        webSockets.publishRoom(i);
+    }
+    webSockets.sendSceneResult(scene.msg.scene_id, scene.acked_mask, failed_mask);
+}
+
+// The RoomNode applied the schedule, or never answered and is considered gone
+void MasterController::scheduleSendComplete(void* context, const uint8_t* mac_addr, MessageType type, bool delivered) {
+    MasterController* self = static_cast<MasterController*>(context);
+    uint8_t room_id = self->dataManager.getId(mac_addr);
+    if (room_id == ID_NOT_VALID) {
+        return;
+    }
+
+    if (delivered) {
+        self->dataManager.scheduleWasUpdated(room_id);
+        LOG_INFO("Received ACK for NEW_SCHEDULE from room %u", room_id);
+    } else {
+        LOG_WARNING("RoomNode with ID %u is not responding to new schedule update", room_id);
+        self->dataManager.unregisterNode(room_id, NodeType::ROOM);
+        LOG_INFO("Unregistered roomNode with ID: %u", room_id);
+    }
+    self->webSockets.publishRoom(room_id);
+}
+
+// Registers the handler of every message the master receives
+void MasterController::registerHandlers() {
+    dispatcher.on<TempHumidMsg, &MasterController::onTempHumid>();
+    dispatcher.on<TempHumidBatchMsg, &MasterController::onTempHumidBatch>();
+    dispatcher.on<TempHumidPackedMsg, &MasterController::onTempHumidPacked>();
+    dispatcher.on<JoinSensorMsg, &MasterController::onJoinSensor>();
+    dispatcher.on<AckMsg, &MasterController::onAck>();
+    dispatcher.on<JoinRoomMsg, &MasterController::onJoinRoom>();
+    dispatcher.on<HeartbeatMsg, &MasterController::onHeartbeat>();
+    dispatcher.on<LightsUpdateMsg, &MasterController::onLightsUpdate>();
+}
+
 // Handles incoming ESP-NOW messages from master
 void MasterController::espnowTask(void* pvParameter) {
     MasterController* self = static_cast<MasterController*>(pvParameter);
-    IncomingMsg msg;
-    MessageType msg_type;
-
-    // Declare variables outside the loop to reduce stack usage
-    TempHumidMsg* payload_temp_humid = nullptr;
-    JoinSensorMsg* payload_join_sensor = nullptr;
-    AckMsg* payload_ack = nullptr;
-    JoinRoomMsg* payload_join_room = nullptr;
-    HeartbeatMsg* payload_heartbeat = nullptr;
-    LightsUpdateMsg* payload_lights_update = nullptr;
-    NewSleepPeriodMsg new_period_msg;
-    uint8_t room_id;
-    float temperature;
-    float humidity;
-    time_t timestamp;
-    uint32_t new_period;
-    uint8_t sensor_mac[MAC_ADDRESS_LENGTH];
-    bool is_on;
+    IncomingMsg* msg;
 
     while (true) {
-        if (xQueueReceive(self->espnowQueue, &msg, portMAX_DELAY) == pdTRUE) {
-            msg_type = static_cast<MessageType>(msg.data[0]);
-            switch (msg_type) {
-                case MessageType::TEMP_HUMID: {
-                    if (msg.len != sizeof(TempHumidMsg)) {
-                        LOG_WARNING("Received malformed TEMP_HUMID message.");
-                        break;
-                    }
-                    payload_temp_humid = reinterpret_cast<TempHumidMsg*>(msg.data);
-                    room_id = payload_temp_humid->room_id;
-                    temperature = payload_temp_humid->temperature;
-                    humidity = payload_temp_humid->humidity;
-                    timestamp = time(nullptr);
-                    
-                    self->dataManager.addSensorData(room_id, temperature, humidity, timestamp);
-
-                    // Update Web Interface
-                    self->webSockets.sendDataUpdate(room_id);
-
-                    // Handle pending sleep period update
-                    if (self->dataManager.isPendingUpdate(room_id, NodeType::SENSOR)) {
-                        new_period = self->dataManager.getNewSleepPeriod(room_id);
-
-                        new_period_msg.type = MessageType::NEW_SLEEP_PERIOD;
-                        new_period_msg.new_period_ms = new_period;
-
-                        if (self->dataManager.getMacAddr(room_id, NodeType::SENSOR, sensor_mac)) {
-                            self->communications.sendMsg(sensor_mac, reinterpret_cast<uint8_t*>(&new_period_msg), sizeof(NewSleepPeriodMsg));
-                            LOG_INFO("Sent NEW_SLEEP_PERIOD to sensor in room %u successfully", room_id);
-                            
-                            // Update retry mechanism
-                            self->pendingSleepUpdate[room_id].attempts++;
-                            self->pendingSleepUpdate[room_id].lastAttemptMillis = millis();
-                            if (self->pendingSleepUpdate[room_id].attempts > MAX_RETRIES){
-                                LOG_WARNING("Communication with sensorNode with ID %u isn't working as expected.", room_id);
-                            }
-                        } else {
-                            LOG_ERROR("Failed to retrieve MAC address for room %u. Cannot send NEW_SLEEP_PERIOD.", room_id);
-                        }
-                    } else {
-                        // Acknowledge TEMP_HUMID message
-                        self->communications.sendAck(msg.mac_addr, MessageType::TEMP_HUMID);
-                    }
-                }
-                break;
-
-                case MessageType::JOIN_SENSOR: {
-                    if (msg.len != sizeof(JoinSensorMsg)) {
-                        LOG_WARNING("Received malformed JOIN_SENSOR message.");
-                        break;
-                    }
-                    payload_join_sensor = reinterpret_cast<JoinSensorMsg*>(msg.data);
-                    room_id = payload_join_sensor->room_id;
-                    uint32_t sleep_period_ms = payload_join_sensor->sleep_period_ms;
-                    
-                    self->dataManager.sensorSetup(room_id, msg.mac_addr, sleep_period_ms);
-
-                    LOG_INFO("Received JOIN_SENSOR from room %u with sleep_period %u ms", room_id, sleep_period_ms);
-                    self->communications.registerPeer(msg.mac_addr, WiFi.channel());
-                    self->communications.sendAck(msg.mac_addr, msg_type);
-                }
-                break;
-
-                case MessageType::ACK: {
-                    if (msg.len < sizeof(AckMsg)) {
-                        LOG_WARNING("Received malformed ACK message.");
-                        break;
-                    }
-                    payload_ack = reinterpret_cast<AckMsg*>(msg.data);
-                    
-                    uint8_t acked_room_id = self->dataManager.getId(msg.mac_addr);
-                    if (acked_room_id == ID_NOT_VALID) {
-                        LOG_WARNING("Received ACK from unknown node.");
-                        break;
-                    }
-
-                    if (payload_ack->acked_msg == MessageType::NEW_SLEEP_PERIOD) {
-                        self->dataManager.sleepPeriodWasUpdated(acked_room_id);
-                        self->pendingSleepUpdate[acked_room_id].attempts = 0;
-                        self->webSockets.sendDataUpdate(acked_room_id);
-                        LOG_INFO("Received ACK for NEW_SLEEP_PERIOD from room %u", acked_room_id);
-                    } else if (payload_ack->acked_msg == MessageType::NEW_SCHEDULE) {
-                        self->dataManager.scheduleWasUpdated(acked_room_id);
-                        self->pendingScheduleUpdate[acked_room_id].attempts = 0;
-                        self->webSockets.sendDataUpdate(acked_room_id);
-                        LOG_INFO("Received ACK for NEW_SCHEDULE from room %u", acked_room_id);
-                    } else {
-                        LOG_WARNING("Received ACK for unknown MessageType: %d", payload_ack->acked_msg);
-                    }
-                }
-                break;
-
-                case MessageType::JOIN_ROOM: {
-                    if (msg.len != sizeof(JoinRoomMsg)) {
-                        LOG_WARNING("Received malformed JOIN_ROOM message.");
-                        break;
-                    }
-                    payload_join_room = reinterpret_cast<JoinRoomMsg*>(msg.data);
-                    room_id = payload_join_room->room_id;
-                    self->communications.registerPeer(msg.mac_addr, WiFi.channel());
-                    self->communications.sendAck(msg.mac_addr, MessageType::JOIN_ROOM);
-                    self->dataManager.controlSetup(room_id, msg.mac_addr, payload_join_room->lights_on, 
-                                                   payload_join_room->warm.hour, payload_join_room->warm.min, 
-                                                   payload_join_room->cold.hour, payload_join_room->cold.min);
-                    LOG_INFO("Received JOIN_ROOM from room %u with warm/cold times", room_id);
-
-                    // Update Web Interface
-                    self->webSockets.sendDataUpdate(room_id);
-                }
-                break;
-
-                case MessageType::HEARTBEAT: {
-                    if (msg.len != sizeof(HeartbeatMsg)) {
-                        LOG_WARNING("Received malformed HEARTBEAT message.");
-                        break;
-                    }
-                    payload_heartbeat = reinterpret_cast<HeartbeatMsg*>(msg.data);
-                    room_id = payload_heartbeat->room_id;
-                    if (self->dataManager.isRegistered(room_id, NodeType::ROOM)){
-                        self->dataManager.updateHeartbeat(room_id);
-                        self->communications.sendAck(msg.mac_addr, MessageType::HEARTBEAT);
-                    } else {
-                        LOG_WARNING("Heartbeat received from unregistered device");
-                    }
-                    
-                }
-                break;
-
-                case MessageType::LIGHTS_UPDATE: {
-                    if (msg.len != sizeof(LightsUpdateMsg)) {
-                        LOG_WARNING("Received malformed LIGHTS_UPDATE message.");
-                        break;
-                    }
-                    payload_lights_update = reinterpret_cast<LightsUpdateMsg*>(msg.data);
-                    room_id = self->dataManager.getId(msg.mac_addr);
-                    if (room_id != ID_NOT_VALID) {
-                        is_on = payload_lights_update->is_on;
-                        self->dataManager.setLightsOn(room_id, is_on);
-                        LOG_INFO("Room %u reports lights are now %s", room_id, is_on ? "ON" : "OFF");
-
-                        // Update Web Interface
-                        self->webSockets.sendDataUpdate(room_id);
-                    } else {
-                        LOG_WARNING("LIGHTS_UPDATE from unknown node");
-                    }
-                }
-                break;
-
-                default:
-                    LOG_WARNING("Received unknown message type: %d", msg_type);
+        msg = self->ingress.acquire(portMAX_DELAY);
+        if (msg != nullptr) {
+            // Processed in place, the slot goes back to the radio callback afterwards
+            self->processFrame(*msg);
+            self->ingress.release();
+        }
+    }
+}
+
+// Validates a received frame, filters retransmissions and hands it to its handler
+void MasterController::processFrame(const IncomingMsg& msg) {
+    if (!dispatcher.accept(msg)) {
+        return;
+    }
+    MessageType msg_type = static_cast<MessageType>(msg.data[0]);
+
+    // A retransmission after a lost ACK only needs the ACK again, the frame was already processed.
+    // Frames rejected without an ACK are not in the history and go to their handler again
+    if (msg_type != MessageType::ACK && msg_type != MessageType::JOIN_SENSOR && 
+        msg_type != MessageType::JOIN_ROOM) {
+        uint8_t seq = reinterpret_cast<const MsgHeader*>(msg.data)->seq;
+        if (communications.isDuplicate(msg.mac_addr, seq)) {
+            LOG_INFO("Duplicate %s (seq %u) re-acknowledged, %u duplicates from this peer",
+                     MSG_NAME[msg.data[0]], seq, communications.getDuplicateCount(msg.mac_addr));
+            uint8_t room_id = dataManager.getId(msg.mac_addr);
+            if (room_id != ID_NOT_VALID && (msg_type == MessageType::TEMP_HUMID ||
+                msg_type == MessageType::TEMP_HUMID_BATCH || msg_type == MessageType::TEMP_HUMID_PACKED)) {
+                // The lost ACK may have carried options, they go again
+                acknowledgeSensorData(room_id, msg.mac_addr, msg_type, seq);
+            } else {
+                communications.sendAck(msg.mac_addr, msg_type, seq);
             }
+            return;
+        }
+    }
+
+    dispatcher.dispatch(*this, msg);
+}
+
+void MasterController::onTempHumid(const IncomingMsg& frame, const TempHumidMsg& msg) {
+    float temperature = decodeTemperature(msg.temperature);
+    float humidity = decodeHumidity(msg.humidity);
+    
+    dataManager.addSensorData(msg.room_id, temperature, humidity, time(nullptr));
+
+    // Update Web Interface
+    webSockets.publishRoom(msg.room_id);
+
+    acknowledgeSensorData(msg.room_id, frame.mac_addr, MessageType::TEMP_HUMID, msg.header.seq);
+}
+
+void MasterController::onTempHumidBatch(const IncomingMsg& frame, const TempHumidBatchMsg& msg) {
+    if (msg.count > MAX_BATCH_SAMPLES || frame.len != batchMsgSize(msg.count)) {
+        LOG_WARNING("Received malformed TEMP_HUMID_BATCH message.");
+        return;
+    }
+    dataManager.addSensorDataBatch(msg.room_id, msg.samples, msg.count, time(nullptr), msg.uplink_every);
+    LOG_INFO("Received %u buffered readings from room %u", msg.count, msg.room_id);
+
+    // Update Web Interface
+    webSockets.publishRoom(msg.room_id);
+
+    acknowledgeSensorData(msg.room_id, frame.mac_addr, MessageType::TEMP_HUMID_BATCH, msg.header.seq);
+}
+
+void MasterController::onTempHumidPacked(const IncomingMsg& frame, const TempHumidPackedMsg& msg) {
+    if (!dataManager.addSensorDataPacked(msg.room_id, msg.payload, frame.len - BATCH_HEADER_SIZE, msg.count,
+                                         time(nullptr), msg.uplink_every)) {
+        // Not ACKed, the sensor keeps the readings and sends them again
+        return;
+    }
+    LOG_INFO("Received %u packed readings from room %u in %u bytes", msg.count, msg.room_id, frame.len);
+
+    // Update Web Interface
+    webSockets.publishRoom(msg.room_id);
+
+    acknowledgeSensorData(msg.room_id, frame.mac_addr, MessageType::TEMP_HUMID_PACKED, msg.header.seq);
+}
+
+void MasterController::onJoinSensor(const IncomingMsg& frame, const JoinSensorMsg& msg) {
+    if (msg.room_id >= dataManager.getNumRooms()) {
+        // Not registered nor ACKed, the node keeps retrying until the room is added
+        LOG_WARNING("JOIN_SENSOR rejected, room %u is not configured (%u rooms)", msg.room_id,
+                    dataManager.getNumRooms());
+        return;
+    }
+
+    uint8_t mac_addr[MAC_ADDRESS_LENGTH];
+    memcpy(mac_addr, frame.mac_addr, MAC_ADDRESS_LENGTH);
+
+    dataManager.sensorSetup(msg.room_id, mac_addr, msg.sleep_period_ms);
+
+    LOG_INFO("Received JOIN_SENSOR from room %u with sleep_period %u ms", msg.room_id, msg.sleep_period_ms);
+    communications.registerPeer(mac_addr, WiFi.channel());
+    communications.resetSession(mac_addr);
+    communications.sendAck(mac_addr, MessageType::JOIN_SENSOR, msg.header.seq);
+}
+
+void MasterController::onAck(const IncomingMsg& frame, const AckMsg& msg) {
+    // Scene ACKs carry the scene id, not a sequence number of this peer
+    if (msg.acked_msg == MessageType::SCENE) {
+        onSceneAck(frame.mac_addr, msg.acked_seq);
+        return;
+    }
+
+    // Completion callbacks of the acked frames do the rest
+    communications.handleAck(frame.mac_addr, msg);
+}
+
+void MasterController::onJoinRoom(const IncomingMsg& frame, const JoinRoomMsg& msg) {
+    if (msg.room_id >= dataManager.getNumRooms()) {
+        // Not registered nor ACKed, the node keeps retrying until the room is added
+        LOG_WARNING("JOIN_ROOM rejected, room %u is not configured (%u rooms)", msg.room_id,
+                    dataManager.getNumRooms());
+        return;
+    }
+
+    uint8_t mac_addr[MAC_ADDRESS_LENGTH];
+    memcpy(mac_addr, frame.mac_addr, MAC_ADDRESS_LENGTH);
+
+    communications.registerPeer(mac_addr, WiFi.channel());
+    communications.resetSession(mac_addr);
+
+    // RoomNodes take the master's clock instead of joining Wi-Fi for NTP
+    AckOptions options;
+    addTimeOption(options);
+    communications.sendAck(mac_addr, MessageType::JOIN_ROOM, msg.header.seq, &options);
+    dataManager.controlSetup(msg.room_id, mac_addr, msg.lights_on, 
+                             msg.warm.hour, msg.warm.min, 
+                             msg.cold.hour, msg.cold.min);
+    LOG_INFO("Received JOIN_ROOM from room %u with warm/cold times", msg.room_id);
+
+    // Update Web Interface
+    webSockets.publishRoom(msg.room_id);
+}
+
+void MasterController::onHeartbeat(const IncomingMsg& frame, const HeartbeatMsg& msg) {
+    if (dataManager.isRegistered(msg.room_id, NodeType::ROOM)){
+        dataManager.updateHeartbeat(msg.room_id);
+
+        // A schedule still pending reaches the RoomNode again, e.g. if the NEW_SCHEDULE was lost.
+        // The time keeps its clock in step with the master's, once per heartbeat
+        AckOptions options;
+        dataManager.fillAckOptions(msg.room_id, NodeType::ROOM, options);
+        addTimeOption(options);
+        communications.sendAck(frame.mac_addr, MessageType::HEARTBEAT, msg.header.seq, &options);
+    } else {
+        LOG_WARNING("Heartbeat received from unregistered device");
+    }
+}
+
+void MasterController::onLightsUpdate(const IncomingMsg& frame, const LightsUpdateMsg& msg) {
+    uint8_t room_id = dataManager.getId(frame.mac_addr);
+    if (room_id != ID_NOT_VALID) {
+        communications.sendAck(frame.mac_addr, MessageType::LIGHTS_UPDATE, msg.header.seq);
+        dataManager.setLightsOn(room_id, msg.is_on);
+        LOG_INFO("Room %u reports lights are now %s", room_id, msg.is_on ? "ON" : "OFF");
+
+        // Update Web Interface
+        webSockets.publishRoom(room_id);
+    } else {
+        LOG_WARNING("LIGHTS_UPDATE from unknown node");
+    }
+}
+
+// Acknowledges sensor data, the SensorNode applies the options before going back to sleep
+void MasterController::acknowledgeSensorData(uint8_t room_id, const uint8_t* mac_addr, MessageType acked_msg,
+                                             uint8_t acked_seq) {
+    AckOptions options;
+    dataManager.fillAckOptions(room_id, NodeType::SENSOR, options);
+    TxHandle handle = communications.sendAck(mac_addr, acked_msg, acked_seq, &options);
+
+    if (options.contains(AckOption::SLEEP_PERIOD) && room_id < dataManager.getNumRooms()) {
+        LOG_INFO("Sent new sleep period to sensor in room %u with the ACK", room_id);
+
+        // Reset by checkSleepUpdates() once the ACK is delivered
+        pendingSleepUpdate[room_id].ack_handle = handle;
+        pendingSleepUpdate[room_id].attempts++;
+        if (pendingSleepUpdate[room_id].attempts > MAX_SLEEP_UPDATE_ATTEMPTS){
+            LOG_WARNING("Communication with sensorNode with ID %u isn't working as expected.", room_id);
+        }
+    }
+}
+
+void MasterController::addTimeOption(AckOptions& options) {
+    EpochTime now;
+    if (ntpClient.getEpochTime(now)) {
+        options.addEpochTime(now);
+    }
+}
+
+void MasterController::checkSleepUpdates() {
+    for (uint8_t i = 0; i < dataManager.getNumRooms(); i++) {
+        PendingUpdate& update = pendingSleepUpdate[i];
+        if (update.ack_handle == INVALID_TX_HANDLE) {
+            continue;
+        }
+        TxStatus status = communications.getTxStatus(update.ack_handle);
+        if (status == TxStatus::PENDING) {
+            continue;
+        }
+        update.ack_handle = INVALID_TX_HANDLE;
+
+        // Otherwise the sleep period stays pending and goes with the next ACK
+        if (status == TxStatus::DELIVERED) {
+            dataManager.sleepPeriodWasUpdated(i);
+            update.attempts = 0;
+            webSockets.publishRoom(i);
+            LOG_INFO("New sleep period delivered to sensor in room %u", i);
         }
     }
 }
@@ -303,67 +529,69 @@ void MasterController::ntpSyncTask(void* pvParameter) {
     }
 }
 
+// Announces the master's channel so joining nodes find it by listening
+void MasterController::beaconTask(void* pvParameter) {
+    MasterController* self = static_cast<MasterController*>(pvParameter);
+    BeaconMsg beacon;
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(BEACON_PERIOD_MS));
+        beacon.channel = WiFi.channel();
+        self->communications.sendBroadcast(reinterpret_cast<uint8_t*>(&beacon), sizeof(beacon));
+    }
+}
+
+// Sends the rooms changed during the last period to the web clients in one message
+void MasterController::webPublishTask(void* pvParameter) {
+    MasterController* self = static_cast<MasterController*>(pvParameter);
+    TickType_t lastWake = xTaskGetTickCount();
+    while (true) {
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(WEB_SERVER_PERIOD));
+        self->webSockets.flushUpdates();
+    }
+}
+
 void MasterController::updateCheckTask(void* pvParameter) {
     MasterController* self = static_cast<MasterController*>(pvParameter);
     while (true) {
         vTaskDelay(pdMS_TO_TICKS(CHECK_PENDING_MSG_PERIOD));
-        self->checkAndResendUpdates();
         self->checkHeartbeats();
         self->checkSensorNodes();
+        self->checkSleepUpdates();
+        self->checkIngressDrops();
+        self->checkPendingScene();
+        self->dataManager.flushHistory();
     }
 }
 
-void MasterController::checkAndResendUpdates() {
-    for (uint8_t i = 0; i < NUM_ROOMS; i++) {
-        // Handle schedule updates
-        if (dataManager.isPendingUpdate(i, NodeType::ROOM)) {
-            uint32_t nowMs = millis();
-            if ((nowMs - pendingScheduleUpdate[i].lastAttemptMillis > RETRY_INTERVAL_MS)){
-                if (pendingScheduleUpdate[i].attempts < MAX_RETRIES){
-                    RoomData rd = dataManager.getRoomData(i);
-                    uint8_t room_mac[MAC_ADDRESS_LENGTH];
-                    if (dataManager.getMacAddr(i, NodeType::ROOM, room_mac)) {
-                        NewScheduleMsg scheduleMsg;
-                        scheduleMsg.type = MessageType::NEW_SCHEDULE;
-                        scheduleMsg.warm = rd.control.new_warm;
-                        scheduleMsg.cold = rd.control.new_cold;
-
-                        communications.sendMsg(room_mac, reinterpret_cast<uint8_t*>(&scheduleMsg), sizeof(scheduleMsg));
-                        LOG_INFO("Resent NEW_SCHEDULE to room %u (attempt %u)", 
-                                    i, pendingScheduleUpdate[i].attempts + 1);
-                        pendingScheduleUpdate[i].attempts++;
-                        pendingScheduleUpdate[i].lastAttemptMillis = nowMs;
-                    }
-                } else {
-                    LOG_WARNING("RoomNode with ID %u is not responding to new schedule update", i);
-                    dataManager.unregisterNode(i, NodeType::ROOM);
-                    LOG_INFO("Unregistered roomNode with ID: %u", i);
-                    webSockets.sendDataUpdate(i);
-                }
-            }
-        }
+void MasterController::checkIngressDrops(){
+    IngressStats stats = ingress.getStats();
+    uint32_t drops = stats.oversize + stats.overflow;
+    if (drops != reportedIngressDrops) {
+        LOG_WARNING("ESP-NOW frames dropped: %u oversize, %u with all %u slots in use (peak %u)",
+                    stats.oversize, stats.overflow, INGRESS_SLOTS, stats.high_water);
+        reportedIngressDrops = drops;
     }
 }
 
 void MasterController::checkHeartbeats(){
-    for (uint8_t i = 0; i < NUM_ROOMS; i++){
+    for (uint8_t i = 0; i < dataManager.getNumRooms(); i++){
         if (dataManager.isRegistered(i, NodeType::ROOM) && millis() - dataManager.getLatestHeartbeat(i) > HEARTBEAT_TIMEOUT){
             LOG_WARNING("Heartbeat from RoomNode with ID %u not received in time", i);
             dataManager.unregisterNode(i, NodeType::ROOM);
             LOG_INFO("RoomNode with ID %u has been unregistered", i);
-            webSockets.sendDataUpdate(i);
+            webSockets.publishRoom(i);
         }
     }
 }
 
 void MasterController::checkSensorNodes(){
-    for (uint8_t i = 0; i < NUM_ROOMS; i++){
+    for (uint8_t i = 0; i < dataManager.getNumRooms(); i++){
         if (dataManager.isRegistered(i, NodeType::SENSOR)){
             if (!dataManager.checkIfSensorActive(i)){
                 LOG_WARNING("Data from SensorNode with ID %u not received in time", i);
                 dataManager.unregisterNode(i, NodeType::SENSOR);
                 LOG_INFO("SensorNode with ID %u has been unregistered", i);
-                webSockets.sendDataUpdate(i);
+                webSockets.publishRoom(i);
             }
         }
     }
@@ -0,0 +1,54 @@
+/**
+ * @file Rollup.cpp
+ * @brief Implementation of the fixed-period min/max/avg buckets
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "MasterDevice/Rollup.h"
+
+void RollupSeries::init(RollupBucket* buffer, uint32_t capacity, uint32_t period_s, int32_t utc_offset_s) {
+    this->buckets = buffer;
+    this->capacity = buffer != nullptr ? capacity : 0;
+    this->period_s = period_s;
+    this->utc_offset_s = utc_offset_s;
+    this->appended = 0;
+}
+
+void RollupSeries::add(time_t timestamp, float temperature, float humidity) {
+    if (capacity == 0) {
+        return;
+    }
+    time_t local = timestamp + utc_offset_s;
+    time_t start = local - local % period_s - utc_offset_s;
+
+    if (appended > 0) {
+        RollupBucket& newest = buckets[(appended - 1) % capacity];
+        if (start == newest.start) {
+            newest.count++;
+            newest.sum_temperature += temperature;
+            newest.sum_humidity += humidity;
+            if (temperature < newest.min_temperature) newest.min_temperature = temperature;
+            if (temperature > newest.max_temperature) newest.max_temperature = temperature;
+            if (humidity < newest.min_humidity) newest.min_humidity = humidity;
+            if (humidity > newest.max_humidity) newest.max_humidity = humidity;
+            return;
+        }
+        // Only reached by clock corrections, batches arrive oldest first
+        if (start < newest.start) {
+            return;
+        }
+    }
+
+    RollupBucket& bucket = buckets[appended % capacity];
+    bucket.start = start;
+    bucket.count = 1;
+    bucket.min_temperature = bucket.max_temperature = bucket.sum_temperature = temperature;
+    bucket.min_humidity = bucket.max_humidity = bucket.sum_humidity = humidity;
+    appended++;
+}
+
+uint32_t RollupSeries::size() const {
+    return appended < capacity ? appended : capacity;
+}
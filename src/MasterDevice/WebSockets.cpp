@@ -7,10 +7,20 @@
  */
 
 #include "MasterDevice/WebSockets.h"
+#include <climits>
+#include "MasterDevice/HistoryFrame.h"
 
 // Constructor initializes WebSocket path and callback pointers
-WebSockets::WebSockets(DataManager& dataManager) : ws("/ws"), dataManager(dataManager),
-        sleepDurationCallback(nullptr), scheduleCallback(nullptr) {
+WebSockets::WebSockets(DataManager& dataManager) : ws("/ws"), dataManager(dataManager), historyQuery(dataManager),
+        sleepDurationCallback(nullptr), scheduleCallback(nullptr), lightsToggleCallback(nullptr),
+        sceneCallback(nullptr), dirtyRooms(0) {
+    publishMutex = xSemaphoreCreateMutex();
+    if (publishMutex == nullptr) {
+        LOG_ERROR("Failed to create publish mutex");
+    }
+    for (uint8_t i = 0; i < MAX_ROOMS; i++) {
+        published[i].version = 0;
+    }
 }
 
 // Initializes WebSocket events and adds the handler to the server
@@ -33,6 +43,9 @@ void WebSockets::setScheduleCallback(void (*callback)(uint8_t, uint8_t, uint8_t,
 void WebSockets::setLightsToggleCallback(void (*callback)(uint8_t, bool)) {
     lightsToggleCallback = callback;
 }
+void WebSockets::setSceneCallback(bool (*callback)(uint16_t, SceneCommand, bool, Time, Time)) {
+    sceneCallback = callback;
+}
 
 // Handles WebSocket events such as connections, disconnections, and incoming data
 void WebSockets::onEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
@@ -41,13 +54,8 @@ void WebSockets::onEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, A
         case WS_EVT_CONNECT:
             LOG_INFO("WebSocket client %u connected", client->id());
 
-            // Send current sensor data for all registered rooms upon client connection
-            for (uint8_t i = 0; i < NUM_ROOMS; i++) {
-                const RoomData& room_data = dataManager.getRoomData(i);
-                if (room_data.isRegistered()) {
-                    sendDataUpdate(i);
-                }
-            }
+            // The client merges the deltas that follow into this full state
+            sendSnapshot(client);
             break;
 
         case WS_EVT_DISCONNECT:
@@ -62,7 +70,7 @@ void WebSockets::onEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, A
                     String msg = String((char*)data).substring(0, len);
                     LOG_INFO("Received message from client %u: %s", client->id(), msg.c_str());
 
-                    DynamicJsonDocument doc(128);
+                    DynamicJsonDocument doc(256); // Room lists of "scene" do not fit 128 bytes
                     DeserializationError error = deserializeJson(doc, msg);
                     if (error) {
                         LOG_ERROR("Failed to parse JSON message from client.");
@@ -87,6 +95,13 @@ void WebSockets::onEvent(AsyncWebSocket* server, AsyncWebSocketClient* client, A
                         handleSetSchedule(client, root);
                     } else if (action == "toggleLights") {
                         handleToggleLights(client, root);
+                    } else if (action == "scene") {
+                        handleScene(client, root);
+                    } else if (action == "addRoom") {
+                        handleAddRoom(client, root);
+                    } else if (action == "resync") {
+                        // The client saw a version gap
+                        sendSnapshot(client);
                     }
                 }
             }
@@ -152,9 +167,41 @@ void WebSockets::handleGetHistory(AsyncWebSocketClient* client, JsonObject& root
         return;
     }
 
-    uint8_t room_id = root["room_id"];
-    LOG_INFO("Received getHistory request for room %u", room_id);
-    sendHistoryData(client, room_id);
+    HistoryRequest request;
+    request.room_id = root["room_id"];
+    request.resolution = HistoryResolution::RAW;
+    if (root.containsKey("resolution")) {
+        String resolutionStr = root["resolution"].as<String>();
+        if (resolutionStr == "hour") {
+            request.resolution = HistoryResolution::HOUR;
+        } else if (resolutionStr == "day") {
+            request.resolution = HistoryResolution::DAY;
+        } else if (resolutionStr != "raw") {
+            sendError(client, "Unknown resolution, use raw, hour or day");
+            return;
+        }
+    }
+    // Optional range in epoch seconds and point budget, the whole history otherwise
+    request.from = root.containsKey("from") ? root["from"].as<long>() : 0;
+    request.to = root.containsKey("to") ? root["to"].as<long>() : LONG_MAX;
+    request.max_points = root.containsKey("max_points") ? root["max_points"].as<uint16_t>() : 0;
+    if (request.from > request.to) {
+        sendError(client, "'from' must not be after 'to'");
+        return;
+    }
+    // Clients that can read the binary frame opt in, JSON stays the default
+    bool binary = false;
+    if (root.containsKey("format")) {
+        String formatStr = root["format"].as<String>();
+        if (formatStr == "binary") {
+            binary = true;
+        } else if (formatStr != "json") {
+            sendError(client, "Unknown format, use json or binary");
+            return;
+        }
+    }
+    LOG_INFO("Received getHistory request for room %u", request.room_id);
+    sendHistoryData(client, request, binary);
 }
 
 void WebSockets::handleSetSchedule(AsyncWebSocketClient* client, JsonObject& root) {
@@ -178,8 +225,7 @@ void WebSockets::handleSetSchedule(AsyncWebSocketClient* client, JsonObject& roo
     }
 
     // Check if roomNode is registered
-    RoomData roomData = dataManager.getRoomData(room_id);
-    if (!roomData.control.registered) {
+    if (!dataManager.isRegistered(room_id, NodeType::ROOM)) {
         LOG_ERROR("RoomNode not registered, cannot set schedule.");
         sendError(client, "RoomNode not registered");
         return;
@@ -206,100 +252,327 @@ void WebSockets::handleSetSchedule(AsyncWebSocketClient* client, JsonObject& roo
 }
 
 
-void WebSockets::sendDataUpdate(uint8_t room_id) {
-    if (room_id >= NUM_ROOMS) return;
-
-    RoomData room = dataManager.getRoomData(room_id);
+void WebSockets::publishRoom(uint8_t room_id) {
+    if (room_id < MAX_ROOMS) {
+        dirtyRooms.fetch_or(1UL << room_id);
+    }
+}
 
-    DynamicJsonDocument doc(512);
-    JsonObject obj = doc.to<JsonObject>();
-    obj["type"] = "update";
-    obj["room_id"] = room_id;
-    obj["room_name"] = ROOM_NAME[room_id];
-
-    // Include sensor data only if registered
-    if (room.sensor.registered) {
-        
-        uint16_t idx = room.sensor.index == 0 ? MAX_DATA_POINTS - 1 : room.sensor.index - 1;
-        float last_temp = (room.sensor.registered && room.sensor.valid_data_points > 0) ? room.sensor.temperature[idx] : 0;
-        float last_humid = (room.sensor.registered && room.sensor.valid_data_points > 0) ? room.sensor.humidity[idx] : 0;
-        time_t last_ts = (room.sensor.registered && room.sensor.valid_data_points > 0) ? room.sensor.timestamps[idx] : 0;
-        uint32_t sleep_ms = room.sensor.registered ? room.sensor.sleep_period_ms : DEFAULT_SLEEP_DURATION;
-        
-        obj["temperature"] = last_temp;
-        obj["humidity"] = last_humid;
-        obj["timestamp"] = last_ts;
-        obj["sleep_period_ms"] = sleep_ms;
-        obj["sensor_registered"] = true;
-    } else{
-        obj["sensor_registered"] = false;
+// Fields of a room update, a delta only carries the ones that changed
+enum RoomField : uint16_t {
+    FIELD_ROOM_NAME = 1 << 0,
+    FIELD_SENSOR_REGISTERED = 1 << 1,
+    FIELD_TEMPERATURE = 1 << 2,
+    FIELD_HUMIDITY = 1 << 3,
+    FIELD_TIMESTAMP = 1 << 4,
+    FIELD_SLEEP_PERIOD = 1 << 5,
+    FIELD_CONTROL_REGISTERED = 1 << 6,
+    FIELD_WARM_TIME = 1 << 7,
+    FIELD_COLD_TIME = 1 << 8,
+    FIELD_LIGHTS_ON = 1 << 9,
+    ALL_ROOM_FIELDS = (1 << 10) - 1
+};
+
+// Fields that differ between the published state of a room and its current one
+static uint16_t changedFields(const RoomSummary& before, const RoomSummary& now) {
+    uint16_t fields = 0;
+    if (before.sensor_registered != now.sensor_registered) fields |= FIELD_SENSOR_REGISTERED;
+    if (before.has_sample != now.has_sample || before.latest.temperature != now.latest.temperature) {
+        fields |= FIELD_TEMPERATURE;
+    }
+    if (before.has_sample != now.has_sample || before.latest.humidity != now.latest.humidity) {
+        fields |= FIELD_HUMIDITY;
+    }
+    if (before.has_sample != now.has_sample || before.latest.timestamp != now.latest.timestamp) {
+        fields |= FIELD_TIMESTAMP;
     }
+    if (before.sleep_period_ms != now.sleep_period_ms) fields |= FIELD_SLEEP_PERIOD;
+    if (before.control_registered != now.control_registered) fields |= FIELD_CONTROL_REGISTERED;
+    if (before.warm.hour != now.warm.hour || before.warm.min != now.warm.min) fields |= FIELD_WARM_TIME;
+    if (before.cold.hour != now.cold.hour || before.cold.min != now.cold.min) fields |= FIELD_COLD_TIME;
+    if (before.lights_on != now.lights_on) fields |= FIELD_LIGHTS_ON;
+    return fields;
+}
 
-    // Include control data only if RoomNode is registered
-    if (room.control.registered) {
-        // Format times as HH:MM strings
-        char warm_str[6];
-        snprintf(warm_str, sizeof(warm_str), "%02u:%02u", room.control.warm.hour, room.control.warm.min);
-        char cold_str[6];
-        snprintf(cold_str, sizeof(cold_str), "%02u:%02u", room.control.cold.hour, room.control.cold.min);
+static void writeTime(JsonWriter& writer, const char* key, const Time& time) {
+    // Format times as HH:MM strings
+    char time_str[6];
+    snprintf(time_str, sizeof(time_str), "%02u:%02u", time.hour, time.min);
+    writer.key(key);
+    writer.string(time_str);
+}
 
-        obj["warm_time"] = warm_str;
-        obj["cold_time"] = cold_str;
-        obj["lights_on"] = room.control.lights_on;
-        obj["control_registered"] = true;
-    } else {
-        obj["control_registered"] = false;
+// Writes the given fields of one room as an element of an "updates" or "snapshot" message
+static void writeRoomFields(JsonWriter& writer, uint8_t room_id, const char* room_name, uint32_t version,
+                            const RoomSummary& room, uint16_t fields) {
+    writer.beginObject();
+    writer.key("room_id");
+    writer.number(room_id);
+    writer.key("version");
+    writer.number(version);
+    if (fields & FIELD_ROOM_NAME) {
+        writer.key("room_name");
+        writer.string(room_name);
+    }
+    if (fields & FIELD_SENSOR_REGISTERED) {
+        writer.key("sensor_registered");
+        writer.boolean(room.sensor_registered);
     }
+    if (fields & FIELD_TEMPERATURE) {
+        writer.key("temperature");
+        writer.decimal(room.has_sample ? room.latest.temperature : 0);
+    }
+    if (fields & FIELD_HUMIDITY) {
+        writer.key("humidity");
+        writer.decimal(room.has_sample ? room.latest.humidity : 0);
+    }
+    if (fields & FIELD_TIMESTAMP) {
+        writer.key("timestamp");
+        writer.number(room.has_sample ? static_cast<long>(room.latest.timestamp) : 0);
+    }
+    if (fields & FIELD_SLEEP_PERIOD) {
+        writer.key("sleep_period_ms");
+        writer.number(room.sleep_period_ms);
+    }
+    if (fields & FIELD_CONTROL_REGISTERED) {
+        writer.key("control_registered");
+        writer.boolean(room.control_registered);
+    }
+    if (fields & FIELD_WARM_TIME) writeTime(writer, "warm_time", room.warm);
+    if (fields & FIELD_COLD_TIME) writeTime(writer, "cold_time", room.cold);
+    if (fields & FIELD_LIGHTS_ON) {
+        writer.key("lights_on");
+        writer.boolean(room.lights_on);
+    }
+    writer.endObject();
+}
 
-    String jsonString;
-    serializeJson(doc, jsonString);
-    ws.textAll(jsonString);
+void WebSockets::writeRooms(JsonWriter& writer, const char* type, const RoomDelta* deltas, uint8_t count) const {
+    writer.beginObject();
+    writer.key("type");
+    writer.string(type);
+    writer.key("rooms");
+    writer.beginArray();
+    for (uint8_t i = 0; i < count; i++) {
+        const RoomDelta& delta = deltas[i];
+        writeRoomFields(writer, delta.room_id, dataManager.getRoomName(delta.room_id), delta.version, delta.state,
+                        delta.fields);
+    }
+    writer.endArray();
+    writer.endObject();
+}
 
-    LOG_INFO("Sent data update via WebSocket for room %u", room_id);
+AsyncWebSocketMessageBuffer* WebSockets::makeRoomsMessage(const char* type, const RoomDelta* deltas, uint8_t count) {
+    JsonWriter measure(nullptr, 0);
+    writeRooms(measure, type, deltas, count);
+    AsyncWebSocketMessageBuffer* buffer = ws.makeBuffer(measure.length());
+    if (buffer == nullptr) {
+        LOG_ERROR("No memory for a %u byte %s message", (unsigned)measure.length(), type);
+        return nullptr;
+    }
+    JsonWriter writer(reinterpret_cast<char*>(buffer->get()), measure.length());
+    writeRooms(writer, type, deltas, count);
+    if (writer.failed()) {
+        LOG_ERROR("Rooms %s message does not match its measured length", type);
+        return nullptr;     // AsyncWebSocket frees buffers nobody is sending
+    }
+    return buffer;
 }
 
+void WebSockets::flushUpdates() {
+    uint32_t dirty = dirtyRooms.exchange(0);
+    if (dirty == 0) {
+        return;
+    }
 
-void WebSockets::sendHistoryData(AsyncWebSocketClient* client, uint8_t room_id) {
-    if (room_id >= NUM_ROOMS) return;
+    RoomDelta deltas[MAX_ROOMS];
+    uint8_t count = 0;
+    xSemaphoreTake(publishMutex, portMAX_DELAY);
+        // The published state moves on even without clients, it is what the next snapshot sends
+        for (uint8_t i = 0; i < dataManager.getNumRooms(); i++) {
+            RoomDelta& delta = deltas[count];
+            if (!(dirty & (1UL << i)) || !dataManager.getRoomSummary(i, delta.state)) {
+                continue;
+            }
+            PublishedRoom& room = published[i];
+            delta.fields = room.version == 0 ? static_cast<uint16_t>(ALL_ROOM_FIELDS)
+                                             : changedFields(room.state, delta.state);
+            if (delta.fields == 0) {
+                continue;   // Marked dirty by a change the dashboard does not show
+            }
+            room.state = delta.state;
+            delta.room_id = i;
+            delta.version = ++room.version;
+            count++;
+        }
 
-    RoomData room = dataManager.getRoomData(room_id);
-    uint16_t count = room.sensor.valid_data_points;
+        // Sent while publishMutex is held, so a snapshot never overtakes a delta it does not include
+        if (count > 0 && ws.count() > 0) {
+            AsyncWebSocketMessageBuffer* buffer = makeRoomsMessage("updates", deltas, count);
+            if (buffer != nullptr) {
+                ws.textAll(buffer);
+                LOG_INFO("Sent data update via WebSocket for %u rooms", count);
+            } else {
+                // Clients miss these versions and ask for a snapshot when the gap shows
+                LOG_WARNING("Dropped the update of %u rooms", count);
+            }
+        }
+    xSemaphoreGive(publishMutex);
+}
 
-    DynamicJsonDocument doc(1024);
-    JsonObject obj = doc.to<JsonObject>();
-    obj["type"] = "history";
-    obj["room_id"] = room_id;
-    obj["room_name"] = ROOM_NAME[room_id];
+void WebSockets::sendSnapshot(AsyncWebSocketClient* client) {
+    RoomDelta rooms[MAX_ROOMS];
+    uint8_t count = 0;
+    xSemaphoreTake(publishMutex, portMAX_DELAY);
+        for (uint8_t i = 0; i < dataManager.getNumRooms(); i++) {
+            if (published[i].version == 0) {
+                continue;   // Never published, its first delta carries every field
+            }
+            rooms[count].room_id = i;
+            rooms[count].version = published[i].version;
+            rooms[count].fields = ALL_ROOM_FIELDS;
+            rooms[count].state = published[i].state;
+            count++;
+        }
+        AsyncWebSocketMessageBuffer* buffer = makeRoomsMessage("snapshot", rooms, count);
+        if (buffer != nullptr) {
+            client->text(buffer);
+        }
+    xSemaphoreGive(publishMutex);
+}
 
-    if (count == 0) {
-        obj["message"] = "No historical data available.";
-    } else {
-        JsonArray tempArray = obj.createNestedArray("temperature");
-        JsonArray humidArray = obj.createNestedArray("humidity");
-        JsonArray timeArray = obj.createNestedArray("timestamps");
+static const char* resolutionName(HistoryResolution resolution) {
+    switch (resolution) {
+        case HistoryResolution::HOUR: return "hour";
+        case HistoryResolution::DAY: return "day";
+        default: return "raw";
+    }
+}
 
-        uint16_t idx = room.sensor.index;
-        uint16_t startIdx = (idx + MAX_DATA_POINTS - count) % MAX_DATA_POINTS;
+// Everything a "history" message needs besides the points
+struct HistoryMessage {
+    AsyncWebSocket* ws;
+    AsyncWebSocketClient* client;
+    uint8_t room_id;
+    const char* room_name;
+    HistoryResolution resolution;
+    bool binary;            // Send a HistoryFrame instead of JSON
+    bool sent;
+};
+
+static void writeHistoryArray(JsonWriter& writer, const char* key, const HistoryPoint* points, uint16_t count,
+                              float HistoryPoint::*field) {
+    writer.key(key);
+    writer.beginArray();
+    for (uint16_t i = 0; i < count; i++) {
+        writer.decimal(points[i].*field);
+    }
+    writer.endArray();
+}
 
-        for (uint16_t i = 0; i < count; ++i) {
-            uint16_t index = (startIdx + i) % MAX_DATA_POINTS;
+// Writes the "history" message, or measures it when the writer has no buffer
+static void writeHistory(JsonWriter& writer, const HistoryMessage& message, const HistoryPoint* points,
+                         uint16_t count) {
+    writer.beginObject();
+    writer.key("type");
+    writer.string("history");
+    writer.key("room_id");
+    writer.number(message.room_id);
+    writer.key("room_name");
+    writer.string(message.room_name);
+    writer.key("resolution");
+    writer.string(resolutionName(message.resolution));
+    if (points == nullptr) {
+        writer.key("message");
+        writer.string("No historical data available.");
+    } else {
+        writeHistoryArray(writer, "temperature", points, count, &HistoryPoint::temperature);
+        writeHistoryArray(writer, "humidity", points, count, &HistoryPoint::humidity);
+        writer.key("timestamps");
+        writer.beginArray();
+        for (uint16_t i = 0; i < count; i++) {
+            writer.number(static_cast<long>(points[i].timestamp));
+        }
+        writer.endArray();
+        // Rollups also carry the spread of each bucket
+        if (message.resolution != HistoryResolution::RAW) {
+            writeHistoryArray(writer, "temperature_min", points, count, &HistoryPoint::min_temperature);
+            writeHistoryArray(writer, "temperature_max", points, count, &HistoryPoint::max_temperature);
+            writeHistoryArray(writer, "humidity_min", points, count, &HistoryPoint::min_humidity);
+            writeHistoryArray(writer, "humidity_max", points, count, &HistoryPoint::max_humidity);
+        }
+    }
+    writer.endObject();
+}
 
-            float temp = room.sensor.temperature[index];
-            float humid = room.sensor.humidity[index];
-            time_t ts = room.sensor.timestamps[index];
+// Sends the result as a HistoryFrame. Returns false if it has to go as JSON
+static bool sendHistoryFrame(HistoryMessage* message, const HistoryPoint* points, uint16_t count) {
+    bool ranges = message->resolution != HistoryResolution::RAW;
+    size_t size = HistoryFrame::size(points, count, ranges);
+    if (size == 0) {
+        return false;   // Timestamps out of order, the deltas cannot hold them
+    }
+    AsyncWebSocketMessageBuffer* buffer = message->ws->makeBuffer(size);
+    if (buffer == nullptr) {
+        LOG_ERROR("No memory for a %u byte history frame", (unsigned)size);
+        return true;
+    }
+    HistoryFrame::write(buffer->get(), message->room_id, message->resolution, points, count, ranges);
+    message->client->binary(buffer);
+    message->sent = true;
+    LOG_INFO("Sent %u %s points of history in a %u byte frame", count, resolutionName(message->resolution),
+             (unsigned)size);
+    return true;
+}
 
-            if (ts == 0 || temp == NO_HT_VALUE || humid == NO_HT_VALUE) continue;
-            
-            tempArray.add(temp);
-            humidArray.add(humid);
-            timeArray.add(ts);
-        }
-        LOG_INFO("Sending history data: timestamps=%d, temperatures=%d, humidities=%d", timeArray.size(), tempArray.size(), humidArray.size());
+// Measures the message, then writes it into a socket buffer of the exact size, so the points are never copied
+static void sendHistoryResult(const HistoryPoint* points, uint16_t count, void* context) {
+    HistoryMessage* message = static_cast<HistoryMessage*>(context);
+    if (message->binary && points != nullptr && sendHistoryFrame(message, points, count)) {
+        return;
     }
+    JsonWriter measure(nullptr, 0);
+    writeHistory(measure, *message, points, count);
 
-    String jsonString;
-    serializeJson(doc, jsonString);
-    client->text(jsonString);
+    AsyncWebSocketMessageBuffer* buffer = message->ws->makeBuffer(measure.length());
+    if (buffer == nullptr) {
+        LOG_ERROR("No memory for a %u byte history message", (unsigned)measure.length());
+        return;
+    }
+    JsonWriter writer(reinterpret_cast<char*>(buffer->get()), measure.length());
+    writeHistory(writer, *message, points, count);
+    if (writer.failed()) {
+        LOG_ERROR("History message does not match its measured length");
+        return;     // AsyncWebSocket frees buffers nobody is sending
+    }
+    message->client->text(buffer);
+    message->sent = true;
+    LOG_INFO("Sent %u %s points of history in %u bytes", count, resolutionName(message->resolution),
+             (unsigned)measure.length());
+}
+
+void WebSockets::sendHistoryData(AsyncWebSocketClient* client, const HistoryRequest& request, bool binary) {
+    if (request.room_id >= dataManager.getNumRooms()) return;
+
+    HistoryMessage message;
+    message.ws = &ws;
+    message.client = client;
+    message.room_id = request.room_id;
+    message.room_name = dataManager.getRoomName(request.room_id);
+    message.resolution = request.resolution;
+    message.binary = binary;
+    message.sent = false;
+
+    SensorSample latest;
+    if (!dataManager.latestSample(request.room_id, latest)) {
+        sendHistoryResult(nullptr, 0, &message);
+    } else if (!historyQuery.run(request, sendHistoryResult, &message)) {
+        sendError(client, "History query failed");
+        return;
+    }
+    if (!message.sent) {
+        sendError(client, "Not enough memory for the history");
+    }
 }
 
 
@@ -330,6 +603,116 @@ void WebSockets::handleToggleLights(AsyncWebSocketClient* client, JsonObject& ro
     }
 }
 
+// {"action":"scene","rooms":[0,2] or "all","command":"lights","turn_on":false}
+// {"action":"scene","rooms":"all","command":"schedule","warm_time":"HH:MM","cold_time":"HH:MM"}
+void WebSockets::handleScene(AsyncWebSocketClient* client, JsonObject& root) {
+    if (!root.containsKey("rooms") || !root.containsKey("command")) {
+        LOG_ERROR("scene action missing required fields.");
+        sendError(client, "Missing 'rooms' or 'command' field");
+        return;
+    }
+
+    uint16_t room_mask = 0;
+    if (root["rooms"].is<JsonArray>()) {
+        JsonArray rooms = root["rooms"].as<JsonArray>();
+        for (size_t i = 0; i < rooms.size(); i++) {
+            uint8_t room_id = rooms[i].as<uint8_t>();
+            if (room_id < dataManager.getNumRooms()) {
+                room_mask |= 1u << room_id;
+            }
+        }
+    } else if (root["rooms"].as<String>() == "all") {
+        room_mask = (1u << dataManager.getNumRooms()) - 1;
+    }
+
+    String command = root["command"].as<String>();
+    SceneCommand scene_command;
+    bool turn_on = false;
+    Time warm = {0, 0};
+    Time cold = {0, 0};
+    if (command == "lights" && root.containsKey("turn_on")) {
+        scene_command = SceneCommand::LIGHTS;
+        turn_on = root["turn_on"];
+    } else if (command == "schedule" && root.containsKey("warm_time") && root.containsKey("cold_time")) {
+        scene_command = SceneCommand::SCHEDULE;
+        if (sscanf(root["warm_time"].as<String>().c_str(), "%hhu:%hhu", &warm.hour, &warm.min) != 2 ||
+            sscanf(root["cold_time"].as<String>().c_str(), "%hhu:%hhu", &cold.hour, &cold.min) != 2) {
+            LOG_ERROR("Invalid time format received.");
+            sendError(client, "Invalid time format, use HH:MM");
+            return;
+        }
+    } else {
+        LOG_ERROR("Unknown or incomplete scene command.");
+        sendError(client, "Unknown or incomplete scene command");
+        return;
+    }
+
+    if (!sceneCallback) {
+        LOG_ERROR("No callback defined");
+        return;
+    }
+    if (!sceneCallback(room_mask, scene_command, turn_on, warm, cold)) {
+        sendError(client, "Scene not started: no registered room addressed or another scene in progress");
+        return;
+    }
+
+    DynamicJsonDocument respDoc(128);
+    respDoc["status"] = "success";
+    respDoc["command"] = command;
+    respDoc["room_mask"] = room_mask;
+
+    String respStr;
+    serializeJson(respDoc, respStr);
+    client->text(respStr);
+}
+
+// {"action":"addRoom","name":"Garaje","capacity":20000}, capacity is optional
+void WebSockets::handleAddRoom(AsyncWebSocketClient* client, JsonObject& root) {
+    const char* name = root["name"].as<const char*>();
+    if (name == nullptr || name[0] == '\0') {
+        LOG_ERROR("addRoom action missing 'name' field.");
+        sendError(client, "Missing 'name' field");
+        return;
+    }
+    uint32_t capacity = root.containsKey("capacity") ? root["capacity"].as<uint32_t>() : DEFAULT_HISTORY_POINTS;
+
+    uint8_t room_id = dataManager.addRoom(name, capacity);
+    if (room_id == ID_NOT_VALID) {
+        sendError(client, "No room left");
+        return;
+    }
+    if (!dataManager.saveRooms()) {
+        sendError(client, "Room added but not saved, it will be lost on reboot");
+        return;
+    }
+
+    DynamicJsonDocument respDoc(128);
+    respDoc["status"] = "success";
+    respDoc["room_id"] = room_id;
+    respDoc["room_name"] = dataManager.getRoomName(room_id);
+
+    String respStr;
+    serializeJson(respDoc, respStr);
+    client->text(respStr);
+}
+
+void WebSockets::sendSceneResult(uint8_t scene_id, uint16_t acked_mask, uint16_t failed_mask) {
+    DynamicJsonDocument doc(256);
+    JsonObject obj = doc.to<JsonObject>();
+    obj["type"] = "scene";
+    obj["scene_id"] = scene_id;
+    JsonArray acked = obj.createNestedArray("acked");
+    JsonArray failed = obj.createNestedArray("failed");
+    for (uint8_t i = 0; i < dataManager.getNumRooms(); i++) {
+        if (acked_mask & (1u << i)) acked.add(i);
+        if (failed_mask & (1u << i)) failed.add(i);
+    }
+
+    String jsonString;
+    serializeJson(doc, jsonString);
+    ws.textAll(jsonString);
+}
+
 void WebSockets::sendError(AsyncWebSocketClient* client, const char* message) {
     DynamicJsonDocument respDoc(128);
     respDoc["status"] = "error";
@@ -12,38 +12,34 @@ RoomNode* RoomNode::instance = nullptr;
 
 RoomNode::RoomNode(uint8_t room_id)
     : room_id(room_id), wifi_channel(0), presenceSensor(), communications(&radioMutex), lights(), airConditioner(),
-    espnowTaskHandle(NULL), user_stop(false), connected(false), cold({DEFAULT_HOUR_COLD, DEFAULT_MIN_COLD}), warm({DEFAULT_HOUR_WARM, DEFAULT_MIN_WARM}) {
+    espnowTaskHandle(NULL), user_stop(false), connected(false), last_scene_id(NO_SCENE), cold({DEFAULT_HOUR_COLD, DEFAULT_MIN_COLD}), warm({DEFAULT_HOUR_WARM, DEFAULT_MIN_WARM}) {
     instance = this;
-    espnowQueue = xQueueCreate(10, sizeof(IncomingMsg));
     presenceQueue = xQueueCreate(10, sizeof(uint8_t));
     lightsToggleQueue = xQueueCreate(10, sizeof(bool));
     radioMutex = xSemaphoreCreateMutex();
+    registerHandlers();
 
-    if (radioMutex == NULL || espnowQueue == NULL || presenceQueue == NULL || lightsToggleQueue == NULL) {
+    if (radioMutex == NULL || presenceQueue == NULL || lightsToggleQueue == NULL) {
         LOG_ERROR("Failed to create required FreeRTOS resources");
         return;
     }
 
 }
 
-// Initializes node: sets up Wi-Fi, ESP-NOW, presence sensor, NTP, and lights schedule
+// Initializes node: sets up ESP-NOW, presence sensor and lights schedule. The clock is set by the master
 void RoomNode::initialize() {
     Serial.begin(115200);
     delay(1000);
 
-    communications.initializeWifi();
-    if (!ntpClient.initialize()){
-        LOG_ERROR("NTP init failed.");
-        tryLater();
-    }
+    // No Wi-Fi association: the time arrives with the ACK of JOIN_ROOM and every heartbeat
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
     if (!communications.initializeESPNOW()) {
         LOG_ERROR("ESP-NOW init failed.");
         tryLater();
     }
 
-    communications.setQueue(espnowQueue);
-    
-    WiFi.disconnect(); 
+    communications.setIngress(&ingress);
 
     if(!joinNetwork()){
         LOG_WARNING("No initial connection to Master. RommNode will trying conneting through execution");
@@ -89,35 +85,29 @@ bool RoomNode::joinNetwork() {
 
     
 
-    for (uint8_t i = 0; i < MAX_WIFI_CHANNEL; i++) {
-        wifi_channel = (wifi_channel + i) % MAX_WIFI_CHANNEL;
-        esp_wifi_set_channel(wifi_channel, WIFI_SECOND_CHAN_NONE);
-        communications.registerPeer((uint8_t*)master_mac_addr, wifi_channel);
-
-        connected = false;
-        uint8_t retries = 0;
-        while (!connected && retries < MAX_RETRIES) {
-            if (communications.sendMsg(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg))){
-                if (communications.waitForAck(MessageType::JOIN_ROOM, ACK_TIMEOUT_MS)) {
-                    connected = true;
-                } else {
-                    retries++;
-                    LOG_WARNING("No ACK, retry (%u/%u)", retries, MAX_RETRIES);
-                }
-            }
-        }
+    // Listen for the master beacon, starting on the last known channel
+    uint8_t channel = communications.findMaster(wifi_channel);
+    if (channel == 0) {
+        LOG_WARNING("No master beacon heard on any channel");
+        return false;
+    }
 
-        if (connected) {
-            LOG_INFO("Master on channel %u", wifi_channel);
-            return true;
-        }
-        LOG_WARNING("No ACK in channel %u", wifi_channel);
-        communications.unregisterPeer((uint8_t*)master_mac_addr);
+    wifi_channel = channel;
+    communications.registerPeer((uint8_t*)master_mac_addr, wifi_channel);
+
+    // A master that rebooted numbers its scenes from 0 again, so the last id seen says nothing any more
+    last_scene_id = NO_SCENE;
+    connected = communications.sendToMaster(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg));
+    if (connected) {
+        LOG_INFO("Master on channel %u", wifi_channel);
+        return true;
     }
+    LOG_WARNING("No ACK in channel %u", wifi_channel);
+    communications.unregisterPeer((uint8_t*)master_mac_addr);
     return false;
 }
 
-// Creates FreeRTOS tasks for handling communications, lights, presence, and NTP sync
+// Creates FreeRTOS tasks for handling communications, lights, presence and heartbeats
 void RoomNode::run() {
     BaseType_t result;
 
@@ -127,9 +117,6 @@ void RoomNode::run() {
     result = xTaskCreate(lightsControlTask, "Lights Control Task", 4096, this, 2, &lightsControlTaskHandle);
     if (result != pdPASS) LOG_ERROR("Failed Lights Task");
 
-    result = xTaskCreate(NTPSyncTask, "NTPSync Task", 4096, this, 1, &NTPSyncTaskHandle);
-    if (result != pdPASS) LOG_ERROR("Failed NTPSync Task");
-
     result = xTaskCreate(heartbeatTask, "Heartbeat Task", 2048, this, 2, &HeartBeatTaskHandle);
     if (result != pdPASS) LOG_ERROR("Failed Heartbeat Task");
 
@@ -139,71 +126,28 @@ void RoomNode::run() {
     LOG_INFO("RoomNode running tasks...");
 }
 
+// Registers the handler of every message the RoomNode receives
+void RoomNode::registerHandlers() {
+    dispatcher.on<AckMsg, &RoomNode::onAck>();
+    dispatcher.on<NewScheduleMsg, &RoomNode::onNewSchedule>();
+    dispatcher.on<LightsToggleMsg, &RoomNode::onLightsToggle>();
+    dispatcher.on<SceneMsg, &RoomNode::onScene>();
+    dispatcher.on<BeaconMsg, &RoomNode::onBeacon>();
+}
+
 // Handles incoming ESP-NOW messages from master
 void RoomNode::espnowTask(void* pvParameter) {
     RoomNode* self = static_cast<RoomNode*>(pvParameter);
-    IncomingMsg msg;
-    MessageType msg_type;
-
-    // Declare variables outside the loop to minimize stack usage
-    AckMsg* ack_payload = nullptr;
-    NewScheduleMsg* schedule_payload = nullptr;
-    LightsToggleMsg* toggle_payload = nullptr;
-    LightsUpdateMsg lights_update;
-    uint8_t presence_state;
-    bool turn_on;
+    IncomingMsg* msg;
 
     while (true) {
-        if (xQueueReceive(self->espnowQueue, &msg, portMAX_DELAY) == pdTRUE) {
-            msg_type = static_cast<MessageType>(msg.data[0]);
-
-            switch (msg_type) {
-                case MessageType::ACK:
-                    {
-                        if (msg.len != sizeof(AckMsg)) {
-                            LOG_WARNING("Invalid ACK length.");
-                            break;
-                        }
-                        ack_payload = reinterpret_cast<AckMsg*>(msg.data);
-                        self->communications.ackReceived(msg.mac_addr, ack_payload->acked_msg);
-                    }
-                    break;
-
-                case MessageType::NEW_SCHEDULE:
-                    {
-                        if (msg.len != sizeof(NewScheduleMsg)) {
-                            LOG_WARNING("Invalid NEW_SCHEDULE length.");
-                            break;
-                        }
-                        if (!self->connected){
-                            LOG_WARNING("NEW_SCHEDULE message is not expected");
-                            break;
-                        }
-                        schedule_payload = reinterpret_cast<NewScheduleMsg*>(msg.data);
-                        self->lights.setSchedule(schedule_payload->warm, schedule_payload->cold);
-                        self->communications.sendAck(master_mac_addr, MessageType::NEW_SCHEDULE);
-                    }
-                    break;
-
-                case MessageType::LIGHTS_TOGGLE:
-                    {
-                        if (msg.len != sizeof(LightsToggleMsg)) {
-                            LOG_WARNING("Invalid LIGHTS_TOGGLE length.");
-                            break;
-                        }
-                        if (!self->connected){
-                            LOG_WARNING("LIGHTS_TOGGLE message is not expected");
-                            break;
-                        }
-                        toggle_payload = reinterpret_cast<LightsToggleMsg*>(msg.data);
-                        turn_on = toggle_payload->turn_on;
-                        xQueueSend(self->lightsToggleQueue, &turn_on, portMAX_DELAY);
-                    }
-                    break;
-
-                default:
-                    LOG_WARNING("Unknown message type: %d", msg_type);
+        msg = self->ingress.acquire(portMAX_DELAY);
+        if (msg != nullptr) {
+            // Processed in place, the slot goes back to the radio callback afterwards
+            if (self->dispatcher.accept(*msg)) {
+                self->dispatcher.dispatch(*self, *msg);
             }
+            self->ingress.release();
             // UBaseType_t watermark = uxTaskGetStackHighWaterMark(NULL);
             // LOG_INFO("espNowTask: Stack watermark = %u", (unsigned)watermark);
 
@@ -211,6 +155,101 @@ void RoomNode::espnowTask(void* pvParameter) {
     }
 }
 
+void RoomNode::onAck(const IncomingMsg& frame, const AckMsg& msg) {
+    // Measured before handleAck() hands the frame to the transport task, which completes it later
+    uint32_t round_trip_ms = 0;
+    bool measured = communications.ackRoundTrip(frame.mac_addr, msg.acked_seq, frame.received_ms, round_trip_ms);
+    communications.handleAck(frame.mac_addr, msg);
+
+    AckOptionReader reader(msg, frame.len);
+    AckOption type;
+    const uint8_t* value;
+    uint8_t value_len;
+    while (reader.next(type, value, value_len)) {
+        Time warm, cold;
+        EpochTime master_time;
+        if (type == AckOption::SCHEDULE && AckOptionReader::readSchedule(value, value_len, warm, cold)) {
+            lights.setSchedule(warm, cold);
+            LOG_INFO("Schedule received with the ACK");
+        } else if (type == AckOption::EPOCH_TIME && AckOptionReader::readEpochTime(value, value_len, master_time)) {
+            setClock(frame, master_time, measured ? round_trip_ms : NO_ROUND_TRIP);
+        }
+    }
+}
+
+// The ACK left the master about half a round trip before it was received, and waited in the ingress ring since.
+// The round trip of this exchange is preferred, the estimate of earlier ones covers frames no longer pending
+void RoomNode::setClock(const IncomingMsg& frame, const EpochTime& master_time, uint32_t round_trip_ms) {
+    uint32_t delay_ms = millis() - frame.received_ms;
+    RttEstimator rtt;
+    if (round_trip_ms != NO_ROUND_TRIP) {
+        delay_ms += round_trip_ms / 2;
+    } else if (communications.getRtt(frame.mac_addr, rtt) && rtt.samples > 0) {
+        delay_ms += rtt.srttMs() / 2;
+    }
+
+    bool was_valid = ntpClient.isTimeValid();
+    int32_t correction_ms = ntpClient.setTime(master_time, delay_ms);
+    if (!was_valid) {
+        LOG_INFO("Clock set from the master (delay %u ms)", (unsigned)delay_ms);
+    } else if (correction_ms > CLOCK_LOG_THRESHOLD_MS || correction_ms < -CLOCK_LOG_THRESHOLD_MS) {
+        LOG_INFO("Clock corrected by %ld ms from the master", (long)correction_ms);
+    }
+}
+
+void RoomNode::onNewSchedule(const IncomingMsg& frame, const NewScheduleMsg& msg) {
+    if (!connected){
+        LOG_WARNING("NEW_SCHEDULE message is not expected");
+        return;
+    }
+    lights.setSchedule(msg.warm, msg.cold);
+    communications.sendAck(master_mac_addr, MessageType::NEW_SCHEDULE, msg.header.seq);
+}
+
+void RoomNode::onLightsToggle(const IncomingMsg& frame, const LightsToggleMsg& msg) {
+    if (!connected){
+        LOG_WARNING("LIGHTS_TOGGLE message is not expected");
+        return;
+    }
+    communications.sendAck(master_mac_addr, MessageType::LIGHTS_TOGGLE, msg.header.seq);
+    bool turn_on = msg.turn_on;
+    xQueueSend(lightsToggleQueue, &turn_on, portMAX_DELAY);
+}
+
+void RoomNode::onBeacon(const IncomingMsg& frame, const BeaconMsg& msg) {
+    communications.beaconReceived(frame.mac_addr, msg);
+}
+
+// Applies a broadcast scene addressed to this room and ACKs it, once per scene_id
+void RoomNode::onScene(const IncomingMsg& frame, const SceneMsg& msg) {
+    if (memcmp(frame.mac_addr, master_mac_addr, MAC_ADDRESS_LENGTH) != 0 || room_id >= MAX_SCENE_ROOMS ||
+        !(msg.room_mask & (1u << room_id))) {
+        return; // Not for this room
+    }
+    if (!connected){
+        LOG_WARNING("SCENE message is not expected");
+        return;
+    }
+
+    if (msg.scene_id != last_scene_id) {
+        last_scene_id = msg.scene_id;
+        if (msg.command == SceneCommand::LIGHTS) {
+            bool turn_on = msg.turn_on;
+            xQueueSend(lightsToggleQueue, &turn_on, portMAX_DELAY);
+        } else if (msg.command == SceneCommand::SCHEDULE) {
+            lights.setSchedule(msg.warm, msg.cold);
+        }
+        LOG_INFO("Applied scene %u", msg.scene_id);
+    }
+
+    // Sent outside the reliable transport: scene ids are not sequence numbers of the master's frames
+    AckMsg ack;
+    ack.acked_msg = MessageType::SCENE;
+    ack.acked_seq = msg.scene_id;
+    ack.sack = 0;
+    communications.sendMsg((uint8_t*)master_mac_addr, reinterpret_cast<uint8_t*>(&ack), ACK_HEADER_SIZE);
+}
+
 // Periodically checks and updates lights mode/brightness
 void RoomNode::lightsControlTask(void* pvParameter) {
     RoomNode* self = static_cast<RoomNode*>(pvParameter);
@@ -227,16 +266,19 @@ void RoomNode::lightsControlTask(void* pvParameter) {
             vTaskDelay(pdMS_TO_TICKS(100));
         }
         if (self->lights.isOn()){
-            now = time(nullptr);
-            struct tm timeinfo;
-            localtime_r(&now, &timeinfo);
-            current_minutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
-            // Initialize mode each time the lights are turned on
-            if (!lights_on){
-                self->lights.initializeMode(current_minutes);
-                lights_on = true;
-            } else {
-                self->lights.checkAndUpdateMode(current_minutes);
+            // The warm/cold mode needs the clock, set by the master once the node has joined
+            if (self->ntpClient.isTimeValid()) {
+                now = time(nullptr);
+                struct tm timeinfo;
+                localtime_r(&now, &timeinfo);
+                current_minutes = timeinfo.tm_hour * 60 + timeinfo.tm_min;
+                // Initialize mode each time the lights are turned on
+                if (!lights_on){
+                    self->lights.initializeMode(current_minutes);
+                    lights_on = true;
+                } else {
+                    self->lights.checkAndUpdateMode(current_minutes);
+                }
             }
             self->lights.adjustBrightness();
             
@@ -298,36 +340,6 @@ void RoomNode::presenceTask(void* pvParameter) {
     }
 }
 
-// Periodically performs NTP sync by temporarily reconnecting to Wi-Fi
-void RoomNode::NTPSyncTask(void* pvParameter) {
-    RoomNode* self = static_cast<RoomNode*>(pvParameter);
-
-    while (true) {
-        vTaskDelay(pdMS_TO_TICKS(NTPSYNC_PERIOD));
-        // Semaphore is needed because router may assign a different channel from the MasterDevice
-        xSemaphoreTake(self->radioMutex, portMAX_DELAY);
-            WiFi.reconnect();
-            LOG_INFO("WiFi reconnecting for NTP");
-            while (WiFi.status() != WL_CONNECTED) {
-                vTaskDelay(pdMS_TO_TICKS(500));
-                #ifdef ENABLE_LOGGING
-                    Serial.print(".");
-                #endif
-            }
-            LOG_INFO("Wi-Fi connected");
-            self->ntpClient.initialize();
-
-            WiFi.disconnect();
-        LOG_INFO("WiFi disconnected after NTP sync");
-        esp_wifi_set_channel(self->wifi_channel, WIFI_SECOND_CHAN_NONE); // Set WiFi channel back to master's channel
-        xSemaphoreGive(self->radioMutex);
-        
-        // UBaseType_t watermark = uxTaskGetStackHighWaterMark(NULL);
-        // LOG_INFO("NTPSyncTask: Stack watermark = %u", (unsigned)watermark);
-
-    }
-}
-
 void RoomNode::heartbeatTask(void* pvParameter){
     RoomNode* self = static_cast<RoomNode*>(pvParameter);
     HeartbeatMsg msg;
@@ -336,11 +348,9 @@ void RoomNode::heartbeatTask(void* pvParameter){
         vTaskDelay(pdMS_TO_TICKS(HEARTBEAT_PERIOD));
         if (self->connected){
             msg.room_id = self->room_id;
-            if (self->communications.sendMsg(reinterpret_cast<uint8_t*>(&msg), sizeof(msg))){
-                if (!self->communications.waitForAck(MessageType::HEARTBEAT, self->HEARTBEAT_TIMEOUT)){
-                    self->connected = false;
-                    LOG_WARNING("HEARTBEAT Ack not received. Trying to reconnect to the network...");
-                }
+            if (!self->communications.sendToMaster(reinterpret_cast<uint8_t*>(&msg), sizeof(msg))){
+                self->connected = false;
+                LOG_WARNING("HEARTBEAT Ack not received. Trying to reconnect to the network...");
             }
         }
         if (!self->connected){
@@ -414,7 +424,7 @@ void RoomNode::toggleLightsAndUpdate(bool turn_on) {
     // Send lights update to master
     LightsUpdateMsg lights_update;
     lights_update.is_on = lights.isOn();
-    communications.sendMsg(reinterpret_cast<const uint8_t*>(&lights_update), sizeof(lights_update));
+    communications.postToMaster(reinterpret_cast<const uint8_t*>(&lights_update), sizeof(lights_update));
 
 
 }
\ No newline at end of file
@@ -13,12 +13,8 @@ ESPNowHandler* ESPNowHandler::instance = nullptr;
 
 ESPNowHandler::ESPNowHandler(PowerManager& powerManager) 
     : CommunicationsBase(),
-      powerManager(powerManager),
-      ack_received(false),
-      wait_for_send(false),
-      last_acked_msg(MessageType::ACK) {
+      powerManager(powerManager) {
     instance = this;
-    ackSemaphore = xSemaphoreCreateBinary(); // Used to wait for ACKs
 }
 
 bool ESPNowHandler::initializeESPNOW(const uint8_t* master_mac_address, const uint8_t channel) {
@@ -29,61 +25,41 @@ bool ESPNowHandler::initializeESPNOW(const uint8_t* master_mac_address, const ui
     return CommunicationsBase::initializeESPNOW();
 }
 
-void ESPNowHandler::sendMsg(const uint8_t* data, size_t size) {
-    // Assume only one registered peer (master)
-    if (numPeers > 0) {
-        CommunicationsBase::sendMsg(peers[0].mac_addr, data, size);
-    } else {
-        LOG_WARNING("No peers registered.");
-    }
-}
-
-bool ESPNowHandler::waitForAck(MessageType expected_ack, unsigned long timeout_ms) {
-    ack_received = false;
-    last_acked_msg = expected_ack;
-
-    return (xSemaphoreTake(ackSemaphore, pdMS_TO_TICKS(timeout_ms)) == pdTRUE) && ack_received;
+bool ESPNowHandler::sendToMaster(const uint8_t* data, size_t size) {
+    // Fails right away if the master is not registered
+    return sendAndWait(master_mac_addr, data, size);
 }
 
 void ESPNowHandler::onDataRecv(const uint8_t* mac_addr, const uint8_t* data, int len) {
-    if (len < 1) {
-        LOG_INFO("Received empty message.");
+    if (!isValidFrame(data, len)) {
+        LOG_INFO("Received malformed message or unsupported protocol version.");
         return;
     }
 
     MessageType msg_type = static_cast<MessageType>(data[0]);
 
     if (msg_type == MessageType::ACK) {
-        // Check length and acked_msg match
-        if (len >= sizeof(AckMsg)) {
-            const AckMsg* ack = reinterpret_cast<const AckMsg*>(data);
-            if (ack->acked_msg == last_acked_msg) {
-                ack_received = true;
-                xSemaphoreGive(ackSemaphore);
-                LOG_INFO("ACK received from master");
-            }
-        } else {
-            LOG_WARNING("ACK received with incorrect length.");
-        }
-    } else if (msg_type == MessageType::NEW_SLEEP_PERIOD) {
-        // Interpret as ACK and update sleep period
-        if (len >= sizeof(NewSleepPeriodMsg)) {
-            const NewSleepPeriodMsg* new_sleep = reinterpret_cast<const NewSleepPeriodMsg*>(data);
-            powerManager.updateSleepPeriod(new_sleep->new_period_ms);
-            LOG_INFO("NEW_SLEEP_PERIOD interpreted as ACK");
-            ack_received = true;
-
-            // Send ACK back to master
-            CommunicationsBase::sendAck(mac_addr, MessageType::NEW_SLEEP_PERIOD);
-
-            wait_for_send = true;
-            
-            // Signal semaphore after sending ack
-            xSemaphoreGive(ackSemaphore);
-        } else {
-            LOG_WARNING("NEW_SLEEP_PERIOD message received with incorrect length.");
-        }
+        // Options are applied before the waiting sender is released and the node goes to sleep
+        const AckMsg* ack = reinterpret_cast<const AckMsg*>(data);
+        applyAckOptions(*ack, len);
+        handleAck(mac_addr, *ack);
+    } else if (msg_type == MessageType::BEACON) {
+        beaconReceived(mac_addr, *reinterpret_cast<const BeaconMsg*>(data));
     } else {
         LOG_WARNING("Received unknown or unhandled message type.");
     }
+}
+
+void ESPNowHandler::applyAckOptions(const AckMsg& ack, size_t len) {
+    AckOptionReader reader(ack, len);
+    AckOption type;
+    const uint8_t* value;
+    uint8_t value_len;
+    while (reader.next(type, value, value_len)) {
+        uint32_t sleep_period_ms;
+        if (type == AckOption::SLEEP_PERIOD && AckOptionReader::readU32(value, value_len, sleep_period_ms)) {
+            powerManager.updateSleepPeriod(sleep_period_ms);
+            LOG_INFO("New sleep period received with the ACK: %u ms", sleep_period_ms);
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,80 @@
+/**
+ * @file SampleBuffer.cpp
+ * @brief Implementation of SampleBuffer, the RTC memory ring of pending sensor readings
+ * 
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "SensorNode/SampleBuffer.h"
+
+void SampleBuffer::push(uint32_t taken_at_s, int16_t temperature, uint16_t humidity) {
+    uint16_t idx = (head + count) % SAMPLE_BUFFER_CAPACITY;
+    if (count == SAMPLE_BUFFER_CAPACITY) {
+        // Buffer full, oldest reading is replaced
+        head = (head + 1) % SAMPLE_BUFFER_CAPACITY;
+        overwritten++;
+        LOG_WARNING("Sample buffer full, %u readings lost so far", overwritten);
+    } else {
+        count++;
+    }
+    samples[idx].taken_at_s = taken_at_s;
+    samples[idx].temperature = temperature;
+    samples[idx].humidity = humidity;
+}
+
+uint8_t SampleBuffer::fill(SampleRecord* out, uint8_t max_samples, uint32_t now_s) const {
+    uint8_t n = count < max_samples ? count : max_samples;
+    for (uint8_t i = 0; i < n; i++) {
+        out[i] = toRecord(i, now_s);
+    }
+    return n;
+}
+
+uint8_t SampleBuffer::encode(SampleEncoder& encoder, uint32_t now_s) const {
+    for (uint16_t i = 0; i < count; i++) {
+        if (!encoder.add(toRecord(i, now_s))) {
+            break;
+        }
+    }
+    return encoder.count();
+}
+
+SampleRecord SampleBuffer::toRecord(uint16_t i, uint32_t now_s) const {
+    const BufferedSample& sample = samples[(head + i) % SAMPLE_BUFFER_CAPACITY];
+    SampleRecord record;
+    record.age_s = now_s >= sample.taken_at_s ? now_s - sample.taken_at_s : 0;
+    record.temperature = sample.temperature;
+    record.humidity = sample.humidity;
+    return record;
+}
+
+void SampleBuffer::drop(uint16_t n) {
+    if (n > count) {
+        n = count;
+    }
+    head = (head + n) % SAMPLE_BUFFER_CAPACITY;
+    count -= n;
+}
+
+void SampleBuffer::countWake() {
+    if (wakes_since_uplink < UINT8_MAX) {
+        wakes_since_uplink++;
+    }
+}
+
+void SampleBuffer::uplinkDone() {
+    wakes_since_uplink = 0;
+}
+
+bool SampleBuffer::uplinkDue() const {
+    return wakes_since_uplink >= UPLINK_EVERY_N_WAKES || count >= MAX_BATCH_SAMPLES;
+}
+
+uint16_t SampleBuffer::size() const {
+    return count;
+}
+
+bool SampleBuffer::isEmpty() const {
+    return count == 0;
+}
@@ -8,10 +8,14 @@
 
 #include "SensorNode/SensorNode.h"
 
-SensorNode::SensorNode(const uint8_t room_id, uint32_t* sleep_duration, uint8_t* channel_wifi, bool* first_cycle)
+SensorNode::SensorNode(const uint8_t room_id, uint32_t* sleep_duration, uint8_t* channel_wifi, bool* first_cycle,
+                       SampleBuffer* sample_buffer, MasterLink* link)
     : room_id(room_id),
       channel_wifi(channel_wifi),
       first_cycle(first_cycle),
+      sample_buffer(sample_buffer),
+      link(link),
+      just_joined(false),
       sht31Sensor(SHT31_ADDRESS, SDA_PIN, SCL_PIN),
       powerManager(sleep_duration),
       espNowHandler(powerManager) {}
@@ -32,77 +36,137 @@ bool SensorNode::joinNetwork() {
     msg.room_id = room_id;
     msg.sleep_period_ms = powerManager.getSleepPeriod();
 
-    // Cycle through channels to find the Master
-    for (uint8_t i = 0; i < MAX_WIFI_CHANNEL; i++) {
-        channel = (channel + i) % MAX_WIFI_CHANNEL;
-        esp_wifi_set_channel(channel, WIFI_SECOND_CHAN_NONE);
-
-        espNowHandler.registerPeer((uint8_t*)master_mac_addr, channel);
-        bool ack_received = false;
-        uint8_t retries = 0;
-
-        while (!ack_received && retries < MAX_RETRIES) {
-            espNowHandler.sendMsg(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg));
-            if (espNowHandler.waitForAck(MessageType::JOIN_SENSOR, ACK_TIMEOUT_MS)) {
-                ack_received = true;
-            } else {
-                retries++;
-                LOG_WARNING("No ACK, retrying (%u/%u)", retries, MAX_RETRIES);
-            }
-        }
+    // Listen for the master beacon, starting on the last known channel
+    channel = espNowHandler.findMaster(channel);
+    if (channel == 0) {
+        LOG_WARNING("No master beacon heard on any channel");
+        return false;
+    }
 
-        if (ack_received) {
-            LOG_INFO("Master found on channel %u", channel);
-            *channel_wifi = channel;
-            return true;
-        }
-        LOG_INFO("No ACK on channel %u, trying next.", channel);
-        espNowHandler.unregisterPeer((uint8_t*)master_mac_addr);
+    registerMaster(channel);
+    if (espNowHandler.sendToMaster(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg))) {
+        LOG_INFO("Joined master on channel %u", channel);
+        *channel_wifi = channel;
+        just_joined = true;
+        return true;
     }
+    LOG_WARNING("No ACK for JOIN_SENSOR on channel %u", channel);
+    espNowHandler.unregisterPeer((uint8_t*)master_mac_addr);
     return false;
 }
 
 void SensorNode::run() {
     float temperature, humidity;
 
-    espNowHandler.registerPeer((uint8_t*)master_mac_addr, *channel_wifi);
+    registerMaster(*channel_wifi);
 
-    if (!sht31Sensor.readSensorData(temperature, humidity)) {
+    bool sample_ok = sht31Sensor.readSensorData(temperature, humidity);
+    if (!sample_ok) {
         LOG_WARNING("Failed to read SHT31!");
     } else {
         LOG_INFO("Sensor data: Temp=%.2f°C, Hum=%.2f%%", temperature, humidity);
-        TempHumidMsg msg;
-        msg.room_id = room_id;
-        msg.temperature = temperature;
-        msg.humidity = humidity;
-
-        bool ack_received = false;
-        uint8_t retries = 0;
-        while (!ack_received && retries < MAX_RETRIES) {
-            espNowHandler.sendMsg(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg));
-            if (espNowHandler.waitForAck(MessageType::TEMP_HUMID, ACK_TIMEOUT_MS)) {
-                ack_received = true;
-            } else {
-                retries++;
-                LOG_WARNING("No ACK for TEMP_HUMID, retry (%u/%u)", retries, MAX_RETRIES);
-            }
+    }
+
+    bool ack_received = true;
+    if (BATCH_UPLINK) {
+        if (sample_ok) {
+            sample_buffer->push(time(nullptr), encodeTemperature(temperature), encodeHumidity(humidity));
         }
+        sample_buffer->countWake();
 
-        if (!ack_received) {
-            LOG_ERROR("No ACK after max retries for sensor data");
-            // Try to joinNetwork next cycle
-            *first_cycle = true;
-            powerManager.retryLater();
+        if (just_joined || sample_buffer->uplinkDue()) {
+            ack_received = sendBufferedSamples();
+        } else {
+            LOG_INFO("Reading buffered (%u pending), radio kept off", sample_buffer->size());
         }
+    } else if (sample_ok) {
+        ack_received = sendSample(temperature, humidity);
+    }
+
+    if (!ack_received) {
+        LOG_ERROR("No ACK after max retries for sensor data");
+        // Try to joinNetwork next cycle, buffered readings are kept for the next uplink
+        *first_cycle = true;
+        powerManager.retryLater();
+    }
+}
+
+void SensorNode::registerMaster(uint8_t channel) {
+    // Already registered after joinNetwork() in this wake-up, its transport state is the current one
+    if (espNowHandler.registerPeer((uint8_t*)master_mac_addr, channel)) {
+        espNowHandler.setNextSeq(master_mac_addr, link->tx_seq);
+        espNowHandler.setRtt(master_mac_addr, link->rtt);
+    }
+}
+
+bool SensorNode::sendSample(float temperature, float humidity) {
+    TempHumidMsg msg;
+    msg.room_id = room_id;
+    msg.temperature = encodeTemperature(temperature);
+    msg.humidity = encodeHumidity(humidity);
+
+    return espNowHandler.sendToMaster(reinterpret_cast<const uint8_t*>(&msg), sizeof(msg));
+}
 
-        if (espNowHandler.wait_for_send){
-            // Wait for message to be sent before going to sleep
-            vTaskDelay(pdMS_TO_TICKS(50));
+bool SensorNode::sendBufferedSamples() {
+    // Backlog from periods without master may need more than one frame
+    while (!sample_buffer->isEmpty()) {
+        uint8_t sent = COMPRESS_BATCHES ? sendPackedFrame() : sendBatchFrame();
+        if (sent == 0) {
+            return false;
         }
+        sample_buffer->drop(sent);
+        LOG_INFO("Batch of %u readings acknowledged, %u left", sent, sample_buffer->size());
+    }
+    sample_buffer->uplinkDone();
+    just_joined = false;
+    return true;
+}
+
+uint8_t SensorNode::sendBatchFrame() {
+    TempHumidBatchMsg msg;
+    msg.room_id = room_id;
+    msg.uplink_every = UPLINK_EVERY_N_WAKES;
+    msg.count = sample_buffer->fill(msg.samples, MAX_BATCH_SAMPLES, time(nullptr));
+
+    if (!espNowHandler.sendToMaster(reinterpret_cast<const uint8_t*>(&msg), batchMsgSize(msg.count))) {
+        return 0;
+    }
+    return msg.count;
+}
+
+uint8_t SensorNode::sendPackedFrame() {
+    TempHumidPackedMsg msg;
+    msg.room_id = room_id;
+    msg.uplink_every = UPLINK_EVERY_N_WAKES;
+
+    SampleEncoder encoder(msg.payload, sizeof(msg.payload));
+    msg.count = sample_buffer->encode(encoder, time(nullptr));
+    LOG_INFO("Packed %u readings in %u bytes", msg.count, encoder.size());
+
+    if (!espNowHandler.sendToMaster(reinterpret_cast<const uint8_t*>(&msg), BATCH_HEADER_SIZE + encoder.size())) {
+        return 0;
     }
+    return msg.count;
 }
 
 void SensorNode::goSleep(bool permanent) {
+    // Sleep as soon as the radio has reported the last frame
+    if (!espNowHandler.waitForAllTx(TX_CONFIRM_TIMEOUT_MS)) {
+        LOG_WARNING("Radio did not report the last frames, sleeping anyway");
+    }
+
+    espNowHandler.getNextSeq(master_mac_addr, link->tx_seq);
+    if (espNowHandler.getRtt(master_mac_addr, link->rtt)) {
+        LOG_INFO("RTT to master: srtt %u ms, rttvar %u ms, timeout %u ms (%u samples)",
+                 (unsigned)link->rtt.srttMs(), (unsigned)link->rtt.rttvarMs(),
+                 (unsigned)link->rtt.timeout(), (unsigned)link->rtt.samples);
+    }
+    TxStats tx_stats;
+    if (espNowHandler.getTxStats(master_mac_addr, tx_stats)) {
+        LOG_INFO("Frames to master: %u delivered, %u failed at MAC level",
+                 (unsigned)tx_stats.delivered, (unsigned)tx_stats.failed);
+    }
     if (permanent) {
         powerManager.enterPermanentDeepSleep();
     } else{
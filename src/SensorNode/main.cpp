@@ -13,9 +13,11 @@
 RTC_DATA_ATTR bool first_cycle = true;
 RTC_DATA_ATTR uint32_t sleep_period_ms = DEFAULT_SLEEP_DURATION;
 RTC_DATA_ATTR uint8_t channel_wifi = 0;
+RTC_DATA_ATTR SampleBuffer sample_buffer;
+RTC_DATA_ATTR MasterLink master_link;
 
 // Create the SensorNode with references to RTC-stored variables
-SensorNode sensorNode(ROOM_ID, &sleep_period_ms, &channel_wifi, &first_cycle);
+SensorNode sensorNode(ROOM_ID, &sleep_period_ms, &channel_wifi, &first_cycle, &sample_buffer, &master_link);
 
 void setup() {
     Serial.begin(115200);
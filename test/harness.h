@@ -0,0 +1,56 @@
+/**
+ * @file harness.h
+ * @brief Minimal assertion and timing helpers shared by the host tests
+ *
+ * Each test is its own executable: it runs its checks, prints its measurements and returns
+ * report(), which is non-zero when a check failed so ctest marks the test as failed.
+ *
+ * Timing budgets are loose on purpose. They hold on any host several times over and only catch a
+ * change of complexity, e.g. a lookup that became a scan; the printed figures are the measurement.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+
+static int checkFailures = 0;
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);          \
+            checkFailures++;                                                              \
+        }                                                                                 \
+    } while (0)
+
+// Keeps benchmark results alive so the compiler cannot drop the measured work
+static volatile uint32_t benchmarkSink;
+
+// Runs fn iterations times and returns the nanoseconds per call
+template <typename Fn>
+double nsPerCall(uint32_t iterations, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iterations; i++) {
+        fn(i);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+}
+
+// Prints a measurement and checks it against its budget
+#define CHECK_TIME(label, ns, budget_ns)                                                  \
+    do {                                                                                  \
+        double measured = (ns);                                                           \
+        printf("  %-40s %10.1f ns (budget %.0f ns)\n", label, measured, (double)(budget_ns)); \
+        CHECK(measured < (budget_ns));                                                    \
+    } while (0)
+
+inline int report(const char* name) {
+    printf("%s: %s\n", name, checkFailures == 0 ? "passed" : "FAILED");
+    return checkFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file Arduino.h
+ * @brief Host stand-in for the parts of the Arduino core used by the modules under test
+ *
+ * millis() follows the host clock plus the time skipped by delay() and vTaskDelay(), which return
+ * at once, so code that waits runs at full speed on the host. Events scheduled with hostCallAt() run
+ * when a wait reaches their time, which is how tests simulate what other devices do meanwhile.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
+
+// Logs are dropped, the tests report through their own output
+struct HardwareSerial {
+    void begin(unsigned long) {}
+    int printf(const char*, ...) { return 0; }
+    template <typename T> void print(T) {}
+    template <typename T> void println(T) {}
+};
+extern HardwareSerial Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// Moves millis() forward without waiting
+void hostAdvanceMillis(uint32_t ms);
+
+// Runs fn(context) once millis() reaches at_ms during a delay() or a blocking FreeRTOS call
+void hostCallAt(uint32_t at_ms, void (*fn)(void*), void* context);
+
+// Drops the events not run yet
+void hostClearEvents();
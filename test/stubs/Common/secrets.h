@@ -0,0 +1,12 @@
+/**
+ * @file secrets.h
+ * @brief Placeholder Wi-Fi credentials for the host builds, the real file is not in the repository
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#define WIFI_SSID "host-test"
+#define WIFI_PASSWORD "host-test"
@@ -0,0 +1,63 @@
+/**
+ * @file FS.h
+ * @brief Host stand-in for the Arduino file system API, backed by a directory of the host
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <memory>
+#include <string>
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct HostFile;
+
+// A file or directory, closed when the last copy is closed or destroyed
+class File {
+public:
+    File() {}
+    explicit File(std::shared_ptr<HostFile> file) : file(file) {}
+
+    operator bool() const;
+    size_t read(uint8_t* buffer, size_t size);
+    size_t write(const uint8_t* buffer, size_t size);
+    bool seek(uint32_t position, SeekMode mode = SeekSet);
+    size_t position() const;
+    size_t size() const;
+    void close();
+
+    // Entry name without its directory, as in the ESP32 core
+    const char* name() const;
+    bool isDirectory() const;
+    File openNextFile();
+
+private:
+    std::shared_ptr<HostFile> file;
+};
+
+// Paths are absolute within the file system, e.g. "/history/00000001.log"
+class FS {
+public:
+    // Host directory holding the file system, which must exist
+    void setRoot(const std::string& dir) { root = dir; }
+
+    File open(const char* path, const char* mode = "r");
+    bool exists(const char* path);
+    bool mkdir(const char* path);
+    bool remove(const char* path);
+    bool rename(const char* from, const char* to);
+
+private:
+    std::string hostPath(const char* path) const { return root + path; }
+
+    std::string root;
+};
+
+namespace fs {
+using ::File;
+using ::FS;
+}
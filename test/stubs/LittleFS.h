@@ -0,0 +1,17 @@
+/**
+ * @file LittleFS.h
+ * @brief Host stand-in for the LittleFS instance, see FS.h
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "FS.h"
+
+class LittleFSFS : public FS {
+public:
+    bool begin(bool = false) { return true; }
+};
+extern LittleFSFS LittleFS;
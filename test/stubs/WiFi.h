@@ -0,0 +1,32 @@
+/**
+ * @file WiFi.h
+ * @brief Host stand-in for the Arduino WiFi object, always connected
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include "esp_wifi.h"
+
+#define WIFI_STA 1
+#define WL_CONNECTED 3
+
+struct IPAddress {
+    std::string toString() const { return "192.168.1.2"; }
+};
+
+struct WiFiClass {
+    void mode(int) {}
+    void disconnect() {}
+    void begin(const char*, const char*) {}
+    void setSleep(bool) {}
+    int status() { return WL_CONNECTED; }
+    IPAddress localIP() { return IPAddress(); }
+    std::string macAddress() { return "3C:84:27:E1:B2:CC"; }
+    uint8_t channel() { return hostWifiChannel(); }
+};
+extern WiFiClass WiFi;
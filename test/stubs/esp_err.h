@@ -0,0 +1,14 @@
+/**
+ * @file esp_err.h
+ * @brief Host stand-in for the ESP-IDF error codes
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
@@ -0,0 +1,20 @@
+/**
+ * @file esp_heap_caps.h
+ * @brief Host stand-in for the ESP-IDF capability allocator, backed by malloc
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+inline void* heap_caps_malloc(size_t size, uint32_t) { return malloc(size); }
+inline void heap_caps_free(void* ptr) { free(ptr); }
+inline bool psramFound() { return true; }
@@ -0,0 +1,53 @@
+/**
+ * @file esp_now.h
+ * @brief Host stand-in for the ESP-NOW driver: its peer list, with the hardware limit, and sends
+ *
+ * Sends are accepted when the destination is in the peer list and never reported; tests call the
+ * send callback themselves when they need an outcome.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_wifi.h"
+
+#define ESP_NOW_ETH_ALEN 6
+#define ESP_NOW_MAX_DATA_LEN 250
+#define ESP_NOW_MAX_TOTAL_PEER_NUM 20
+#define ESP_ERR_ESPNOW_FULL 0x3067
+#define ESP_ERR_ESPNOW_NOT_FOUND 0x3068
+#define ESP_ERR_ESPNOW_EXIST 0x3069
+
+typedef enum { ESP_NOW_SEND_SUCCESS = 0, ESP_NOW_SEND_FAIL } esp_now_send_status_t;
+
+typedef struct {
+    uint8_t peer_addr[ESP_NOW_ETH_ALEN];
+    uint8_t lmk[16];
+    uint8_t channel;
+    wifi_interface_t ifidx;
+    bool encrypt;
+    void* priv;
+} esp_now_peer_info_t;
+
+typedef void (*esp_now_recv_cb_t)(const uint8_t* mac_addr, const uint8_t* data, int len);
+typedef void (*esp_now_send_cb_t)(const uint8_t* mac_addr, esp_now_send_status_t status);
+
+esp_err_t esp_now_init();
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t cb);
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t cb);
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t* data, size_t len);
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer);
+esp_err_t esp_now_del_peer(const uint8_t* peer_addr);
+bool esp_now_is_peer_exist(const uint8_t* peer_addr);
+
+// Peers in the driver list, and frames it accepted since the last reset
+int hostDriverPeerCount();
+uint32_t hostSentFrames();
+
+// Empties the peer list and the counters
+void hostResetDriver();
@@ -0,0 +1,23 @@
+/**
+ * @file esp_wifi.h
+ * @brief Host stand-in for the Wi-Fi channel calls, which only record the channel
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum { WIFI_SECOND_CHAN_NONE = 0 } wifi_second_chan_t;
+typedef enum { WIFI_IF_STA = 0, WIFI_IF_AP } wifi_interface_t;
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t second);
+
+// Channel the radio listens on, 0 until it is set
+uint8_t hostWifiChannel();
+
+// Called with every channel set, nullptr to stop
+void hostSetChannelHook(void (*hook)(uint8_t channel));
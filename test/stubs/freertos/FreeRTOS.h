@@ -0,0 +1,40 @@
+/**
+ * @file FreeRTOS.h
+ * @brief Host stand-in for the FreeRTOS types and task calls used by the modules under test
+ *
+ * Ticks are milliseconds. Tasks are never started, tests call the task bodies they need directly.
+ * Blocking calls do not sleep: simulated time moves on to the next event scheduled with hostCallAt()
+ * until the call can return or its timeout runs out. The blocking calls are not thread-safe.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+BaseType_t xTaskCreate(TaskFunction_t task, const char* name, uint32_t stack, void* parameters,
+                       UBaseType_t priority, TaskHandle_t* handle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+
+// The one notification count of the task running the test
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
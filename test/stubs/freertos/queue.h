@@ -0,0 +1,20 @@
+/**
+ * @file queue.h
+ * @brief Host stand-in for FreeRTOS queues of fixed-size items, on the simulated clock
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct HostQueue;
+typedef HostQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
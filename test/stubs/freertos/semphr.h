@@ -0,0 +1,23 @@
+/**
+ * @file semphr.h
+ * @brief Host stand-in for FreeRTOS semaphores and mutexes, as counters on the simulated clock
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "FreeRTOS.h"
+
+struct HostSemaphore;
+typedef HostSemaphore* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+void vSemaphoreDelete(SemaphoreHandle_t semaphore);
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higher_priority_task_woken);
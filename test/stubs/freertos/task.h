@@ -0,0 +1,11 @@
+/**
+ * @file task.h
+ * @brief Host stand-in for freertos/task.h, declared in FreeRTOS.h
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#pragma once
+
+#include "FreeRTOS.h"
@@ -0,0 +1,129 @@
+/**
+ * @file fs.cpp
+ * @brief Host implementation of the file system stand-in over stdio and dirent
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include <LittleFS.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+LittleFSFS LittleFS;
+
+struct HostFile {
+    std::string host_path;
+    std::string name;
+    FILE* stream;
+    DIR* dir;
+
+    HostFile() : stream(nullptr), dir(nullptr) {}
+    ~HostFile() { close(); }
+
+    void close() {
+        if (stream != nullptr) {
+            fclose(stream);
+            stream = nullptr;
+        }
+        if (dir != nullptr) {
+            closedir(dir);
+            dir = nullptr;
+        }
+    }
+};
+
+File::operator bool() const {
+    return file && (file->stream != nullptr || file->dir != nullptr);
+}
+
+size_t File::read(uint8_t* buffer, size_t size) {
+    return *this && file->stream ? fread(buffer, 1, size, file->stream) : 0;
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    return *this && file->stream ? fwrite(buffer, 1, size, file->stream) : 0;
+}
+
+bool File::seek(uint32_t position, SeekMode mode) {
+    int whence = mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END;
+    return *this && file->stream && fseek(file->stream, position, whence) == 0;
+}
+
+size_t File::position() const {
+    return *this && file->stream ? ftell(file->stream) : 0;
+}
+
+size_t File::size() const {
+    if (!*this || file->stream == nullptr) {
+        return 0;
+    }
+    fflush(file->stream);
+    struct stat info;
+    return fstat(fileno(file->stream), &info) == 0 ? info.st_size : 0;
+}
+
+void File::close() {
+    if (file) {
+        file->close();
+    }
+}
+
+const char* File::name() const {
+    return file ? file->name.c_str() : "";
+}
+
+bool File::isDirectory() const {
+    return *this && file->dir != nullptr;
+}
+
+File File::openNextFile() {
+    if (!isDirectory()) {
+        return File();
+    }
+    struct dirent* entry;
+    while ((entry = readdir(file->dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+            std::shared_ptr<HostFile> next = std::make_shared<HostFile>();
+            next->host_path = file->host_path + "/" + entry->d_name;
+            next->name = entry->d_name;
+            next->stream = fopen(next->host_path.c_str(), "rb");
+            return File(next);
+        }
+    }
+    return File();
+}
+
+File FS::open(const char* path, const char* mode) {
+    std::shared_ptr<HostFile> file = std::make_shared<HostFile>();
+    file->host_path = hostPath(path);
+    const char* slash = strrchr(path, '/');
+    file->name = slash != nullptr ? slash + 1 : path;
+
+    struct stat info;
+    if (mode[0] == 'r' && stat(file->host_path.c_str(), &info) == 0 && S_ISDIR(info.st_mode)) {
+        file->dir = opendir(file->host_path.c_str());
+    } else {
+        std::string host_mode = std::string(mode) + "b";
+        file->stream = fopen(file->host_path.c_str(), host_mode.c_str());
+    }
+    return File(file);
+}
+
+bool FS::exists(const char* path) {
+    struct stat info;
+    return stat(hostPath(path).c_str(), &info) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return ::mkdir(hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return ::remove(hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* from, const char* to) {
+    return ::rename(hostPath(from).c_str(), hostPath(to).c_str()) == 0;
+}
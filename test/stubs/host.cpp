@@ -0,0 +1,220 @@
+/**
+ * @file host.cpp
+ * @brief Host implementation of the Arduino and FreeRTOS stand-ins
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include <Arduino.h>
+#include <freertos/semphr.h>
+#include <freertos/queue.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+
+HardwareSerial Serial;
+
+struct HostSemaphore {
+    UBaseType_t count;
+    UBaseType_t max_count;
+};
+
+struct HostQueue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+namespace {
+const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+std::atomic<uint32_t> skippedMs(0);   // Time delay() and vTaskDelay() pretended to wait
+
+struct HostEvent {
+    uint32_t at_ms;
+    void (*fn)(void*);
+    void* context;
+};
+std::vector<HostEvent> events;        // Scheduled with hostCallAt(), in no particular order
+uint32_t notifications = 0;           // Notification count of the only task
+
+// Lets simulated time pass until ready(context) holds or ticks elapse, running the events due meanwhile.
+// A wait without a timeout and without events left to end it fails instead of hanging
+bool waitFor(bool (*ready)(void*), void* context, TickType_t ticks) {
+    uint32_t deadline = millis() + ticks;
+    while (!ready(context)) {
+        if (ticks == 0) {
+            return false;
+        }
+        size_t next = events.size();
+        for (size_t i = 0; i < events.size(); ++i) {
+            if ((ticks == portMAX_DELAY || static_cast<int32_t>(events[i].at_ms - deadline) <= 0) &&
+                (next == events.size() || static_cast<int32_t>(events[i].at_ms - events[next].at_ms) < 0)) {
+                next = i;
+            }
+        }
+        if (next == events.size()) {
+            if (ticks != portMAX_DELAY) {
+                int32_t left = static_cast<int32_t>(deadline - millis());
+                hostAdvanceMillis(left > 0 ? left : 0);
+            }
+            return ready(context);
+        }
+
+        HostEvent event = events[next];
+        events.erase(events.begin() + next);
+        int32_t until = static_cast<int32_t>(event.at_ms - millis());
+        if (until > 0) {
+            hostAdvanceMillis(until);
+        }
+        event.fn(event.context);
+    }
+    return true;
+}
+
+bool never(void*) {
+    return false;
+}
+
+bool semaphoreAvailable(void* context) {
+    return static_cast<HostSemaphore*>(context)->count > 0;
+}
+
+bool queueNotEmpty(void* context) {
+    return !static_cast<HostQueue*>(context)->items.empty();
+}
+
+bool notified(void*) {
+    return notifications > 0;
+}
+}
+
+unsigned long micros() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return static_cast<unsigned long>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()) +
+           skippedMs.load() * 1000UL;
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void hostAdvanceMillis(uint32_t ms) {
+    skippedMs += ms;
+}
+
+void hostCallAt(uint32_t at_ms, void (*fn)(void*), void* context) {
+    events.push_back({at_ms, fn, context});
+}
+
+void hostClearEvents() {
+    events.clear();
+}
+
+void delay(unsigned long ms) {
+    waitFor(never, nullptr, ms);
+    std::this_thread::yield();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* handle) {
+    static int dummy_task;
+    if (handle != nullptr) {
+        *handle = &dummy_task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    delay(ticks);
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static int test_task;
+    return &test_task;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+    notifications++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    if (!waitFor(notified, nullptr, ticks)) {
+        return 0;
+    }
+    uint32_t count = notifications;
+    notifications = clear_on_exit ? 0 : count - 1;
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return new HostSemaphore{0, 1};
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new HostSemaphore{1, 1};
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return new HostSemaphore{initial_count, max_count};
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t semaphore) {
+    delete semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks) {
+    if (!waitFor(semaphoreAvailable, semaphore, ticks)) {
+        return pdFALSE;
+    }
+    semaphore->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    if (semaphore->count >= semaphore->max_count) {
+        return pdFALSE;
+    }
+    semaphore->count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t* higher_priority_task_woken) {
+    if (higher_priority_task_woken != nullptr) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xSemaphoreGive(semaphore);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return new HostQueue{length, item_size, {}};
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    delete queue;
+}
+
+// Never waits for room, the test is the only task that could make some
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t) {
+    if (queue->items.size() >= queue->length) {
+        return pdFALSE;
+    }
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    if (!waitFor(queueNotEmpty, queue, ticks)) {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    return pdTRUE;
+}
@@ -0,0 +1,111 @@
+/**
+ * @file radio.cpp
+ * @brief Host implementation of the ESP-NOW and Wi-Fi stand-ins
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include <esp_now.h>
+#include <WiFi.h>
+#include <string.h>
+#include <vector>
+
+WiFiClass WiFi;
+
+namespace {
+struct DriverPeer {
+    uint8_t addr[ESP_NOW_ETH_ALEN];
+};
+std::vector<DriverPeer> driverPeers;
+uint32_t sentFrames = 0;
+uint8_t wifiChannel = 0;
+void (*channelHook)(uint8_t) = nullptr;
+
+int findDriverPeer(const uint8_t* addr) {
+    for (size_t i = 0; i < driverPeers.size(); ++i) {
+        if (memcmp(driverPeers[i].addr, addr, ESP_NOW_ETH_ALEN) == 0) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+}
+
+esp_err_t esp_wifi_set_channel(uint8_t primary, wifi_second_chan_t) {
+    wifiChannel = primary;
+    if (channelHook != nullptr) {
+        channelHook(primary);
+    }
+    return ESP_OK;
+}
+
+uint8_t hostWifiChannel() {
+    return wifiChannel;
+}
+
+void hostSetChannelHook(void (*hook)(uint8_t channel)) {
+    channelHook = hook;
+}
+
+esp_err_t esp_now_init() {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_recv_cb(esp_now_recv_cb_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_register_send_cb(esp_now_send_cb_t) {
+    return ESP_OK;
+}
+
+esp_err_t esp_now_send(const uint8_t* peer_addr, const uint8_t*, size_t len) {
+    if (len == 0 || len > ESP_NOW_MAX_DATA_LEN) {
+        return ESP_FAIL;
+    }
+    if (findDriverPeer(peer_addr) < 0) {
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+    }
+    sentFrames++;
+    return ESP_OK;
+}
+
+esp_err_t esp_now_add_peer(const esp_now_peer_info_t* peer) {
+    if (findDriverPeer(peer->peer_addr) >= 0) {
+        return ESP_ERR_ESPNOW_EXIST;
+    }
+    if (driverPeers.size() >= ESP_NOW_MAX_TOTAL_PEER_NUM) {
+        return ESP_ERR_ESPNOW_FULL;
+    }
+    DriverPeer entry;
+    memcpy(entry.addr, peer->peer_addr, ESP_NOW_ETH_ALEN);
+    driverPeers.push_back(entry);
+    return ESP_OK;
+}
+
+esp_err_t esp_now_del_peer(const uint8_t* peer_addr) {
+    int index = findDriverPeer(peer_addr);
+    if (index < 0) {
+        return ESP_ERR_ESPNOW_NOT_FOUND;
+    }
+    driverPeers.erase(driverPeers.begin() + index);
+    return ESP_OK;
+}
+
+bool esp_now_is_peer_exist(const uint8_t* peer_addr) {
+    return findDriverPeer(peer_addr) >= 0;
+}
+
+int hostDriverPeerCount() {
+    return static_cast<int>(driverPeers.size());
+}
+
+uint32_t hostSentFrames() {
+    return sentFrames;
+}
+
+void hostResetDriver() {
+    driverPeers.clear();
+    sentFrames = 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * @file test_beacon.cpp
+ * @brief Host simulation of the master channel discovery: sweep order, filtering and join latency
+ *
+ * A simulated master beacons every BEACON_PERIOD_MS on its channel, from a random phase, and the
+ * node hears it when its radio is on that channel, or sometimes on an adjacent one. Latencies are
+ * in simulated milliseconds, from the start of findMaster() to its return.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "Common/CommunicationsBase.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t SLACK_MS = 5;  // Host time that passes while the simulation runs
+
+struct SimulatedMaster {
+    CommunicationsBase* node;
+    uint8_t channel;
+    const uint8_t* mac_addr;
+    float adjacent_reception;  // Probability of hearing a beacon one channel away
+    std::mt19937* rng;
+};
+
+std::vector<uint8_t> visitedChannels;
+
+void recordChannel(uint8_t channel) {
+    visitedChannels.push_back(channel);
+}
+
+// Delivers one beacon if the node listens close enough, and schedules the next one
+void beacon(void* context) {
+    SimulatedMaster* master = static_cast<SimulatedMaster*>(context);
+    int distance = abs(static_cast<int>(hostWifiChannel()) - master->channel);
+    bool heard = distance == 0;
+    if (distance == 1 && master->adjacent_reception > 0.0f) {
+        heard = std::uniform_real_distribution<float>(0.0f, 1.0f)(*master->rng) < master->adjacent_reception;
+    }
+    if (heard) {
+        BeaconMsg msg;
+        msg.channel = master->channel;
+        master->node->beaconReceived(master->mac_addr, msg);
+    }
+    hostCallAt(millis() + BEACON_PERIOD_MS, beacon, master);
+}
+
+// Runs findMaster() against a master that started beaconing phase_ms from now, returns the latency
+uint32_t join(SimulatedMaster& master, uint8_t preferred_channel, uint32_t phase_ms, uint8_t& found) {
+    hostClearEvents();
+    visitedChannels.clear();
+    hostCallAt(millis() + phase_ms, beacon, &master);
+    uint32_t start = millis();
+    found = master.node->findMaster(preferred_channel);
+    uint32_t latency = millis() - start;
+    hostClearEvents();
+    return latency;
+}
+
+// A node whose cached channel is still right locks on within one beacon period
+void testCachedChannel(CommunicationsBase& node, std::mt19937& rng) {
+    SimulatedMaster master{&node, 6, master_mac_addr, 0.0f, &rng};
+    uint8_t found;
+    uint32_t latency = join(master, 6, 37, found);
+    CHECK(found == 6);
+    CHECK(latency <= 37 + SLACK_MS);
+    CHECK(visitedChannels.size() == 1 && visitedChannels[0] == 6);
+}
+
+// The sweep starts at the preferred channel, wraps around and reaches channel 13
+void testSweepOrder(CommunicationsBase& node, std::mt19937& rng) {
+    SimulatedMaster master{&node, 13, master_mac_addr, 0.0f, &rng};
+    uint8_t found;
+    uint32_t latency = join(master, 1, 0, found);
+    CHECK(found == 13);
+    CHECK(visitedChannels.size() == 13);
+    for (size_t i = 0; i < visitedChannels.size(); i++) {
+        CHECK(visitedChannels[i] == i + 1);
+    }
+    CHECK(latency <= 12 * BEACON_LISTEN_MS + BEACON_PERIOD_MS + SLACK_MS);
+
+    master.channel = 3;
+    join(master, 7, 0, found);
+    const uint8_t wrapped[] = {7, 8, 9, 10, 11, 12, 13, 1, 2, 3};
+    CHECK(found == 3);
+    CHECK(visitedChannels.size() == sizeof(wrapped) && std::equal(wrapped, wrapped + sizeof(wrapped), visitedChannels.begin()));
+
+    // Invalid preferred channels start at channel 1
+    join(master, 0, 0, found);
+    CHECK(found == 3 && visitedChannels.size() == 3 && visitedChannels[0] == 1);
+    join(master, MAX_WIFI_CHANNEL + 1, 0, found);
+    CHECK(found == 3 && visitedChannels.size() == 3 && visitedChannels[0] == 1);
+}
+
+// Without a master every channel is listened to once and findMaster() gives up
+void testNoMaster(CommunicationsBase& node) {
+    hostClearEvents();
+    visitedChannels.clear();
+    uint32_t start = millis();
+    CHECK(node.findMaster(5) == 0);
+    uint32_t elapsed = millis() - start;
+    CHECK(visitedChannels.size() == MAX_WIFI_CHANNEL);
+    CHECK(elapsed >= MAX_WIFI_CHANNEL * BEACON_LISTEN_MS && elapsed <= MAX_WIFI_CHANNEL * BEACON_LISTEN_MS + SLACK_MS);
+}
+
+// Beacons of other devices, invalid channels and beacons heard before the sweep are ignored
+void testIgnoredBeacons(CommunicationsBase& node, std::mt19937& rng) {
+    uint8_t other_mac[MAC_ADDRESS_LENGTH] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+    SimulatedMaster impostor{&node, 4, other_mac, 0.0f, &rng};
+    uint8_t found;
+    join(impostor, 4, 0, found);
+    CHECK(found == 0);
+
+    SimulatedMaster bad_channel{&node, 0, master_mac_addr, 0.0f, &rng};
+    join(bad_channel, 1, 0, found);
+    CHECK(found == 0);
+    bad_channel.channel = MAX_WIFI_CHANNEL + 1;
+    join(bad_channel, 13, 0, found);
+    CHECK(found == 0);
+
+    BeaconMsg stale;
+    stale.channel = 9;
+    node.beaconReceived(master_mac_addr, stale);
+    hostClearEvents();
+    CHECK(node.findMaster(9) == 0);
+}
+
+uint32_t percentile(std::vector<uint32_t>& latencies, float fraction) {
+    std::sort(latencies.begin(), latencies.end());
+    return latencies[static_cast<size_t>(fraction * (latencies.size() - 1))];
+}
+
+// Join latency over random master channels and beacon phases, with the cached channel right or stale
+void testLatencyDistribution(CommunicationsBase& node, std::mt19937& rng) {
+    std::uniform_int_distribution<int> channels(1, MAX_WIFI_CHANNEL);
+    std::uniform_int_distribution<uint32_t> phases(0, BEACON_PERIOD_MS - 1);
+    std::vector<uint32_t> cached;
+    std::vector<uint32_t> stale;
+    bool all_found = true;
+
+    for (int trial = 0; trial < 4000; trial++) {
+        SimulatedMaster master{&node, static_cast<uint8_t>(channels(rng)), master_mac_addr, 0.5f, &rng};
+        bool cache_valid = trial % 2 == 0;
+        uint8_t preferred = cache_valid ? master.channel : static_cast<uint8_t>(channels(rng));
+        uint8_t found;
+        uint32_t latency = join(master, preferred, phases(rng), found);
+        all_found = all_found && found == master.channel;
+        (cache_valid ? cached : stale).push_back(latency);
+    }
+    CHECK(all_found);
+
+    uint32_t cached_max = percentile(cached, 1.0f);
+    uint32_t stale_max = percentile(stale, 1.0f);
+    printf("  join latency, cached channel: p50 %u ms, p95 %u ms, max %u ms\n", (unsigned)percentile(cached, 0.5f),
+           (unsigned)percentile(cached, 0.95f), (unsigned)cached_max);
+    printf("  join latency, stale channel:  p50 %u ms, p95 %u ms, max %u ms\n", (unsigned)percentile(stale, 0.5f),
+           (unsigned)percentile(stale, 0.95f), (unsigned)stale_max);
+    CHECK(cached_max < BEACON_PERIOD_MS + SLACK_MS);
+    CHECK(stale_max <= (MAX_WIFI_CHANNEL - 1) * BEACON_LISTEN_MS + BEACON_PERIOD_MS + SLACK_MS);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(2026);
+    CommunicationsBase node;
+    hostSetChannelHook(recordChannel);
+
+    testCachedChannel(node, rng);
+    testSweepOrder(node, rng);
+    testNoMaster(node);
+    testIgnoredBeacons(node, rng);
+    testLatencyDistribution(node, rng);
+
+    hostSetChannelHook(nullptr);
+    return report("test_beacon");
+}
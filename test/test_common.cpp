@@ -0,0 +1,130 @@
+/**
+ * @file test_common.cpp
+ * @brief Host tests of the frame header and the fixed-point encoding of common.h
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "Common/common.h"
+
+namespace {
+
+// Every centi-degree and centi-percent value survives decode and encode unchanged
+void testFixedPointRoundTrip() {
+    for (int32_t centi = INT16_MIN; centi <= INT16_MAX; centi++) {
+        int16_t value = static_cast<int16_t>(centi);
+        if (encodeTemperature(decodeTemperature(value)) != value) {
+            CHECK(encodeTemperature(decodeTemperature(value)) == value);
+            break;
+        }
+    }
+    for (uint16_t centi = 0; centi <= 10000; centi++) {
+        if (encodeHumidity(decodeHumidity(centi)) != centi) {
+            CHECK(encodeHumidity(decodeHumidity(centi)) == centi);
+            break;
+        }
+    }
+}
+
+// Readings in the sensor range are stored to the nearest hundredth
+void testFixedPointResolution() {
+    for (float celsius = -40.0f; celsius <= 85.0f; celsius += 0.0037f) {
+        if (fabsf(decodeTemperature(encodeTemperature(celsius)) - celsius) > 0.005f + 1e-4f) {
+            CHECK(fabsf(decodeTemperature(encodeTemperature(celsius)) - celsius) <= 0.005f + 1e-4f);
+            break;
+        }
+    }
+    for (float percent = 0.0f; percent <= 100.0f; percent += 0.0031f) {
+        if (fabsf(decodeHumidity(encodeHumidity(percent)) - percent) > 0.005f + 1e-4f) {
+            CHECK(fabsf(decodeHumidity(encodeHumidity(percent)) - percent) <= 0.005f + 1e-4f);
+            break;
+        }
+    }
+    CHECK(encodeTemperature(-0.006f) == -1);
+    CHECK(encodeTemperature(-400.0f) == INT16_MIN);
+    CHECK(encodeTemperature(400.0f) == INT16_MAX);
+    CHECK(encodeHumidity(-0.1f) == 0);
+    CHECK(encodeHumidity(100.1f) == 10000);
+}
+
+// The header and fields of a frame sit at fixed little-endian offsets
+void testFrameLayout() {
+    TempHumidMsg msg;
+    msg.header.seq = 0x5A;
+    msg.room_id = 4;
+    msg.temperature = encodeTemperature(-12.34f);
+    msg.humidity = encodeHumidity(56.78f);
+
+    uint8_t wire[sizeof(msg)];
+    memcpy(wire, &msg, sizeof(msg));
+    CHECK(sizeof(wire) == 8);
+    CHECK(wire[0] == static_cast<uint8_t>(MessageType::TEMP_HUMID));
+    CHECK(wire[1] == PROTOCOL_VERSION);
+    CHECK(wire[2] == 0x5A);
+    CHECK(wire[3] == 4);
+    CHECK(static_cast<int16_t>(wire[4] | (wire[5] << 8)) == -1234);
+    CHECK((wire[6] | (wire[7] << 8)) == 5678);
+
+    TempHumidMsg received;
+    memcpy(&received, wire, sizeof(received));
+    CHECK(decodeTemperature(received.temperature) == -12.34f);
+    CHECK(decodeHumidity(received.humidity) == 56.78f);
+}
+
+// Receivers accept the versions between MIN_PROTOCOL_VERSION and PROTOCOL_VERSION, and only valid sizes
+void testFrameValidation() {
+    TempHumidMsg msg;
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(&msg);
+    CHECK(isValidFrame(data, sizeof(msg)));
+    CHECK(!isValidFrame(data, sizeof(msg) - 1));
+    CHECK(!isValidFrame(data, sizeof(msg) + 1));
+    CHECK(!isValidFrame(data, sizeof(MsgHeader) - 1));
+
+    msg.header.version = MIN_PROTOCOL_VERSION;
+    CHECK(isValidFrame(data, sizeof(msg)));
+    msg.header.version = MIN_PROTOCOL_VERSION - 1;
+    CHECK(!isValidFrame(data, sizeof(msg)));
+    msg.header.version = PROTOCOL_VERSION + 1;
+    CHECK(!isValidFrame(data, sizeof(msg)));
+
+    msg.header.version = PROTOCOL_VERSION;
+    msg.header.type = static_cast<MessageType>(TOTAL_FRAMES);
+    CHECK(!isValidFrame(data, sizeof(msg)));
+
+    // Variable-size frames are valid anywhere between their header and their full struct
+    AckMsg ack;
+    const uint8_t* ack_data = reinterpret_cast<const uint8_t*>(&ack);
+    CHECK(isValidFrame(ack_data, ACK_HEADER_SIZE));
+    CHECK(isValidFrame(ack_data, sizeof(ack)));
+    CHECK(!isValidFrame(ack_data, ACK_HEADER_SIZE - 1));
+
+    for (uint8_t type = 0; type < TOTAL_FRAMES; type++) {
+        CHECK(MESSAGE_SIZES[type].min <= MESSAGE_SIZES[type].max);
+        CHECK(MESSAGE_SIZES[type].max <= ESPNOW_MAX_PAYLOAD);
+    }
+}
+
+void benchmarkFixedPoint() {
+    double encode = nsPerCall(1000000, [](uint32_t i) {
+        float value = -40.0f + (i % 12500) * 0.01f;
+        benchmarkSink += encodeTemperature(value) + encodeHumidity(value + 40.0f);
+    });
+    double decode = nsPerCall(1000000, [](uint32_t i) {
+        benchmarkSink += static_cast<uint32_t>(decodeTemperature(static_cast<int16_t>(i)) + decodeHumidity(i));
+    });
+    CHECK_TIME("encode temperature + humidity", encode, 1000);
+    CHECK_TIME("decode temperature + humidity", decode, 1000);
+}
+
+} // namespace
+
+int main() {
+    testFixedPointRoundTrip();
+    testFixedPointResolution();
+    testFrameLayout();
+    testFrameValidation();
+    benchmarkFixedPoint();
+    return report("test_common");
+}
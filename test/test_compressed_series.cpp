@@ -0,0 +1,213 @@
+/**
+ * @file test_compressed_series.cpp
+ * @brief Host round-trip tests and benchmark of the CompressedSeries blocks
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "MasterDevice/CompressedSeries.h"
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t NUM_BLOCKS = 8;
+constexpr uint32_t START_TS = 1790000000;
+
+// A SensorNode reporting every period_s seconds: a few seconds of jitter, slow drift and sensor noise
+std::vector<SeriesPoint> makeTrace(uint32_t count, uint32_t period_s, std::mt19937& rng) {
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    std::uniform_int_distribution<int> noise(-3, 3);
+    std::vector<SeriesPoint> trace;
+    uint32_t timestamp = START_TS;
+    int32_t temperature = 2150;
+    int32_t humidity = 4500;
+    for (uint32_t i = 0; i < count; i++) {
+        timestamp += period_s + (rng() % 3 == 0 ? jitter(rng) : 0);
+        temperature += noise(rng);
+        humidity += 4 * noise(rng);
+        trace.push_back({timestamp, temperature, humidity});
+    }
+    return trace;
+}
+
+bool samePoint(const SeriesPoint& a, const SeriesPoint& b) {
+    return a.timestamp == b.timestamp && a.a == b.a && a.b == b.b;
+}
+
+// Decodes the whole series and compares it with the newest points of the trace
+bool matchesTail(const CompressedSeries& series, const std::vector<SeriesPoint>& trace) {
+    if (series.size() > trace.size()) {
+        return false;
+    }
+    size_t first = trace.size() - series.size();
+    SeriesCursor cursor;
+    series.begin(cursor);
+    SeriesPoint point;
+    size_t decoded = 0;
+    while (series.next(cursor, point)) {
+        if (first + decoded >= trace.size() || !samePoint(point, trace[first + decoded])) {
+            return false;
+        }
+        decoded++;
+    }
+    return decoded == series.size();
+}
+
+void testRoundTrip(std::mt19937& rng) {
+    const uint32_t periods[] = {60, 900, 3600};
+    for (uint32_t period_s : periods) {
+        static SeriesBlock blocks[NUM_BLOCKS];
+        CompressedSeries series;
+        series.init(blocks, NUM_BLOCKS);
+        std::vector<SeriesPoint> trace = makeTrace(5000, period_s, rng);
+        for (const SeriesPoint& point : trace) {
+            series.append(point);
+        }
+        CHECK(matchesTail(series, trace));
+
+        // The oldest blocks were dropped and every block but the head one is full
+        double bits = 8.0 * series.usedBytes() / series.size();
+        printf("  period %4u s: %u points kept, %.1f bits per point (%u raw)\n", (unsigned)period_s,
+               (unsigned)series.size(), bits, (unsigned)(8 * sizeof(SeriesPoint)));
+        CHECK(series.size() < trace.size());
+        CHECK(series.usedBytes() > (NUM_BLOCKS - 1) * SERIES_BLOCK_BYTES);
+        CHECK(bits <= SERIES_BITS_PER_POINT);
+    }
+}
+
+// Gaps, clock jumps and out of range values round-trip, starting new blocks when a delta does not fit
+void testExtremes() {
+    static SeriesBlock blocks[NUM_BLOCKS];
+    CompressedSeries series;
+    series.init(blocks, NUM_BLOCKS);
+    std::vector<SeriesPoint> trace = {
+        {START_TS, 2150, 4500},
+        {START_TS + 900, 2150, 4500},
+        {START_TS + 1800, 2150, 4500},
+        {START_TS + 30 * 24 * 3600, -4000, 0},
+        {0, INT32_MAX, INT32_MIN},
+        {UINT32_MAX, INT32_MIN, INT32_MAX},
+        {UINT32_MAX, 0, 10000},
+        {START_TS, 2151, 4499},
+    };
+    for (const SeriesPoint& point : trace) {
+        series.append(point);
+    }
+    CHECK(series.size() == trace.size());
+    CHECK(matchesTail(series, trace));
+}
+
+// Seek lands before the first point at or after the timestamp
+void testSeek(std::mt19937& rng) {
+    static SeriesBlock blocks[NUM_BLOCKS];
+    CompressedSeries series;
+    series.init(blocks, NUM_BLOCKS);
+    std::vector<SeriesPoint> trace = makeTrace(3000, 60, rng);
+    for (const SeriesPoint& point : trace) {
+        series.append(point);
+    }
+    size_t first = trace.size() - series.size();
+
+    const uint32_t queries[] = {0, trace[first].timestamp, trace[first + 500].timestamp + 1,
+                                trace[first + 1234].timestamp, trace.back().timestamp, trace.back().timestamp + 100};
+    for (uint32_t query : queries) {
+        SeriesCursor cursor;
+        series.seek(cursor, query);
+        SeriesPoint point;
+        bool found = false;
+        while (series.next(cursor, point)) {
+            if (point.timestamp >= query) {
+                found = true;
+                break;
+            }
+        }
+        const SeriesPoint* expected = nullptr;
+        for (size_t i = first; i < trace.size() && expected == nullptr; i++) {
+            if (trace[i].timestamp >= query) {
+                expected = &trace[i];
+            }
+        }
+        CHECK(found == (expected != nullptr));
+        CHECK(!found || samePoint(point, *expected));
+    }
+}
+
+// A cursor whose block is dropped while it reads continues from the oldest point
+void testDroppedCursor(std::mt19937& rng) {
+    static SeriesBlock blocks[NUM_BLOCKS];
+    CompressedSeries series;
+    series.init(blocks, NUM_BLOCKS);
+    std::vector<SeriesPoint> trace = makeTrace(4000, 900, rng);
+    size_t appended = 0;
+    while (series.tail == 0) {
+        series.append(trace[appended++]);
+    }
+
+    SeriesCursor cursor;
+    series.begin(cursor);
+    SeriesPoint point;
+    CHECK(series.next(cursor, point));
+    uint32_t tail = series.tail;
+    while (series.tail < tail + 2) {
+        series.append(trace[appended++]);
+    }
+    CHECK(series.next(cursor, point));
+    CHECK(samePoint(point, trace[appended - series.size()]));
+}
+
+// Without a buffer the series stays empty
+void testDisabled() {
+    CompressedSeries series;
+    series.init(nullptr, NUM_BLOCKS);
+    series.append({START_TS, 1, 2});
+    CHECK(series.size() == 0 && series.usedBytes() == 0);
+    SeriesCursor cursor;
+    series.begin(cursor);
+    SeriesPoint point;
+    CHECK(!series.next(cursor, point));
+    series.seek(cursor, START_TS);
+    CHECK(!series.next(cursor, point));
+}
+
+void benchmark(std::mt19937& rng) {
+    static SeriesBlock blocks[NUM_BLOCKS];
+    CompressedSeries series;
+    series.init(blocks, NUM_BLOCKS);
+    std::vector<SeriesPoint> trace = makeTrace(100000, 900, rng);
+
+    double append_ns = nsPerCall(trace.size(), [&](uint32_t i) {
+        series.append(trace[i]);
+    });
+    double decode_ns = nsPerCall(200, [&](uint32_t) {
+        SeriesCursor cursor;
+        series.begin(cursor);
+        SeriesPoint point;
+        while (series.next(cursor, point)) {
+            benchmarkSink += point.a;
+        }
+    }) / series.size();
+    double seek_ns = nsPerCall(200000, [&](uint32_t i) {
+        SeriesCursor cursor;
+        series.seek(cursor, trace[trace.size() - 1 - i % series.size()].timestamp);
+        benchmarkSink += cursor.block;
+    });
+    CHECK_TIME("append a point", append_ns, 2000);
+    CHECK_TIME("decode a point", decode_ns, 2000);
+    CHECK_TIME("seek", seek_ns, 5000);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(2026);
+    testRoundTrip(rng);
+    testExtremes();
+    testSeek(rng);
+    testDroppedCursor(rng);
+    testDisabled();
+    benchmark(rng);
+    return report("test_compressed_series");
+}
@@ -0,0 +1,149 @@
+/**
+ * @file test_dispatcher.cpp
+ * @brief Host tests and benchmark of the MessageDispatcher frame routing
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "Common/MessageDispatcher.h"
+
+namespace {
+
+// Records what each handler received
+struct Recorder {
+    uint32_t temp_humid;
+    uint32_t batch;
+    uint32_t ack;
+    int16_t last_temperature;
+    uint8_t last_count;
+    uint8_t last_acked_seq;
+    uint32_t last_len;
+
+    Recorder() : temp_humid(0), batch(0), ack(0), last_temperature(0), last_count(0), last_acked_seq(0), last_len(0) {}
+
+    void onTempHumid(const IncomingMsg& frame, const TempHumidMsg& msg) {
+        temp_humid++;
+        last_temperature = msg.temperature;
+        last_len = frame.len;
+    }
+    void onBatch(const IncomingMsg& frame, const TempHumidBatchMsg& msg) {
+        batch++;
+        last_count = msg.count;
+        last_len = frame.len;
+    }
+    void onAck(const IncomingMsg& frame, const AckMsg& msg) {
+        ack++;
+        last_acked_seq = msg.acked_seq;
+        last_len = frame.len;
+    }
+};
+
+template <typename Msg>
+IncomingMsg makeFrame(const Msg& msg, size_t len = sizeof(Msg)) {
+    IncomingMsg frame;
+    memset(&frame, 0, sizeof(frame));
+    memcpy(frame.data, &msg, len);
+    frame.len = len;
+    return frame;
+}
+
+void registerAll(MessageDispatcher<Recorder>& dispatcher) {
+    dispatcher.on<TempHumidMsg, &Recorder::onTempHumid>();
+    dispatcher.on<TempHumidBatchMsg, &Recorder::onBatch>();
+    dispatcher.on<AckMsg, &Recorder::onAck>();
+}
+
+// Valid frames reach the handler of their struct with their fields intact
+void testRouting() {
+    MessageDispatcher<Recorder> dispatcher;
+    registerAll(dispatcher);
+    Recorder recorder;
+
+    TempHumidMsg temp_humid;
+    temp_humid.temperature = -1234;
+    IncomingMsg frame = makeFrame(temp_humid);
+    CHECK(dispatcher.accept(frame));
+    dispatcher.dispatch(recorder, frame);
+    CHECK(recorder.temp_humid == 1 && recorder.last_temperature == -1234);
+
+    // Variable-size frames are accepted at any length their registry entry allows
+    TempHumidBatchMsg batch;
+    batch.count = 3;
+    frame = makeFrame(batch, batchMsgSize(3));
+    CHECK(dispatcher.accept(frame));
+    dispatcher.dispatch(recorder, frame);
+    CHECK(recorder.batch == 1 && recorder.last_count == 3 && recorder.last_len == batchMsgSize(3));
+
+    AckMsg ack;
+    ack.acked_seq = 77;
+    frame = makeFrame(ack, ACK_HEADER_SIZE);
+    CHECK(dispatcher.accept(frame));
+    dispatcher.dispatch(recorder, frame);
+    CHECK(recorder.ack == 1 && recorder.last_acked_seq == 77);
+
+    CHECK(dispatcher.getRejectedCount() == 0 && dispatcher.getUnhandledCount() == 0);
+}
+
+// Malformed frames are rejected before any cast, valid ones without a handler are only counted
+void testRejection() {
+    MessageDispatcher<Recorder> dispatcher;
+    registerAll(dispatcher);
+
+    TempHumidMsg temp_humid;
+    CHECK(!dispatcher.accept(makeFrame(temp_humid, sizeof(temp_humid) - 1)));
+
+    IncomingMsg frame = makeFrame(temp_humid);
+    frame.len = sizeof(temp_humid) + 1;
+    CHECK(!dispatcher.accept(frame));
+
+    frame = makeFrame(temp_humid);
+    frame.data[1] = PROTOCOL_VERSION + 1;
+    CHECK(!dispatcher.accept(frame));
+
+    frame.data[0] = TOTAL_FRAMES;
+    frame.data[1] = PROTOCOL_VERSION;
+    CHECK(!dispatcher.accept(frame));
+
+    frame.len = 0;
+    CHECK(!dispatcher.accept(frame));
+    CHECK(dispatcher.getRejectedCount() == 5);
+
+    HeartbeatMsg heartbeat;
+    CHECK(!dispatcher.accept(makeFrame(heartbeat)));
+    CHECK(dispatcher.getUnhandledCount() == 1);
+    CHECK(dispatcher.getRejectedCount() == 5);
+}
+
+void benchmark() {
+    MessageDispatcher<Recorder> dispatcher;
+    registerAll(dispatcher);
+    Recorder recorder;
+
+    TempHumidMsg temp_humid;
+    TempHumidBatchMsg batch;
+    batch.count = 10;
+    AckMsg ack;
+    IncomingMsg frames[] = {makeFrame(temp_humid), makeFrame(batch, batchMsgSize(10)),
+                            makeFrame(ack, ACK_HEADER_SIZE)};
+
+    double ns = nsPerCall(3000000, [&](uint32_t i) {
+        const IncomingMsg& frame = frames[i % 3];
+        if (dispatcher.accept(frame)) {
+            dispatcher.dispatch(recorder, frame);
+        }
+    });
+    benchmarkSink += recorder.temp_humid + recorder.batch + recorder.ack;
+    CHECK(recorder.temp_humid + recorder.batch + recorder.ack == 3000000);
+    CHECK_TIME("validate and dispatch a frame", ns, 500);
+}
+
+} // namespace
+
+int main() {
+    testRouting();
+    testRejection();
+    benchmark();
+    return report("test_dispatcher");
+}
@@ -0,0 +1,291 @@
+/**
+ * @file test_history_log.cpp
+ * @brief Host tests and benchmark of the HistoryLog segments: round trip, torn records, room keys, retention
+ *
+ * LittleFS is a temporary directory of the host, emptied before each test.
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "MasterDevice/HistoryLog.h"
+#include <dirent.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr uint8_t NUM_ROOMS = 3;
+constexpr uint32_t START_TS = 1790000000;
+constexpr uint32_t RECORDS_PER_SEGMENT = HISTORY_SEGMENT_BYTES / sizeof(HistoryRecord);
+
+std::string root;
+uint32_t keys[NUM_ROOMS];
+
+std::string logDir() {
+    return root + HISTORY_LOG_DIR;
+}
+
+std::vector<std::string> segmentFiles() {
+    std::vector<std::string> files;
+    DIR* dir = opendir(logDir().c_str());
+    struct dirent* entry;
+    while (dir != nullptr && (entry = readdir(dir)) != nullptr) {
+        if (entry->d_name[0] != '.') {
+            files.push_back(logDir() + "/" + entry->d_name);
+        }
+    }
+    if (dir != nullptr) {
+        closedir(dir);
+    }
+    return files;
+}
+
+void clearLog() {
+    for (const std::string& file : segmentFiles()) {
+        unlink(file.c_str());
+    }
+    rmdir(logDir().c_str());
+}
+
+// Samples of room i % NUM_ROOMS, one every step_s seconds, with values derived from i
+void appendSamples(HistoryLog& log, uint32_t first, uint32_t count, uint32_t start_ts, uint32_t step_s) {
+    for (uint32_t i = first; i < first + count; i++) {
+        uint8_t room = i % NUM_ROOMS;
+        log.append(room, keys[room], start_ts + i * step_s, encodeTemperature(20.0f + (i % 100) * 0.01f),
+                   encodeHumidity(40.0f + (i % 50) * 0.1f));
+        if ((i + 1) % HISTORY_LOG_BATCH == 0) {
+            log.flush();
+        }
+    }
+    log.flush(true);
+}
+
+bool matches(const HistoryRecord& record, uint32_t i, uint32_t start_ts, uint32_t step_s) {
+    return record.room_id == i % NUM_ROOMS && record.timestamp == start_ts + i * step_s &&
+           record.temperature == static_cast<int16_t>(2000 + i % 100) &&
+           record.humidity == static_cast<uint16_t>(4000 + (i % 50) * 10);
+}
+
+void collect(const HistoryRecord& record, void* context) {
+    static_cast<std::vector<HistoryRecord>*>(context)->push_back(record);
+}
+
+// Replays everything through a new HistoryLog, as after a reboot
+std::vector<HistoryRecord> replayAll(const uint32_t* room_keys = keys, uint8_t num_rooms = NUM_ROOMS) {
+    HistoryLog log;
+    log.begin();
+    uint32_t needed[NUM_ROOMS] = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+    std::vector<HistoryRecord> records;
+    uint32_t replayed = log.replay(needed, room_keys, num_rooms, collect, &records);
+    CHECK(replayed == records.size());
+    return records;
+}
+
+void testRoundTrip() {
+    clearLog();
+    HistoryLog log;
+    CHECK(log.begin());
+    appendSamples(log, 0, 100, START_TS, 60);
+
+    std::vector<HistoryRecord> records = replayAll();
+    CHECK(records.size() == 100);
+    for (uint32_t i = 0; i < records.size(); i++) {
+        if (!matches(records[i], i, START_TS, 60)) {
+            CHECK(matches(records[i], i, START_TS, 60));
+            break;
+        }
+    }
+}
+
+// Samples stay in RAM until a full batch or HISTORY_FLUSH_PERIOD_MS, and are dropped when the buffer is full
+void testFlushPolicy() {
+    clearLog();
+    HistoryLog log;
+    log.begin();
+    for (uint32_t i = 0; i < 5; i++) {
+        log.append(0, keys[0], START_TS + i, encodeTemperature(21.0f), encodeHumidity(50.0f));
+    }
+    log.flush();
+    CHECK(replayAll().empty());
+    hostAdvanceMillis(HISTORY_FLUSH_PERIOD_MS);
+    log.flush();
+    CHECK(replayAll().size() == 5);
+
+    for (uint32_t i = 0; i < HISTORY_LOG_BATCH; i++) {
+        log.append(1, keys[1], START_TS + 10 + i, encodeTemperature(21.0f), encodeHumidity(50.0f));
+    }
+    log.flush();
+    CHECK(replayAll().size() == 5 + HISTORY_LOG_BATCH);
+
+    for (uint32_t i = 0; i < HISTORY_LOG_BUFFER + 3; i++) {
+        log.append(2, keys[2], START_TS + 100 + i, encodeTemperature(21.0f), encodeHumidity(50.0f));
+    }
+    CHECK(log.getDropped() == 3);
+    log.flush(true);
+    CHECK(replayAll().size() == 5 + HISTORY_LOG_BATCH + HISTORY_LOG_BUFFER);
+}
+
+// A corrupted record is skipped, and a record torn at the end of a segment does not misalign later appends
+void testTornRecords() {
+    clearLog();
+    {
+        HistoryLog log;
+        log.begin();
+        appendSamples(log, 0, 50, START_TS, 60);
+    }
+    std::vector<std::string> files = segmentFiles();
+    CHECK(files.size() == 1);
+
+    FILE* segment = fopen(files[0].c_str(), "r+b");
+    fseek(segment, 10 * sizeof(HistoryRecord) + 5, SEEK_SET);
+    int byte = fgetc(segment);
+    fseek(segment, 10 * sizeof(HistoryRecord) + 5, SEEK_SET);
+    fputc(byte ^ 0xFF, segment);
+    fseek(segment, 0, SEEK_END);
+    const uint8_t torn[7] = {1, 2, 3, 4, 5, 6, 7};
+    fwrite(torn, 1, sizeof(torn), segment);
+    fclose(segment);
+
+    std::vector<HistoryRecord> records = replayAll();
+    CHECK(records.size() == 49);
+    CHECK(records.size() > 10 && matches(records[9], 9, START_TS, 60) && matches(records[10], 11, START_TS, 60));
+
+    HistoryLog log;
+    log.begin();
+    appendSamples(log, 50, 10, START_TS, 60);
+    CHECK(segmentFiles().size() == 2);
+    records = replayAll();
+    CHECK(records.size() == 59);
+    CHECK(!records.empty() && matches(records.back(), 59, START_TS, 60));
+}
+
+// Records only reach the room they were logged for
+void testRoomKeys() {
+    clearLog();
+    {
+        HistoryLog log;
+        log.begin();
+        appendSamples(log, 0, 30, START_TS, 60);
+    }
+    CHECK(replayAll().size() == 30);
+
+    uint32_t renamed[NUM_ROOMS] = {keys[0], HistoryLog::roomKey("Garaje"), keys[2]};
+    CHECK(renamed[1] != keys[1]);
+    std::vector<HistoryRecord> records = replayAll(renamed);
+    CHECK(records.size() == 20);
+    for (const HistoryRecord& record : records) {
+        CHECK(record.room_id != 1);
+    }
+
+    // Rooms removed from the end of rooms.json
+    records = replayAll(keys, 2);
+    CHECK(records.size() == 20);
+    for (const HistoryRecord& record : records) {
+        CHECK(record.room_id < 2);
+    }
+}
+
+// Replay starts from the newest segment that still gives every room what it needs
+void testNeeded() {
+    clearLog();
+    const uint32_t total = 3 * RECORDS_PER_SEGMENT + 100;
+    HistoryLog log;
+    log.begin();
+    appendSamples(log, 0, total, START_TS, 60);
+
+    uint32_t needed[NUM_ROOMS] = {10, 10, 10};
+    std::vector<HistoryRecord> records;
+    HistoryLog reader;
+    reader.begin();
+    reader.replay(needed, keys, NUM_ROOMS, collect, &records);
+    CHECK(records.size() >= 30 && records.size() <= RECORDS_PER_SEGMENT + 100);
+
+    // The replayed records are the newest ones, oldest first
+    uint32_t first = total - records.size();
+    for (uint32_t i = 0; i < records.size(); i++) {
+        if (!matches(records[i], first + i, START_TS, 60)) {
+            CHECK(matches(records[i], first + i, START_TS, 60));
+            break;
+        }
+    }
+}
+
+// Old segments are deleted beyond HISTORY_MAX_SEGMENTS and once their records expire
+void testRetention() {
+    clearLog();
+    HistoryLog log;
+    log.begin();
+    const uint32_t total = (HISTORY_MAX_SEGMENTS + 3) * RECORDS_PER_SEGMENT;
+    appendSamples(log, 0, total, START_TS, 60);
+    CHECK(segmentFiles().size() <= HISTORY_MAX_SEGMENTS);
+
+    std::vector<HistoryRecord> records = replayAll();
+    CHECK(records.size() >= (HISTORY_MAX_SEGMENTS - 1) * RECORDS_PER_SEGMENT);
+    CHECK(!records.empty() && matches(records.back(), total - 1, START_TS, 60));
+    bool ordered = true;
+    for (size_t i = 1; i < records.size(); i++) {
+        ordered = ordered && records[i].timestamp > records[i - 1].timestamp;
+    }
+    CHECK(ordered);
+
+    // Samples from beyond the retention period later, which expire everything logged so far
+    uint32_t later = START_TS + HISTORY_RETENTION_S + total * 60;
+    appendSamples(log, 0, 2 * RECORDS_PER_SEGMENT, later, 60);
+    records = replayAll();
+    CHECK(!records.empty() && records.front().timestamp >= later);
+    CHECK(records.size() == 2 * RECORDS_PER_SEGMENT);
+}
+
+void benchmark() {
+    clearLog();
+    HistoryLog log;
+    log.begin();
+    const uint32_t count = 4 * RECORDS_PER_SEGMENT;
+    double append_ns = nsPerCall(1, [&](uint32_t) {
+        appendSamples(log, 0, count, START_TS, 60);
+    }) / count;
+
+    HistoryLog reader;
+    reader.begin();
+    uint32_t needed[NUM_ROOMS] = {UINT32_MAX, UINT32_MAX, UINT32_MAX};
+    uint32_t replayed = 0;
+    double replay_ns = nsPerCall(1, [&](uint32_t) {
+        replayed = reader.replay(needed, keys, NUM_ROOMS, [](const HistoryRecord& record, void*) {
+            benchmarkSink += record.timestamp;
+        }, nullptr);
+    }) / count;
+    CHECK(replayed == count);
+    CHECK_TIME("append and flush a record (host file)", append_ns, 20000);
+    CHECK_TIME("replay a record (host file)", replay_ns, 20000);
+}
+
+} // namespace
+
+int main() {
+    char dir[] = "/tmp/history_log_XXXXXX";
+    if (mkdtemp(dir) == nullptr) {
+        printf("cannot create a temporary directory\n");
+        return 1;
+    }
+    root = dir;
+    LittleFS.setRoot(root);
+    const char* names[NUM_ROOMS] = {"Dormitorio Luis", "Cocina", "Salón"};
+    for (uint8_t i = 0; i < NUM_ROOMS; i++) {
+        keys[i] = HistoryLog::roomKey(names[i]);
+    }
+
+    testRoundTrip();
+    testFlushPolicy();
+    testTornRecords();
+    testRoomKeys();
+    testNeeded();
+    testRetention();
+    benchmark();
+
+    clearLog();
+    rmdir(root.c_str());
+    return report("test_history_log");
+}
@@ -0,0 +1,185 @@
+/**
+ * @file test_json_writer.cpp
+ * @brief Host tests and benchmark of JsonWriter: output, escaping, measuring and overflow
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "MasterDevice/JsonWriter.h"
+#include <float.h>
+#include <limits.h>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+typedef void (*Document)(JsonWriter& writer);
+
+// Measures a document, writes it into a buffer of the measured size and returns it
+std::string render(Document document, bool* failed = nullptr) {
+    JsonWriter measure(nullptr, 0);
+    document(measure);
+    std::vector<char> buffer(measure.length() + 1, '#');
+    JsonWriter writer(buffer.data(), measure.length());
+    document(writer);
+    CHECK(writer.length() == measure.length());
+    CHECK(buffer[measure.length()] == '#');
+    if (failed != nullptr) {
+        *failed = writer.failed();
+    }
+    return std::string(buffer.data(), writer.length());
+}
+
+void roomDocument(JsonWriter& writer) {
+    writer.beginObject();
+    writer.key("type");
+    writer.string("rooms");
+    writer.key("rooms");
+    writer.beginArray();
+    for (int room = 0; room < 2; room++) {
+        writer.beginObject();
+        writer.key("id");
+        writer.number(room);
+        writer.key("temperature");
+        writer.decimal(21.456f + room);
+        writer.key("lights");
+        writer.boolean(room == 1);
+        writer.key("history");
+        writer.beginArray();
+        writer.endArray();
+        writer.endObject();
+    }
+    writer.endArray();
+    writer.endObject();
+}
+
+void escapeDocument(JsonWriter& writer) {
+    writer.beginObject();
+    writer.key("na\"me");
+    writer.string("Sal\xc3\xb3n \"A\\B\"\n\r\t\x01\x1f");
+    writer.endObject();
+}
+
+void numberDocument(JsonWriter& writer) {
+    writer.beginArray();
+    writer.number(0);
+    writer.number(-1);
+    writer.number(LONG_MAX);
+    writer.number(LONG_MIN);
+    writer.decimal(-40.0f);
+    writer.decimal(0.126f);
+    writer.decimal(NAN);
+    writer.decimal(INFINITY);
+    writer.decimal(-INFINITY);
+    writer.decimal(1e30f);
+    writer.decimal(-FLT_MAX);
+    writer.endArray();
+}
+
+void testOutput() {
+    bool failed;
+    CHECK(render(roomDocument, &failed) ==
+          "{\"type\":\"rooms\",\"rooms\":[{\"id\":0,\"temperature\":21.46,\"lights\":false,\"history\":[]},"
+          "{\"id\":1,\"temperature\":22.46,\"lights\":true,\"history\":[]}]}");
+    CHECK(!failed);
+
+    // Control characters are escaped, UTF-8 goes through unchanged
+    CHECK(render(escapeDocument, &failed) ==
+          "{\"na\\\"me\":\"Sal\xc3\xb3n \\\"A\\\\B\\\"\\n\\r\\t\\u0001\\u001f\"}");
+    CHECK(!failed);
+
+    // NaN and infinity are not JSON numbers, the widest values are written whole
+    char large[96];
+    snprintf(large, sizeof(large), "%.2f,%.2f", 1e30f, -FLT_MAX);
+    CHECK(render(numberDocument, &failed) == "[0,-1," + std::to_string(LONG_MAX) + "," + std::to_string(LONG_MIN) +
+                                                 ",-40.00,0.13,null,null,null," + large + "]");
+    CHECK(!failed);
+}
+
+// Every buffer shorter than the document fails without writing past its end
+void testOverflow() {
+    JsonWriter measure(nullptr, 0);
+    roomDocument(measure);
+    CHECK(!measure.failed());
+    for (size_t capacity = 0; capacity < measure.length(); capacity++) {
+        std::vector<char> buffer(capacity + 1, '#');
+        JsonWriter writer(buffer.data(), capacity);
+        roomDocument(writer);
+        if (!writer.failed() || buffer[capacity] != '#') {
+            CHECK(writer.failed() && buffer[capacity] == '#');
+            break;
+        }
+    }
+}
+
+// Nesting deeper than the writer tracks fails instead of writing misplaced commas
+void testDepth() {
+    char buffer[64];
+    JsonWriter shallow(buffer, sizeof(buffer));
+    for (int i = 0; i < 7; i++) {
+        shallow.beginArray();
+    }
+    for (int i = 0; i < 7; i++) {
+        shallow.endArray();
+    }
+    CHECK(!shallow.failed());
+
+    JsonWriter deep(buffer, sizeof(buffer));
+    for (int i = 0; i < 8; i++) {
+        deep.beginArray();
+    }
+    CHECK(deep.failed());
+}
+
+uint32_t documentSeed;
+
+// Twenty members of random types, the same ones for a given documentSeed
+void randomDocument(JsonWriter& writer) {
+    std::mt19937 rng(documentSeed);
+    writer.beginObject();
+    for (int i = 0; i < 20; i++) {
+        writer.key("k");
+        switch (rng() % 4) {
+            case 0: writer.number(static_cast<long>(rng()) - INT32_MAX); break;
+            case 1: writer.decimal(static_cast<float>(rng() % 20000) / 100.0f - 50.0f); break;
+            case 2: writer.boolean(rng() % 2 == 0); break;
+            default: writer.string(rng() % 2 == 0 ? "plain" : "quo\"te\n"); break;
+        }
+    }
+    writer.endObject();
+}
+
+// Random documents are written exactly as measured
+void testMeasureMatchesWrite() {
+    for (documentSeed = 0; documentSeed < 100; documentSeed++) {
+        bool failed;
+        std::string json = render(randomDocument, &failed);
+        CHECK(!failed && json.front() == '{' && json.back() == '}');
+    }
+}
+
+void benchmark() {
+    std::vector<char> buffer(4096);
+    double ns = nsPerCall(200000, [&](uint32_t) {
+        JsonWriter measure(nullptr, 0);
+        roomDocument(measure);
+        JsonWriter writer(buffer.data(), measure.length());
+        roomDocument(writer);
+        benchmarkSink += writer.length();
+    });
+    CHECK_TIME("measure and write a rooms message", ns, 20000);
+}
+
+} // namespace
+
+int main() {
+    testOutput();
+    testOverflow();
+    testDepth();
+    testMeasureMatchesWrite();
+    benchmark();
+    return report("test_json_writer");
+}
@@ -0,0 +1,188 @@
+/**
+ * @file test_peer_index.cpp
+ * @brief Host tests and benchmark of the MAC-indexed peer table and the LRU peers of the ESP-NOW driver
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "Common/CommunicationsBase.h"
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+// Exposes the lookup the transport uses on every frame
+class PeerTable : public CommunicationsBase {
+public:
+    Peer* find(const uint8_t* mac_addr) {
+        return findPeer(mac_addr);
+    }
+};
+
+typedef std::vector<uint8_t> Mac;
+
+Mac makeMac(uint32_t id) {
+    return {0x24, 0x6F, static_cast<uint8_t>(id >> 24), static_cast<uint8_t>(id >> 16),
+            static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id)};
+}
+
+bool registerMac(PeerTable& table, Mac mac) {
+    return table.registerPeer(mac.data(), 1);
+}
+
+bool unregisterMac(PeerTable& table, Mac mac) {
+    return table.unregisterPeer(mac.data());
+}
+
+bool found(PeerTable& table, const Mac& mac) {
+    Peer* peer = table.find(mac.data());
+    return peer != nullptr && memcmp(peer->mac_addr, mac.data(), MAC_ADDRESS_LENGTH) == 0;
+}
+
+bool sendTo(PeerTable& table, Mac mac) {
+    HeartbeatMsg msg;
+    return table.sendMsg(mac.data(), reinterpret_cast<uint8_t*>(&msg), sizeof(msg));
+}
+
+// More peers than the driver holds can be registered, and every one of them is found
+void testRegistration() {
+    hostResetDriver();
+    PeerTable table;
+    std::vector<Mac> macs;
+    for (uint32_t i = 0; i < MAX_PEERS; i++) {
+        macs.push_back(makeMac(i));
+        CHECK(registerMac(table, macs.back()));
+    }
+    CHECK(MAX_PEERS > MAX_DRIVER_PEERS);
+    CHECK(hostDriverPeerCount() == MAX_DRIVER_PEERS);
+    CHECK(!registerMac(table, makeMac(MAX_PEERS)));
+    CHECK(!registerMac(table, macs[3]));
+
+    for (const Mac& mac : macs) {
+        CHECK(found(table, mac));
+    }
+    CHECK(table.find(makeMac(MAX_PEERS).data()) == nullptr);
+
+    // Removing peers keeps the others reachable and their slots stable
+    Peer* kept = table.find(macs[1].data());
+    for (uint32_t i = 0; i < MAX_PEERS; i += 3) {
+        CHECK(unregisterMac(table, macs[i]));
+    }
+    CHECK(table.find(macs[1].data()) == kept);
+    for (uint32_t i = 0; i < MAX_PEERS; i++) {
+        CHECK(found(table, macs[i]) == (i % 3 != 0));
+    }
+    CHECK(!unregisterMac(table, macs[0]));
+    CHECK(hostDriverPeerCount() <= MAX_DRIVER_PEERS);
+}
+
+// Random registrations and removals agree with a reference set, so deletion leaves no broken probe runs
+void testChurn(std::mt19937& rng) {
+    hostResetDriver();
+    PeerTable table;
+    std::set<Mac> registered;
+    std::uniform_int_distribution<uint32_t> ids(0, 3 * MAX_PEERS);
+    bool consistent = true;
+
+    for (int op = 0; op < 20000; op++) {
+        Mac mac = makeMac(ids(rng));
+        if (registered.count(mac)) {
+            consistent = consistent && unregisterMac(table, mac);
+            registered.erase(mac);
+        } else if (registered.size() < MAX_PEERS) {
+            consistent = consistent && registerMac(table, mac);
+            registered.insert(mac);
+        }
+        Mac probe = makeMac(ids(rng));
+        consistent = consistent && found(table, probe) == (registered.count(probe) == 1);
+    }
+    CHECK(consistent);
+    for (const Mac& mac : registered) {
+        CHECK(found(table, mac));
+    }
+    CHECK(hostDriverPeerCount() <= MAX_DRIVER_PEERS);
+}
+
+// Sending to a peer evicted from the driver brings it back in place of the least recently used one
+void testDriverEviction() {
+    hostResetDriver();
+    PeerTable table;
+    std::vector<Mac> macs;
+    for (uint32_t i = 0; i < MAX_PEERS; i++) {
+        macs.push_back(makeMac(i));
+        registerMac(table, macs.back());
+    }
+
+    // Registration order is also the LRU order, so the last MAX_DRIVER_PEERS peers are in the driver
+    CHECK(!esp_now_is_peer_exist(macs[0].data()));
+    CHECK(esp_now_is_peer_exist(macs[MAX_PEERS - 1].data()));
+
+    uint32_t sent = hostSentFrames();
+    CHECK(sendTo(table, macs[0]));
+    CHECK(hostSentFrames() == sent + 1);
+    CHECK(esp_now_is_peer_exist(macs[0].data()));
+    CHECK(!esp_now_is_peer_exist(macs[MAX_PEERS - MAX_DRIVER_PEERS].data()));
+    CHECK(hostDriverPeerCount() == MAX_DRIVER_PEERS);
+
+    // A recently used peer survives the next evictions
+    CHECK(sendTo(table, macs[MAX_PEERS - MAX_DRIVER_PEERS + 1]));
+    CHECK(sendTo(table, macs[1]));
+    CHECK(esp_now_is_peer_exist(macs[MAX_PEERS - MAX_DRIVER_PEERS + 1].data()));
+    CHECK(!esp_now_is_peer_exist(macs[MAX_PEERS - MAX_DRIVER_PEERS + 2].data()));
+
+    // Every registered peer can be reached, the broadcast address keeps its reserved entry
+    bool all_sent = true;
+    for (const Mac& mac : macs) {
+        all_sent = sendTo(table, mac) && all_sent;
+    }
+    CHECK(all_sent);
+    HeartbeatMsg msg;
+    CHECK(table.sendBroadcast(reinterpret_cast<uint8_t*>(&msg), sizeof(msg)));
+    CHECK(hostDriverPeerCount() == ESP_NOW_MAX_TOTAL_PEER_NUM);
+    CHECK(sendTo(table, macs[0]) && sendTo(table, macs[MAX_PEERS / 2]));
+}
+
+void benchmark() {
+    hostResetDriver();
+    PeerTable table;
+    std::vector<Mac> macs;
+    for (uint32_t i = 0; i < MAX_PEERS; i++) {
+        macs.push_back(makeMac(i * 7919));
+        registerMac(table, macs.back());
+    }
+    std::vector<Mac> unknown;
+    for (uint32_t i = 0; i < MAX_PEERS; i++) {
+        unknown.push_back(makeMac(i * 7919 + 1));
+    }
+
+    double hit_ns = nsPerCall(2000000, [&](uint32_t i) {
+        benchmarkSink += table.find(macs[i % MAX_PEERS].data())->tx_seq;
+    });
+    double miss_ns = nsPerCall(2000000, [&](uint32_t i) {
+        benchmarkSink += table.find(unknown[i % MAX_PEERS].data()) == nullptr;
+    });
+
+    // Round robin over every peer, so each send past the driver limit evicts one
+    double send_ns = nsPerCall(200000, [&](uint32_t i) {
+        benchmarkSink += sendTo(table, macs[i % MAX_PEERS]);
+    });
+
+    printf("  %u peers registered, %u in the driver\n", (unsigned)MAX_PEERS, (unsigned)MAX_DRIVER_PEERS);
+    CHECK_TIME("find a registered peer", hit_ns, 500);
+    CHECK_TIME("find an unknown peer", miss_ns, 500);
+    CHECK_TIME("send with a driver eviction", send_ns, 5000);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(2026);
+    testRegistration();
+    testChurn(rng);
+    testDriverEviction();
+    benchmark();
+    return report("test_peer_index");
+}
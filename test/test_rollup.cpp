@@ -0,0 +1,82 @@
+/**
+ * @file test_rollup.cpp
+ * @brief Host tests and benchmark of the min/max/avg rollup buckets and their local time alignment
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "MasterDevice/Rollup.h"
+
+namespace {
+
+constexpr uint32_t DAY_S = 24 * 3600;
+constexpr time_t UTC_MIDNIGHT = 20717 * static_cast<time_t>(DAY_S);
+constexpr int32_t UTC_OFFSET_S = 3600;  // The zone of the master, UTC+1
+
+const RollupBucket& newest(const RollupSeries& series) {
+    return series.buckets[(series.appended - 1) % series.capacity];
+}
+
+// Daily buckets run from local midnight, an hour before UTC midnight
+void testLocalDays() {
+    static RollupBucket buckets[4];
+    RollupSeries series;
+    series.init(buckets, 4, DAY_S, UTC_OFFSET_S);
+    series.add(UTC_MIDNIGHT - 3600 - 1, 20.0f, 40.0f);
+    CHECK(series.size() == 1 && newest(series).start == UTC_MIDNIGHT - DAY_S - 3600);
+    series.add(UTC_MIDNIGHT - 3600, 21.0f, 41.0f);
+    series.add(UTC_MIDNIGHT + 1800, 23.0f, 45.0f);
+    series.add(UTC_MIDNIGHT + DAY_S - 3600 - 1, 22.0f, 43.0f);
+    CHECK(series.size() == 2);
+    const RollupBucket& day = newest(series);
+    CHECK(day.start == UTC_MIDNIGHT - 3600 && day.count == 3);
+    CHECK(day.min_temperature == 21.0f && day.max_temperature == 23.0f && day.avgTemperature() == 22.0f);
+    CHECK(day.min_humidity == 41.0f && day.max_humidity == 45.0f && day.avgHumidity() == 43.0f);
+
+    // Without an offset the days are UTC days
+    RollupSeries utc;
+    utc.init(buckets, 4, DAY_S);
+    utc.add(UTC_MIDNIGHT + 1800, 23.0f, 45.0f);
+    CHECK(newest(utc).start == UTC_MIDNIGHT);
+}
+
+// Samples older than the newest bucket are dropped, the oldest buckets are overwritten
+void testRing() {
+    static RollupBucket buckets[3];
+    RollupSeries series;
+    series.init(buckets, 3, 3600, UTC_OFFSET_S);
+    for (uint32_t hour = 0; hour < 5; hour++) {
+        series.add(UTC_MIDNIGHT + hour * 3600 + 10, static_cast<float>(hour), 50.0f);
+    }
+    series.add(UTC_MIDNIGHT + 3600, -10.0f, 50.0f);
+    CHECK(series.size() == 3 && series.appended == 5);
+    CHECK(newest(series).start == UTC_MIDNIGHT + 4 * 3600 && newest(series).count == 1);
+    CHECK(buckets[(series.appended - 3) % 3].start == UTC_MIDNIGHT + 2 * 3600);
+
+    RollupSeries disabled;
+    disabled.init(nullptr, 3, 3600, UTC_OFFSET_S);
+    disabled.add(UTC_MIDNIGHT, 1.0f, 2.0f);
+    CHECK(disabled.size() == 0);
+}
+
+void benchmark() {
+    static RollupBucket buckets[64];
+    RollupSeries series;
+    series.init(buckets, 64, 3600, UTC_OFFSET_S);
+    double ns = nsPerCall(2000000, [&](uint32_t i) {
+        series.add(UTC_MIDNIGHT + i * 60, 20.0f + (i % 7), 40.0f + (i % 5));
+    });
+    benchmarkSink += series.appended;
+    CHECK_TIME("add a sample", ns, 200);
+}
+
+} // namespace
+
+int main() {
+    testLocalDays();
+    testRing();
+    benchmark();
+    return report("test_rollup");
+}
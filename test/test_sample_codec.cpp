@@ -0,0 +1,165 @@
+/**
+ * @file test_sample_codec.cpp
+ * @brief Host round-trip tests and benchmark of the SampleCodec batch encoding
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "Common/SampleCodec.h"
+#include <random>
+
+namespace {
+
+constexpr uint8_t TRACE_LENGTH = 96;    // Readings a SensorNode buffers in RTC memory
+
+// Readings of an SHT31 every sleep_s seconds, oldest first: a slow drift with sensor noise and a few
+// seconds of wake-up jitter. Ages are relative to the last reading, as in a TempHumidPackedMsg
+void makeTrace(SampleRecord* trace, uint8_t count, uint32_t sleep_s, std::mt19937& rng) {
+    std::normal_distribution<float> noise(0.0f, 0.03f);
+    std::uniform_int_distribution<int> jitter(-2, 2);
+    float temperature = 21.0f;
+    float humidity = 48.0f;
+    uint32_t age = 0;
+    for (int i = count - 1; i >= 0; i--) {
+        temperature += 0.01f + noise(rng);
+        humidity += noise(rng) * 2;
+        trace[i].age_s = age;
+        trace[i].temperature = encodeTemperature(temperature);
+        trace[i].humidity = encodeHumidity(humidity);
+        age += sleep_s + jitter(rng);
+    }
+}
+
+size_t encode(const SampleRecord* trace, uint8_t count, uint8_t* buffer, size_t capacity, uint8_t& encoded) {
+    SampleEncoder encoder(buffer, capacity);
+    for (uint8_t i = 0; i < count && encoder.add(trace[i]); i++) {
+    }
+    encoded = encoder.count();
+    return encoder.size();
+}
+
+bool sameSample(const SampleRecord& a, const SampleRecord& b) {
+    return a.age_s == b.age_s && a.temperature == b.temperature && a.humidity == b.humidity;
+}
+
+void testRoundTrip(std::mt19937& rng) {
+    const uint32_t sleep_periods[] = {300, 900, 3600, 6 * 3600};
+    for (uint32_t sleep_s : sleep_periods) {
+        SampleRecord trace[TRACE_LENGTH];
+        makeTrace(trace, TRACE_LENGTH, sleep_s, rng);
+
+        uint8_t buffer[TRACE_LENGTH * MAX_ENCODED_SAMPLE_SIZE];
+        uint8_t encoded;
+        size_t size = encode(trace, TRACE_LENGTH, buffer, sizeof(buffer), encoded);
+        CHECK(encoded == TRACE_LENGTH);
+        CHECK(SampleDecoder::validate(buffer, size, encoded));
+
+        SampleDecoder decoder(buffer, size, encoded);
+        SampleRecord sample;
+        for (uint8_t i = 0; i < encoded; i++) {
+            CHECK(decoder.next(sample) && sameSample(sample, trace[i]));
+        }
+        CHECK(!decoder.next(sample));
+        CHECK(decoder.finished());
+
+        printf("  sleep %5u s: %.2f bytes per reading (%u raw)\n", (unsigned)sleep_s,
+               static_cast<double>(size) / encoded, (unsigned)sizeof(SampleRecord));
+        CHECK(size <= 4u * encoded);
+    }
+}
+
+// Extreme steps still round-trip, they only cost longer varints
+void testExtremes() {
+    SampleRecord trace[] = {
+        {UINT32_MAX, INT16_MIN, 0},
+        {0, INT16_MAX, 10000},
+        {UINT32_MAX / 2, INT16_MIN, 0},
+        {UINT32_MAX / 2, 0, 5000},
+    };
+    const uint8_t count = sizeof(trace) / sizeof(trace[0]);
+    uint8_t buffer[count * MAX_ENCODED_SAMPLE_SIZE];
+    uint8_t encoded;
+    size_t size = encode(trace, count, buffer, sizeof(buffer), encoded);
+    CHECK(encoded == count);
+
+    SampleDecoder decoder(buffer, size, encoded);
+    SampleRecord sample;
+    for (uint8_t i = 0; i < count; i++) {
+        CHECK(decoder.next(sample) && sameSample(sample, trace[i]));
+    }
+    CHECK(decoder.finished());
+}
+
+// The encoder stops at the capacity, leaving the bytes after it untouched, and what it wrote decodes
+void testCapacity(std::mt19937& rng) {
+    SampleRecord trace[TRACE_LENGTH];
+    makeTrace(trace, TRACE_LENGTH, 900, rng);
+
+    for (size_t capacity = 0; capacity <= MAX_PACKED_PAYLOAD; capacity += 7) {
+        uint8_t buffer[MAX_PACKED_PAYLOAD + 1];
+        memset(buffer, 0xEE, sizeof(buffer));
+        uint8_t encoded;
+        size_t size = encode(trace, TRACE_LENGTH, buffer, capacity, encoded);
+        CHECK(size <= capacity);
+        CHECK(buffer[capacity] == 0xEE);
+        CHECK(SampleDecoder::validate(buffer, size, encoded));
+    }
+}
+
+// Truncated, padded or miscounted payloads are rejected
+void testMalformed(std::mt19937& rng) {
+    SampleRecord trace[16];
+    makeTrace(trace, 16, 900, rng);
+    uint8_t buffer[16 * MAX_ENCODED_SAMPLE_SIZE + 1];
+    uint8_t encoded;
+    size_t size = encode(trace, 16, buffer, sizeof(buffer) - 1, encoded);
+
+    CHECK(!SampleDecoder::validate(buffer, size - 1, encoded));
+    buffer[size] = 0;
+    CHECK(!SampleDecoder::validate(buffer, size + 1, encoded));
+    CHECK(!SampleDecoder::validate(buffer, size, encoded + 1));
+    CHECK(!SampleDecoder::validate(buffer, size, encoded - 1));
+
+    // A varint that never ends
+    uint8_t endless[8];
+    memset(endless, 0xFF, sizeof(endless));
+    CHECK(!SampleDecoder::validate(endless, sizeof(endless), 1));
+}
+
+void benchmark(std::mt19937& rng) {
+    SampleRecord trace[TRACE_LENGTH];
+    makeTrace(trace, TRACE_LENGTH, 900, rng);
+    uint8_t buffer[TRACE_LENGTH * MAX_ENCODED_SAMPLE_SIZE];
+    uint8_t encoded;
+    size_t size = encode(trace, TRACE_LENGTH, buffer, sizeof(buffer), encoded);
+
+    const uint32_t rounds = 20000;
+    double encode_ns = nsPerCall(rounds, [&](uint32_t) {
+        uint8_t out[TRACE_LENGTH * MAX_ENCODED_SAMPLE_SIZE];
+        uint8_t count;
+        benchmarkSink += encode(trace, TRACE_LENGTH, out, sizeof(out), count);
+    }) / TRACE_LENGTH;
+    double decode_ns = nsPerCall(rounds, [&](uint32_t) {
+        SampleDecoder decoder(buffer, size, encoded);
+        SampleRecord sample;
+        while (decoder.next(sample)) {
+            benchmarkSink += sample.temperature;
+        }
+    }) / TRACE_LENGTH;
+    CHECK_TIME("encode per reading", encode_ns, 2000);
+    CHECK_TIME("decode per reading", decode_ns, 2000);
+}
+
+} // namespace
+
+int main() {
+    std::mt19937 rng(2026);
+    testRoundTrip(rng);
+    testExtremes();
+    testCapacity(rng);
+    testMalformed(rng);
+    benchmark(rng);
+    return report("test_sample_codec");
+}
@@ -0,0 +1,128 @@
+/**
+ * @file test_seqlock.cpp
+ * @brief Host tests and benchmark of SeqLock with a writer and readers on separate threads
+ *
+ * @author Luis Moreno
+ * @date Oct 16, 2026
+ */
+
+#include "harness.h"
+#include "MasterDevice/SeqLock.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int STATE_WORDS = 10;  // About the size of a SensorState
+
+// Every word holds the same value, so a torn copy shows as words that differ
+struct State {
+    uint32_t words[STATE_WORDS];
+};
+
+State makeState(uint32_t value) {
+    State state;
+    for (uint32_t& word : state.words) {
+        word = value;
+    }
+    return state;
+}
+
+bool consistent(const State& state) {
+    for (uint32_t word : state.words) {
+        if (word != state.words[0]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A reader on the same thread sees each value as soon as it is written
+void testSingleThread() {
+    SeqLock<State> lock;
+    CHECK(lock.read().words[0] == 0 && consistent(lock.read()));
+    for (uint32_t value = 1; value <= 1000; value++) {
+        lock.write(makeState(value));
+        State state = lock.read();
+        if (state.words[0] != value || !consistent(state)) {
+            CHECK(state.words[0] == value && consistent(state));
+            break;
+        }
+    }
+}
+
+// Readers racing a writer never see a torn copy, and never see the value go back
+void testConcurrent() {
+    const int num_readers = 3;
+    const uint64_t min_reads = 300000;  // The writer keeps going until the readers have raced it this often
+    SeqLock<State> lock;
+    std::atomic<bool> done(false);
+    std::atomic<int> started(0);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> backwards(0);
+    std::atomic<uint64_t> reads(0);
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < num_readers; r++) {
+        readers.emplace_back([&]() {
+            uint32_t last = 0;
+            started++;
+            while (!done.load(std::memory_order_relaxed)) {
+                State state = lock.read();
+                if (!consistent(state)) {
+                    torn++;
+                }
+                if (state.words[0] < last) {
+                    backwards++;
+                }
+                last = state.words[0];
+                reads.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    while (started < num_readers) {
+        std::this_thread::yield();
+    }
+
+    uint32_t writes = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (writes < 1000000 || (reads.load(std::memory_order_relaxed) < min_reads && writes < 200000000)) {
+        lock.write(makeState(++writes));
+    }
+    double write_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / writes;
+    done = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    printf("  %u writes against %llu reads on %d threads\n", (unsigned)writes, (unsigned long long)reads.load(),
+           num_readers);
+    CHECK(reads >= min_reads);
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(lock.read().words[0] == writes);
+    CHECK_TIME("write with concurrent readers", write_ns, 2000);
+}
+
+void benchmark() {
+    SeqLock<State> lock;
+    lock.write(makeState(7));
+    double read_ns = nsPerCall(5000000, [&](uint32_t) {
+        benchmarkSink += lock.read().words[STATE_WORDS - 1];
+    });
+    double write_ns = nsPerCall(5000000, [&](uint32_t i) {
+        lock.write(makeState(i));
+    });
+    CHECK_TIME("uncontended read", read_ns, 200);
+    CHECK_TIME("uncontended write", write_ns, 200);
+}
+
+} // namespace
+
+int main() {
+    testSingleThread();
+    testConcurrent();
+    benchmark();
+    return report("test_seqlock");
+}